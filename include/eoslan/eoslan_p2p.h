@@ -0,0 +1,339 @@
+#pragma once
+
+#include "eos/eos_p2p_types.h"
+
+#pragma pack(push, 8)
+
+/**
+ * EOS-LAN extensions to the P2P interface. These functions are not part of
+ * the EOS SDK; they are exported by the LAN emulator for tooling (stats
+ * overlays, performance dashboards) and take the same EOS_HP2P handle as the
+ * EOS_P2P_* functions.
+ */
+
+/** The most recent version of the EOSLAN_P2P_ConnectionStats structure. */
+#define EOSLAN_P2P_CONNECTIONSTATS_API_LATEST 3
+
+/**
+ * Path quality and traffic counters for one P2P connection.
+ */
+EOS_STRUCT(EOSLAN_P2P_ConnectionStats, (
+	/**
+	 * API Version: Set this to EOSLAN_P2P_CONNECTIONSTATS_API_LATEST before the call. Only the fields of that
+	 * version are written; any other value is treated as version 1 (up to QueuedBytes).
+	 */
+	int32_t ApiVersion;
+	/** The remote user this connection is with */
+	EOS_ProductUserId RemoteUserId;
+	/** The socket this connection is on */
+	EOS_P2P_SocketId SocketId;
+	/** EOS_TRUE once the connection is established */
+	EOS_Bool bEstablished;
+	/** EOS_TRUE while the connection is interrupted (nothing heard from the peer for the interrupt timeout) */
+	EOS_Bool bInterrupted;
+	/** Smoothed round-trip time in milliseconds, or 0 if not measured yet */
+	uint32_t RoundTripTimeMs;
+	/** Round-trip time variation (jitter) in milliseconds */
+	uint32_t JitterMs;
+	/** Estimated packet loss in parts per thousand (unanswered keepalives) */
+	uint32_t LossPermille;
+	/** Milliseconds since anything was last received from the peer */
+	uint32_t MillisecondsSinceLastReceive;
+	/** Application packets sent on this connection */
+	uint64_t PacketsSent;
+	/** Application payload bytes sent on this connection */
+	uint64_t BytesSent;
+	/** Application packets received on this connection */
+	uint64_t PacketsReceived;
+	/** Application payload bytes received on this connection */
+	uint64_t BytesReceived;
+	/** Reliable packets retransmitted so far */
+	uint64_t Retransmissions;
+	/** Reliable packets sent but not yet acknowledged */
+	uint32_t ReliablePacketsInFlight;
+	/** Packets waiting in the outgoing queue for this connection */
+	uint32_t QueuedPacketCount;
+	/** Bytes waiting in the outgoing queue for this connection */
+	uint64_t QueuedBytes;
+	/** FEC parity packets sent on this connection (EOSLAN_P2P_FEC_CHANNELS) */
+	uint64_t FecParityPacketsSent;
+	/** Lost packets from the peer rebuilt from FEC parity */
+	uint64_t FecPacketsRecovered;
+	/** EOS_TRUE when the peer accepted our compression offer (same dictionary), so EOSLAN_P2P_COMPRESS_CHANNELS traffic to it is compressed */
+	EOS_Bool bCompressing;
+	/** Packets sent compressed */
+	uint64_t PacketsCompressed;
+	/** Packets that did not shrink and were sent as they were */
+	uint64_t PacketsStoredRaw;
+	/** Payload bytes given to the compressor; with CompressionOutputBytes this is the compression ratio */
+	uint64_t CompressionInputBytes;
+	/** Payload bytes that went on the wire for them (raw size for packets stored raw) */
+	uint64_t CompressionOutputBytes;
+	/** Time spent compressing, in microseconds */
+	uint64_t CompressMicroseconds;
+	/** Compressed packets received from the peer */
+	uint64_t PacketsDecompressed;
+	/** Time spent decompressing, in microseconds */
+	uint64_t DecompressMicroseconds;
+));
+
+/** The most recent version of the EOSLAN_P2P_GetConnectionStats API. */
+#define EOSLAN_P2P_GETCONNECTIONSTATS_API_LATEST 1
+
+/**
+ * Structure containing information about the connection to fetch stats for.
+ */
+EOS_STRUCT(EOSLAN_P2P_GetConnectionStatsOptions, (
+	/** API Version: Set this to EOSLAN_P2P_GETCONNECTIONSTATS_API_LATEST. */
+	int32_t ApiVersion;
+	/** The Product User ID of the local user */
+	EOS_ProductUserId LocalUserId;
+	/** The Product User ID of the remote user */
+	EOS_ProductUserId RemoteUserId;
+	/** The socket of the connection */
+	const EOS_P2P_SocketId* SocketId;
+));
+
+/**
+ * Get path quality and traffic counters for the connection to a peer on a socket.
+ *
+ * @param Options Which connection to report on
+ * @param OutStats Filled in on success, up to the version its ApiVersion names
+ * @return EOS_EResult::EOS_Success           - If the stats were written
+ *         EOS_EResult::EOS_InvalidParameters - If input was invalid
+ *         EOS_EResult::EOS_NotFound          - If there is no such connection
+ */
+EOS_DECLARE_FUNC(EOS_EResult) EOSLAN_P2P_GetConnectionStats(EOS_HP2P Handle, const EOSLAN_P2P_GetConnectionStatsOptions* Options, EOSLAN_P2P_ConnectionStats* OutStats);
+
+/**
+ * Get the number of connections EOSLAN_P2P_GetConnectionStatsByIndex can report on.
+ *
+ * @return The number of open (requested, pending or established) connections
+ */
+EOS_DECLARE_FUNC(uint32_t) EOSLAN_P2P_GetConnectionStatsCount(EOS_HP2P Handle);
+
+/**
+ * Get path quality and traffic counters for every open connection, one index at a time.
+ *
+ * @param Index Which connection, from 0 to EOSLAN_P2P_GetConnectionStatsCount() - 1
+ * @param OutStats Filled in on success, up to the version its ApiVersion names
+ * @return EOS_EResult::EOS_Success           - If the stats were written
+ *         EOS_EResult::EOS_InvalidParameters - If input was invalid
+ *         EOS_EResult::EOS_NotFound          - If Index is out of range
+ */
+EOS_DECLARE_FUNC(EOS_EResult) EOSLAN_P2P_GetConnectionStatsByIndex(EOS_HP2P Handle, uint32_t Index, EOSLAN_P2P_ConnectionStats* OutStats);
+
+/** The most recent version of the EOSLAN_P2P_SendPacketToGroup API. */
+#define EOSLAN_P2P_SENDPACKETTOGROUP_API_LATEST 1
+
+/**
+ * Structure containing information about the data being sent to every member of a session or lobby.
+ */
+EOS_STRUCT(EOSLAN_P2P_SendPacketToGroupOptions, (
+	/** API Version: Set this to EOSLAN_P2P_SENDPACKETTOGROUP_API_LATEST. */
+	int32_t ApiVersion;
+	/** The Product User ID of the local user who is sending this packet */
+	EOS_ProductUserId LocalUserId;
+	/** The id of the session or lobby whose members should receive the packet */
+	const char* GroupId;
+	/** The socket ID for data you are sending in this packet */
+	const EOS_P2P_SocketId* SocketId;
+	/** Channel associated with this data */
+	uint8_t Channel;
+	/** The size of the data to be sent to each member */
+	uint32_t DataLengthBytes;
+	/** The data to be sent to each member */
+	const void* Data;
+	/** Sets the reliability of the delivery of this packet. */
+	EOS_EPacketReliability Reliability;
+));
+
+/**
+ * Send the same packet to every member of a session or lobby the local user is in: each peer that
+ * is in the same session or lobby and has an established connection on SocketId. Unreliable packets go out as a single multicast datagram
+ * to the members that have confirmed they receive the group's multicast (EOSLAN_P2P_MULTICAST=1);
+ * everyone else, and all reliable packets, get their own copy as with EOS_P2P_SendPacket.
+ *
+ * @param Options Information about the data being sent and the group it is for
+ * @return EOS_EResult::EOS_Success           - If the packet was sent or queued for every member
+ *         EOS_EResult::EOS_InvalidParameters - If input was invalid
+ *         EOS_EResult::EOS_NotFound          - If the local user is not in a session or lobby with that id
+ *         EOS_EResult::EOS_NoConnection      - If no member has an established connection on the socket, or
+ *                                              none has told us yet that it is in the group
+ *         EOS_EResult::EOS_LimitExceeded     - If the packet is too large, or could not be queued for a member
+ */
+EOS_DECLARE_FUNC(EOS_EResult) EOSLAN_P2P_SendPacketToGroup(EOS_HP2P Handle, const EOSLAN_P2P_SendPacketToGroupOptions* Options);
+
+/**
+ * One packet of an EOSLAN_P2P_SendPackets batch.
+ */
+EOS_STRUCT(EOSLAN_P2P_OutgoingPacket, (
+	/** The Product User ID of the peer this packet is for */
+	EOS_ProductUserId RemoteUserId;
+	/** Channel associated with this data */
+	uint8_t Channel;
+	/** Sets the reliability of the delivery of this packet. */
+	EOS_EPacketReliability Reliability;
+	/** The size of the data to be sent */
+	uint32_t DataLengthBytes;
+	/** The data to be sent */
+	const void* Data;
+	/** Written by the call: what EOS_P2P_SendPacket would have returned for this packet */
+	EOS_EResult Result;
+));
+
+/** The most recent version of the EOSLAN_P2P_SendPackets API. */
+#define EOSLAN_P2P_SENDPACKETS_API_LATEST 1
+
+/**
+ * Structure containing a batch of packets to send on one socket.
+ */
+EOS_STRUCT(EOSLAN_P2P_SendPacketsOptions, (
+	/** API Version: Set this to EOSLAN_P2P_SENDPACKETS_API_LATEST. */
+	int32_t ApiVersion;
+	/** The Product User ID of the local user who is sending these packets */
+	EOS_ProductUserId LocalUserId;
+	/** The socket ID for every packet in the batch */
+	const EOS_P2P_SocketId* SocketId;
+	/** As EOS_P2P_SendPacketOptions::bAllowDelayedDelivery, for every packet */
+	EOS_Bool bAllowDelayedDelivery;
+	/** As EOS_P2P_SendPacketOptions::bDisableAutoAcceptConnection, for every packet */
+	EOS_Bool bDisableAutoAcceptConnection;
+	/** The number of entries in Packets */
+	uint32_t PacketCount;
+	/** The packets, sent in order; each one's Result is written */
+	EOSLAN_P2P_OutgoingPacket* Packets;
+));
+
+/**
+ * Send a batch of packets on one socket, each as EOS_P2P_SendPacket would. The handle and options
+ * are checked once, and consecutive packets for the same RemoteUserId handle reuse the connection
+ * found for the first.
+ *
+ * @param Options The packets and the socket they are for
+ * @param OutSentCount Optional; the number of packets sent or queued
+ * @return EOS_EResult::EOS_Success           - If every packet was sent or queued
+ *         EOS_EResult::EOS_InvalidParameters - If the options were invalid (no packet is sent)
+ *         Otherwise the Result of the first packet that failed; the others were still attempted
+ */
+EOS_DECLARE_FUNC(EOS_EResult) EOSLAN_P2P_SendPackets(EOS_HP2P Handle, const EOSLAN_P2P_SendPacketsOptions* Options, uint32_t* OutSentCount);
+
+/**
+ * One packet returned by EOSLAN_P2P_ReceivePackets.
+ */
+EOS_STRUCT(EOSLAN_P2P_IncomingPacket, (
+	/**
+	 * The Product User ID of the peer that sent the packet. This is an interned handle: every packet
+	 * from a peer carries the same pointer for the life of the process, so it can be used as a key.
+	 */
+	EOS_ProductUserId PeerId;
+	/** The socket the packet arrived on */
+	EOS_P2P_SocketId SocketId;
+	/** The channel the packet was sent on */
+	uint8_t Channel;
+	/** The number of payload bytes at Data */
+	uint32_t DataLengthBytes;
+	/** The payload, inside the caller's OutData buffer */
+	const void* Data;
+));
+
+/** The most recent version of the EOSLAN_P2P_ReceivePackets API. */
+#define EOSLAN_P2P_RECEIVEPACKETS_API_LATEST 1
+
+/**
+ * Structure containing information about the packets to receive.
+ */
+EOS_STRUCT(EOSLAN_P2P_ReceivePacketsOptions, (
+	/** API Version: Set this to EOSLAN_P2P_RECEIVEPACKETS_API_LATEST. */
+	int32_t ApiVersion;
+	/** The Product User ID of the local user receiving the packets */
+	EOS_ProductUserId LocalUserId;
+	/** The most entries to fill in OutPackets */
+	uint32_t MaxPackets;
+	/** The size of the OutData buffer */
+	uint32_t MaxDataSizeBytes;
+	/** An optional channel to receive from; NULL receives from every channel */
+	const uint8_t* RequestedChannel;
+));
+
+/**
+ * Take up to MaxPackets packets from the incoming queue in arrival order, as repeated calls to
+ * EOS_P2P_ReceivePacket would. Payloads are packed back to back into OutData; the batch ends
+ * before a packet that no longer fits. A first packet larger than the whole buffer is truncated,
+ * as EOS_P2P_ReceivePacket does, so every call makes progress.
+ *
+ * @param Options The limits of this call and the channel to receive from
+ * @param OutPackets Array of at least Options->MaxPackets entries
+ * @param OutData Buffer of Options->MaxDataSizeBytes bytes for the payloads
+ * @param OutPacketCount The number of entries written to OutPackets
+ * @return EOS_EResult::EOS_Success           - If at least one packet was received
+ *         EOS_EResult::EOS_InvalidParameters - If input was invalid
+ *         EOS_EResult::EOS_NotFound          - If there are no packets waiting
+ */
+EOS_DECLARE_FUNC(EOS_EResult) EOSLAN_P2P_ReceivePackets(EOS_HP2P Handle, const EOSLAN_P2P_ReceivePacketsOptions* Options, EOSLAN_P2P_IncomingPacket* OutPackets, void* OutData, uint32_t* OutPacketCount);
+
+/** The most recent version of the EOSLAN_P2P_PeekPacket API. */
+#define EOSLAN_P2P_PEEKPACKET_API_LATEST 1
+
+/**
+ * Structure containing information about the packet to borrow.
+ */
+EOS_STRUCT(EOSLAN_P2P_PeekPacketOptions, (
+	/** API Version: Set this to EOSLAN_P2P_PEEKPACKET_API_LATEST. */
+	int32_t ApiVersion;
+	/** The Product User ID of the local user receiving the packet */
+	EOS_ProductUserId LocalUserId;
+	/** An optional channel to receive from; NULL receives from every channel */
+	const uint8_t* RequestedChannel;
+));
+
+/**
+ * A packet lent out by EOSLAN_P2P_PeekPacket.
+ */
+EOS_STRUCT(EOSLAN_P2P_BorrowedPacket, (
+	/** The Product User ID of the peer that sent the packet (the interned handle, as EOSLAN_P2P_IncomingPacket::PeerId) */
+	EOS_ProductUserId PeerId;
+	/** The socket the packet arrived on */
+	EOS_P2P_SocketId SocketId;
+	/** The channel the packet was sent on */
+	uint8_t Channel;
+	/** The number of payload bytes at Data */
+	uint32_t DataLengthBytes;
+	/** The payload, read-only and valid until the packet is released */
+	const void* Data;
+	/**
+	 * When the datagram carrying the packet was read off the socket, in microseconds of the system
+	 * monotonic clock (QueryPerformanceCounter on Windows, CLOCK_MONOTONIC elsewhere). A packet held
+	 * back for ordering keeps its own arrival time.
+	 */
+	uint64_t ArrivalTimeMicroseconds;
+	/** Identifies the loan; pass the packet back to EOSLAN_P2P_ReleasePacket */
+	uint64_t PacketHandle;
+));
+
+/**
+ * Take the next packet off the incoming queue, as EOS_P2P_ReceivePacket would, without copying it:
+ * OutPacket->Data points into the emulator's receive buffer. The packet is no longer visible to the
+ * receive calls, but it keeps its place against the incoming queue limits until it is released.
+ * Several packets can be borrowed at once and released in any order. Must be called from the thread
+ * that ticks the platform, like EOS_P2P_ReceivePacket.
+ *
+ * @param Options The channel to receive from
+ * @param OutPacket Filled in on success
+ * @return EOS_EResult::EOS_Success           - If a packet was borrowed
+ *         EOS_EResult::EOS_InvalidParameters - If input was invalid
+ *         EOS_EResult::EOS_NotFound          - If there are no packets waiting
+ */
+EOS_DECLARE_FUNC(EOS_EResult) EOSLAN_P2P_PeekPacket(EOS_HP2P Handle, const EOSLAN_P2P_PeekPacketOptions* Options, EOSLAN_P2P_BorrowedPacket* OutPacket);
+
+/**
+ * Give a borrowed packet back. Its Data pointer must not be used afterwards.
+ *
+ * @param Packet The packet EOSLAN_P2P_PeekPacket filled in
+ * @return EOS_EResult::EOS_Success           - If the packet was released
+ *         EOS_EResult::EOS_InvalidParameters - If input was invalid
+ *         EOS_EResult::EOS_NotFound          - If the packet was already released
+ */
+EOS_DECLARE_FUNC(EOS_EResult) EOSLAN_P2P_ReleasePacket(EOS_HP2P Handle, const EOSLAN_P2P_BorrowedPacket* Packet);
+
+#pragma pack(pop)
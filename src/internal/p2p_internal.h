@@ -3,12 +3,10 @@
 
 #include "eos/eos_p2p_types.h"
 #include "platform_internal.h"
+#include "lan_p2p.h"  // P2PSocketManager, P2PAddress
 #include <stdbool.h>
 #include <stdint.h>
 
-// Forward decl of the LAN UDP socket manager (defined in lan_p2p.c)
-typedef struct P2PSocketManager P2PSocketManager;
-
 #define MAX_PACKET_SIZE 4096
 #define MAX_RECV_QUEUE 512
 #define MAX_SEND_QUEUE 512
@@ -17,48 +15,340 @@ typedef struct P2PSocketManager P2PSocketManager;
 #define SOCKET_NAME_MAX 32
 #define MAX_NOTIFICATIONS 8
 
+// Reliability engine (EOS_PR_ReliableUnordered / EOS_PR_ReliableOrdered).
+// P2P_RELIABLE_WINDOW is the per-connection limit on unacknowledged reliable
+// packets in flight; it is also the receiver's duplicate-detection window.
+#define P2P_RELIABLE_WINDOW 128
+#define P2P_RELIABLE_CHANNELS 256
+#define P2P_ACK_BITS 32
+#define P2P_RTO_INITIAL_MS 100
+#define P2P_RTO_MIN_MS 20
+#define P2P_RTO_MAX_MS 1000
+
+// Small-packet coalescing (EOSLAN_COALESCE=1). DATA for one connection is
+// gathered into a frame of length-prefixed records and sent as a single
+// MSG_BUNDLE datagram at the end of the tick (or once the frame is full or
+// older than EOSLAN_COALESCE_US). P2P_COALESCE_FRAME_MAX caps the budget
+// configurable through EOSLAN_COALESCE_MTU.
+#define P2P_COALESCE_FRAME_MAX 1400
+
+typedef struct {
+    uint32_t len;
+    uint32_t count;
+    uint64_t started_us;  // when the first record went in
+    uint8_t data[P2P_COALESCE_FRAME_MAX];
+} CoalesceFrame;
+
+// Packet buffer pool (p2p_pool.c). Queued packet payloads live in blocks
+// of P2P_POOL_CLASSES size classes (64, 256, P2P_POOL_BLOCK_MAX and
+// P2P_POOL_DATAGRAM bytes) carved from P2P_POOL_SLAB_BYTES slabs, so a queue
+// entry is a small descriptor and a typical payload occupies a 64-byte
+// block. The datagram class is what p2p_tick receives into: it holds any
+// datagram we send (a full header plus a CONNECT payload or a coalescing
+// frame), and a payload too large for the 256-byte class keeps it.
+#define P2P_POOL_CLASSES 4
+#define P2P_POOL_BLOCK_MAX EOS_P2P_MAX_PACKET_SIZE
+#define P2P_POOL_DATAGRAM 2048
+#define P2P_POOL_ADOPT_MIN 256  // payloads larger than this keep their datagram block
+#define P2P_POOL_SLAB_BYTES (16 * 1024)
+
+typedef struct P2PPoolSlab P2PPoolSlab;
+
+typedef struct {
+    uint32_t block_size;
+    void* free_list;         // free blocks, chained through their first bytes
+    P2PPoolSlab* slabs;
+    uint32_t slab_count;
+    uint32_t blocks_in_use;
+} P2PPoolClass;
+
+typedef struct {
+    P2PPoolClass classes[P2P_POOL_CLASSES];
+} P2PPool;
+
 // Received packet
 typedef struct {
     EOS_ProductUserId sender;
+    EOS_ProductUserId sender_handle;  // interned id (the connection's peer_handle)
     char sender_id_string[33];
     EOS_P2P_SocketId socket_id;
     uint8_t channel;
-    uint8_t data[MAX_PACKET_SIZE];
+    uint8_t* data;   // the payload, inside block
     uint32_t size;
+    uint8_t* block;  // pool block holding the payload (a whole datagram when received in place)
+    uint32_t block_size;  // size block was allocated for (p2p_pool_free)
+    uint64_t arrival_us;  // get_time_us() when the datagram carrying it arrived
+    uint32_t borrow_id;   // nonzero while lent out by EOSLAN_P2P_PeekPacket
+    // Intrusive links (slot indices, P2P_NO_SLOT = none): arrival order across
+    // all channels, and arrival order within this packet's channel. Free
+    // slots are chained through `next`.
+    int next;
+    int prev;
+    int channel_next;
+    int channel_prev;
     bool valid;
 } ReceivedPacket;
 
-// Pending outgoing packet
+#define P2P_NO_SLOT (-1)
+#define P2P_CHANNELS 256
+
+// Connection lookup tables: open addressing with linear probing over slot
+// indices into P2PState.connections (P2P_NO_SLOT = empty). Power of 2, at
+// least twice MAX_CONNECTIONS so probe runs stay short.
+#define P2P_CONN_HASH_SIZE 128
+
+// Send-path lookup (find_connection): direct-mapped on the ProductUserId
+// handle and socket name, naming the connection last found for that pair.
+// Handles are never freed (connect.c), so one always names the same peer;
+// a miss falls back to the hex-id table and refills the entry.
+typedef struct {
+    EOS_ProductUserId peer;  // NULL = empty
+    int16_t slot;
+} P2PHandleEntry;
+
+// Pending outgoing packet, queued on its connection
 typedef struct {
-    EOS_ProductUserId target;
-    char target_id_string[33];
-    EOS_P2P_SocketId socket_id;
     uint8_t channel;
-    uint8_t data[MAX_PACKET_SIZE];
+    uint8_t* data;  // pool block holding the payload
     uint32_t size;
     bool reliable;
-    bool allow_delayed;
+    bool ordered;
+    // Next packet in the connection's queue (slot index, P2P_NO_SLOT =
+    // last). Free slots are chained through it as well.
+    int next;
     bool valid;
 } PendingPacket;
 
+// Reliable packet awaiting acknowledgement (slot = sequence % window)
+typedef struct {
+    uint16_t sequence;
+    uint16_t order_sequence;
+    uint8_t channel;
+    bool ordered;
+    uint64_t first_sent_at;
+    uint64_t next_resend_at;
+    uint32_t transmissions;
+    uint32_t size;
+    bool in_use;
+    bool compressed;  // data is compressed (P2P_FLAG_COMPRESSED)
+    uint8_t data[EOS_P2P_MAX_PACKET_SIZE];
+} ReliableSendSlot;
+
+// Ordered packet received ahead of a gap on its channel (slot = sequence % window)
+typedef struct {
+    uint16_t sequence;
+    uint16_t order_sequence;
+    uint8_t channel;
+    uint32_t size;
+    bool in_use;
+    uint64_t arrival_us;  // when the datagram carrying it arrived
+    uint8_t data[EOS_P2P_MAX_PACKET_SIZE];
+} ReliableHeldSlot;
+
+// Result of classifying an incoming reliable packet
+typedef enum {
+    REL_RECV_DELIVER,    // New and deliverable now
+    REL_RECV_HOLD,       // New, but ordered and waiting for an earlier packet
+    REL_RECV_DUPLICATE,  // Already received (re-ACK only)
+    REL_RECV_REJECT      // Outside the receive window
+} ReliableRecvResult;
+
+// Per-connection reliability state. Allocated lazily on the first reliable
+// packet in either direction, so unreliable-only peers never pay for it.
+typedef struct ReliableState {
+    // Send side
+    uint16_t next_sequence;
+    uint16_t oldest_unacked;
+    int in_flight;
+    uint16_t next_order_send[P2P_RELIABLE_CHANNELS];
+    ReliableSendSlot send_window[P2P_RELIABLE_WINDOW];
+
+    // RTT estimate (RFC 6298 style, milliseconds)
+    uint32_t srtt_ms;
+    uint32_t rttvar_ms;
+    uint32_t rto_ms;
+    bool have_rtt_sample;
+
+    // Receive side
+    uint16_t recv_base;  // next sequence not yet received
+    bool recv_seen[P2P_RELIABLE_WINDOW];
+    uint16_t next_order_recv[P2P_RELIABLE_CHANNELS];
+    ReliableHeldSlot held[P2P_RELIABLE_WINDOW];
+    int held_count;
+    bool ack_pending;
+
+    // Counters
+    uint64_t retransmissions;
+} ReliableState;
+
+// Forward error correction for unreliable channels (p2p_fec.c,
+// EOSLAN_P2P_FEC_CHANNELS). Unreliable DATA on an FEC channel goes out as
+// MSG_FEC in groups of EOSLAN_P2P_FEC_K packets (at most P2P_FEC_MAX_K),
+// each group closed by a parity packet from which a receiver rebuilds any
+// one lost packet. Receivers keep the last P2P_FEC_WINDOW groups open.
+#define P2P_FEC_MAX_K 8
+#define P2P_FEC_WINDOW 4
+#define P2P_FEC_HEADER 3       // group(2) index(1)
+#define P2P_FEC_PARITY 0xFF    // index of the parity packet (then count(1))
+#define P2P_FEC_RECORD_MAX (3 + EOS_P2P_MAX_PACKET_SIZE)  // channel(1) len(2) payload
+
+typedef struct {
+    uint16_t group;
+    uint8_t received;   // bit i = data packet i arrived (or was rebuilt)
+    uint8_t count;      // packets in the group, from its parity (0 = not seen)
+    bool done;          // nothing left to rebuild
+    bool valid;
+    uint16_t len;       // bytes of acc in use
+    uint8_t acc[P2P_FEC_RECORD_MAX];  // XOR of the records and parity seen
+} FecRecvGroup;
+
+typedef struct FecState {
+    // Send side: the open group
+    uint16_t send_group;
+    uint8_t send_count;
+    uint16_t send_len;
+    uint64_t send_started;  // when the group's first packet went out
+    uint8_t send_acc[P2P_FEC_RECORD_MAX];
+    // Receive side
+    FecRecvGroup recv[P2P_FEC_WINDOW];
+    // Counters (EOSLAN_P2P_GetConnectionStats)
+    uint64_t parity_sent;
+    uint64_t recovered;
+} FecState;
+
+// A data packet handed back by p2p_fec_receive
+typedef struct {
+    bool valid;
+    uint8_t channel;
+    const uint8_t* data;
+    uint32_t len;
+} FecPacket;
+
+// Payload compression (p2p_compress.c, EOSLAN_P2P_COMPRESS_CHANNELS). DATA
+// on a compressed channel goes out LZ-compressed with P2P_FLAG_COMPRESSED
+// when the peer's CONNECT or ACCEPT offered the same dictionary, and as is
+// when it would not shrink. The window holds the dictionary followed by the
+// packet being (de)compressed, so table positions fit in 16 bits.
+#define P2P_DICT_MAX (32 * 1024)
+#define P2P_LZ_HASH_BITS 12
+#define P2P_DICT_SAMPLE_EVERY 8  // EOSLAN_P2P_COMPRESS_TRAIN keeps every 8th packet
+
+typedef struct {
+    uint32_t dict_len;
+    uint32_t dict_id;  // CRC32 of the dictionary, 0 = none (offered in CONNECT/ACCEPT)
+    uint16_t dict_table[1u << P2P_LZ_HASH_BITS];  // positions of the dictionary's 4-byte prefixes
+    uint16_t table[1u << P2P_LZ_HASH_BITS];       // scratch for one packet
+    uint8_t window[P2P_DICT_MAX + EOS_P2P_MAX_PACKET_SIZE];
+    // Dictionary training: a ring of sampled payloads
+    uint8_t* samples;
+    uint32_t sample_pos;
+    uint64_t sample_bytes;
+    uint32_t sample_skip;
+} P2PCompressor;
+
+// Session / lobby groups (p2p_group_join). EOSLAN_P2P_SendPacketToGroup
+// sends to a group's members, the peers that told us they are in it (GROUP
+// joined/member); with EOSLAN_P2P_MULTICAST each group also has a multicast
+// address derived from its id. Bit i of a connection's group masks refers to
+// P2PState.groups[i].
+#define P2P_MAX_GROUPS 8
+#define P2P_GROUP_ID_MAX 65
+
+typedef struct {
+    char id[P2P_GROUP_ID_MAX];  // session or lobby id
+    uint32_t hash;              // names the group on the wire
+    P2PAddress addr;            // 239.255.x.y on the multicast port
+    bool joined;                // multicast membership held (else unicast only)
+    uint64_t probe_at;          // next GROUP_PROBE to the group
+    uint64_t announce_at;       // next GROUP_JOINED to connections not known as members
+    bool valid;
+} P2PGroup;
+
 // Connection state
 typedef enum {
-    CONN_STATE_NONE,
+    CONN_STATE_NONE,         // Idle (address book entry, or not yet asked)
     CONN_STATE_REQUESTING,   // We sent request, waiting for accept
     CONN_STATE_PENDING,      // They sent request, waiting for our accept
     CONN_STATE_ESTABLISHED,
+    CONN_STATE_CLOSING,      // We sent CLOSE, repeating it before release
     CONN_STATE_CLOSED
 } ConnectionState;
 
 // Connection to a peer
 typedef struct {
     EOS_ProductUserId peer_id;
+    EOS_ProductUserId peer_handle;  // interned: one handle per peer for the process lifetime
     char peer_id_string[33];
-    char peer_address[64];  // "IP:port"
+    char peer_address[64];  // "IP:port" (for logs and p2p_get_peer_address)
+    P2PAddress addr;        // peer_address resolved; what the send path uses
     EOS_P2P_SocketId socket_id;
     ConnectionState state;
     uint64_t established_at;
     uint64_t last_activity;
+    ReliableState* rel;  // NULL until the connection carries reliable traffic
+    FecState* fec;       // NULL until the connection sends or receives MSG_FEC
+    uint32_t local_token;   // peer stamps this on compact packets to us (low byte = slot)
+    uint32_t remote_token;  // we stamp this on compact packets to the peer; 0 = not yet known
+    CoalesceFrame* frame;   // NULL until coalescing first buffers DATA for this peer
+    uint32_t key_hash;      // hash of peer_id_string + socket name (conn_index)
+    uint32_t peer_hash;     // hash of peer_id_string alone (peer_index)
+    int peer_next;          // next connection to the same peer (P2P_NO_SLOT = last)
+    // Handshake timers: CONNECT re-sends while REQUESTING, CLOSE re-sends
+    // while CLOSING
+    uint64_t handshake_next_at;   // next (re)send; 0 = as soon as possible
+    uint64_t handshake_deadline;  // REQUESTING: give up after this (0 = never)
+    uint32_t handshake_attempts;  // messages sent so far
+    uint64_t handshake_sent_at;   // when the last CONNECT went out
+    uint32_t rtt_hint_ms;         // handshake RTT of a pre-warmed path to the peer (0 = none)
+    bool fast_start;              // peer pre-warmed: DATA goes out ahead of the ACCEPT
+    bool address_book;            // transport entry we registered (kept when the path goes down)
+    // Liveness and path quality, from PING/PONG on idle connections (and
+    // the CONNECT/ACCEPT exchange)
+    uint64_t ping_sent_at;        // when the last PING went out (0 = never)
+    uint16_t ping_sequence;       // sequence of the last PING
+    bool ping_outstanding;        // ... and no PONG for it yet
+    uint32_t srtt_ms;             // smoothed RTT (0 = no sample yet)
+    uint32_t rttvar_ms;           // RTT variation, reported as jitter
+    uint32_t loss_permille;       // unanswered PINGs, moving average
+    bool interrupted;             // interrupted notification fired, waiting for traffic
+    // Application traffic counters (EOSLAN_P2P_GetConnectionStats)
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t packets_received;
+    uint64_t bytes_received;
+    // Send pacing (token bucket, see P2PState.pace_rate): bytes the
+    // connection may still put on the wire, refilled from pace_refill_us
+    int64_t pace_tokens;
+    uint64_t pace_refill_us;      // 0 = bucket not started (starts full)
+    // Outgoing queue: packets waiting for the handshake, the reliable
+    // window or the pacer, oldest first (slots in P2PState.send_queue)
+    int send_first;
+    int send_last;
+    int send_count;
+    uint64_t send_bytes;
+    // Links in P2PState.backlog_first (connections with queued packets)
+    int backlog_prev;
+    int backlog_next;
+    bool backlogged;
+    int32_t drr_deficit;  // fair scheduling: bytes this connection may still send this round
+    // Multicast groups (bits as in P2PState.groups): the peer has confirmed
+    // it hears our multicast / the peer told us to take its multicast
+    uint8_t group_confirmed;
+    uint8_t group_accepted;
+    // Groups the peer is in (it said so with GROUP_JOINED/GROUP_MEMBER), and
+    // groups we have announced ourselves in to it
+    uint8_t group_member;
+    uint8_t group_announced;
+    // Compression: the peer's last CONNECT/ACCEPT offered our dictionary,
+    // and counters for DATA on compressed channels
+    bool peer_decompresses;
+    uint64_t compress_in_bytes;    // payload bytes offered to the compressor
+    uint64_t compress_out_bytes;   // ... and what went on the wire for them
+    uint64_t packets_compressed;
+    uint64_t packets_stored_raw;   // did not shrink, sent as is
+    uint64_t packets_decompressed;
+    uint64_t compress_us;
+    uint64_t decompress_us;
     bool valid;
 } PeerConnection;
 
@@ -86,31 +376,60 @@ typedef struct P2PState {
 
     // LAN UDP transport (created in p2p_create)
     P2PSocketManager* sock;
-    uint64_t last_connect_send;  // throttle CONNECT re-sends
+
+    // Handshake
+    uint32_t connect_timeout_ms;  // REQUESTING give-up time (0 = keep trying)
+    uint32_t handshake_rng;       // backoff jitter (xorshift32 state)
+    bool prewarm;                 // EOSLAN_P2P_PREWARM: handshake with a host on join
+
+    // Liveness (0 disables each): PING an established connection after
+    // keepalive_ms without hearing from the peer, report it interrupted
+    // after interrupt_ms and close it after idle_timeout_ms.
+    uint32_t keepalive_ms;
+    uint32_t interrupt_ms;
+    uint32_t idle_timeout_ms;
 
     // Local user
     EOS_ProductUserId local_user;
 
-    // Connections
+    // Connections, indexed by peer id + socket name and by peer id alone
+    // (the peer_index entry heads that peer's chain through peer_next).
     PeerConnection connections[MAX_CONNECTIONS];
     int connection_count;
+    int16_t conn_index[P2P_CONN_HASH_SIZE];
+    int16_t peer_index[P2P_CONN_HASH_SIZE];
+    P2PHandleEntry handle_index[P2P_CONN_HASH_SIZE];
+    uint32_t token_generation;  // upper 24 bits of the next local connection token
 
     // Auto-accept
     bool auto_accept_all;
     AcceptedSocket accepted_sockets[MAX_ACCEPTED_SOCKETS];
     int accepted_socket_count;
 
-    // Receive queue
+    // Receive queue. Packets are indexed both in arrival order and per
+    // channel, so ReceivePacket / GetNextReceivedPacketSize take a list head
+    // with or without RequestedChannel.
     ReceivedPacket recv_queue[MAX_RECV_QUEUE];
-    int recv_head;
-    int recv_tail;
-    int recv_count;
+    int recv_free;                         // free-slot chain
+    int recv_first;                        // oldest packet, any channel
+    int recv_last;
+    int channel_first[P2P_CHANNELS];       // oldest packet per channel
+    int channel_last[P2P_CHANNELS];
+    uint64_t channel_bytes[P2P_CHANNELS];  // queued payload bytes per channel
+    int recv_count;                        // includes packets lent out (borrow_id)
+    uint32_t next_borrow_id;               // EOSLAN_P2P_PeekPacket handles
 
-    // Send queue (for packets to unconnected peers)
+    // Payload buffers for both queues
+    P2PPool pool;
+    uint8_t* recv_block;  // P2P_POOL_DATAGRAM block the next datagram is received into
+
+    // Outgoing queue. The packet slots are shared by every connection's
+    // queue (free slots chained through `next`); backlog_first lists the
+    // connections that have packets queued, so a tick only visits those.
     PendingPacket send_queue[MAX_SEND_QUEUE];
-    int send_head;
-    int send_tail;
+    int send_free;
     int send_count;
+    int backlog_first;
 
     // Notifications
     P2PNotification conn_request_notifs[MAX_NOTIFICATIONS];
@@ -129,6 +448,45 @@ typedef struct P2PState {
     uint16_t port_range_start;
     uint16_t port_range_count;
 
+    // Small-packet coalescing (off unless EOSLAN_COALESCE is set)
+    bool coalesce;
+    uint32_t coalesce_budget;       // frame bytes per MSG_BUNDLE datagram
+    uint32_t coalesce_deadline_us;  // 0 = hold until the end of the tick
+
+    // Send pacing (off unless EOSLAN_P2P_PACE_RATE is set): each connection
+    // puts at most pace_rate bytes/s on the wire, in bursts of pace_burst
+    uint32_t pace_rate;
+    uint32_t pace_burst;
+
+    // Fair scheduling (off unless EOSLAN_P2P_FAIR is set): queued DATA is
+    // sent once per tick by deficit round robin across connections, up to
+    // fair_budget bytes. Packets on priority channels go first.
+    bool fair;
+    uint32_t fair_budget;
+    int fair_cursor;  // connection slot the next tick's round starts at
+    bool priority_channel[P2P_CHANNELS];
+
+    // Forward error correction (off unless EOSLAN_P2P_FEC_CHANNELS lists
+    // channels): unreliable DATA on those channels is protected by one
+    // parity packet per fec_k, sent early once a group is fec_flush_ms old
+    bool fec_channel[P2P_CHANNELS];
+    bool fec;
+    uint32_t fec_k;
+    uint32_t fec_flush_ms;
+
+    // Payload compression (off unless EOSLAN_P2P_COMPRESS_CHANNELS lists
+    // channels). The compressor is created with the dictionary from
+    // EOSLAN_P2P_COMPRESS_DICT, or on first use without one.
+    bool compress_channel[P2P_CHANNELS];
+    P2PCompressor* compressor;
+    char compress_train_path[260];  // EOSLAN_P2P_COMPRESS_TRAIN: write a dictionary on destroy
+
+    // Sessions and lobbies we are in. Their multicast groups are only
+    // joined with EOSLAN_P2P_MULTICAST set (multicast, on mcast_port).
+    P2PGroup groups[P2P_MAX_GROUPS];
+    bool multicast;
+    uint16_t mcast_port;
+
     // Queue size limits
     uint64_t incoming_queue_max_bytes;
     uint64_t outgoing_queue_max_bytes;
@@ -137,6 +495,10 @@ typedef struct P2PState {
     uint64_t incoming_queue_current_bytes;
     uint64_t outgoing_queue_current_bytes;
 
+    // Incoming queue-full notification fired; packets are refused without
+    // firing again until the application makes room (or raises the limit)
+    bool incoming_queue_full;
+
 } P2PState;
 
 // Creation/destruction
@@ -146,10 +508,75 @@ void p2p_tick(P2PState* state);
 
 // Address book
 void p2p_register_peer_address(P2PState* state, EOS_ProductUserId peer, const char* address);
+// Open the transport path to a registered peer ahead of the game's first
+// SendPacket (session/lobby join). No-op unless EOSLAN_P2P_PREWARM is set.
+void p2p_prewarm_peer(P2PState* state, EOS_ProductUserId peer);
 const char* p2p_get_peer_address(P2PState* state, EOS_ProductUserId peer);
 
+// Session / lobby membership, for EOSLAN_P2P_SendPacketToGroup (group_id is
+// the session or lobby id)
+void p2p_group_join(P2PState* state, const char* group_id);
+void p2p_group_leave(P2PState* state, const char* group_id);
+
 // Local P2P listen port/ip (for advertising host_address in the lobby)
 uint16_t p2p_get_listen_port(P2PState* state);
 const char* p2p_get_listen_ip(P2PState* state);
 
+// Packet buffer pool (p2p_pool.c). p2p_pool_free must be given the size
+// the block was allocated for.
+void p2p_pool_init(P2PPool* pool);
+void p2p_pool_destroy(P2PPool* pool);
+uint8_t* p2p_pool_alloc(P2PPool* pool, uint32_t size);
+void p2p_pool_free(P2PPool* pool, uint8_t* block, uint32_t size);
+
+// Forward error correction (p2p_fec.c). p2p_fec_wrap / p2p_fec_parity
+// write a MSG_FEC payload into out (room for P2P_FEC_HEADER + 1 +
+// P2P_FEC_RECORD_MAX bytes) and return its length; p2p_fec_parity returns 0
+// when the open group is empty. p2p_fec_receive hands back the data packet
+// (pointing into msg) unless it was already rebuilt, and any packet the
+// message let it rebuild (pointing into fs, valid until the next call).
+FecState* p2p_fec_create(void);
+void p2p_fec_destroy(FecState* fs);
+uint32_t p2p_fec_wrap(FecState* fs, uint8_t channel, const uint8_t* data, uint32_t size,
+                      uint8_t* out, uint64_t now);
+uint32_t p2p_fec_parity(FecState* fs, uint8_t* out);
+void p2p_fec_receive(FecState* fs, uint8_t channel, const uint8_t* msg, uint32_t len,
+                     FecPacket* out, FecPacket* rebuilt);
+
+// Payload compression (p2p_compress.c). p2p_compress returns the compressed
+// length, or 0 if the result would not fit in capacity; p2p_decompress
+// returns the original length, or -1 for malformed input. Both use the
+// compressor's window, so one compressor serves one thread.
+P2PCompressor* p2p_compress_create(const uint8_t* dict, uint32_t dict_len);
+P2PCompressor* p2p_compress_load(const char* dict_path);
+void p2p_compress_destroy(P2PCompressor* c);
+uint32_t p2p_compress(P2PCompressor* c, const uint8_t* src, uint32_t len,
+                      uint8_t* dst, uint32_t capacity);
+int p2p_decompress(P2PCompressor* c, const uint8_t* src, uint32_t len,
+                   uint8_t* dst, uint32_t capacity);
+void p2p_compress_sample(P2PCompressor* c, const uint8_t* data, uint32_t len);
+bool p2p_compress_write_dictionary(const P2PCompressor* c, const char* path);
+
+// Reliability engine (p2p_reliable.c)
+ReliableState* p2p_rel_create(void);
+void p2p_rel_destroy(ReliableState* rs);
+void p2p_rel_reset(ReliableState* rs);
+void p2p_rel_seed_rto(ReliableState* rs, uint32_t rtt_ms);
+bool p2p_rel_can_send(const ReliableState* rs);
+ReliableSendSlot* p2p_rel_track(ReliableState* rs, uint8_t channel, bool ordered,
+                                const uint8_t* data, uint32_t size, uint64_t now);
+void p2p_rel_mark_sent(ReliableState* rs, ReliableSendSlot* slot, uint64_t now);
+ReliableSendSlot* p2p_rel_next_due(ReliableState* rs, uint64_t now, int* cursor);
+void p2p_rel_expedite(ReliableState* rs, uint64_t now);
+void p2p_rel_on_ack(ReliableState* rs, uint16_t ack, uint32_t ack_bits, uint64_t now);
+ReliableRecvResult p2p_rel_classify(ReliableState* rs, uint16_t sequence, bool ordered,
+                                    uint8_t channel, uint16_t order_sequence);
+void p2p_rel_mark_received(ReliableState* rs, uint16_t sequence, bool ordered,
+                           uint8_t channel, uint16_t order_sequence);
+bool p2p_rel_hold(ReliableState* rs, uint16_t sequence, uint8_t channel, uint16_t order_sequence,
+                  const uint8_t* data, uint32_t size, uint64_t arrival_us);
+ReliableHeldSlot* p2p_rel_next_ready(ReliableState* rs);
+void p2p_rel_release_held(ReliableState* rs, ReliableHeldSlot* slot);
+void p2p_rel_build_ack(const ReliableState* rs, uint16_t* out_ack, uint32_t* out_ack_bits);
+
 #endif // EOS_LAN_P2P_INTERNAL_H
@@ -2,6 +2,7 @@
 #define EOS_PLATFORM_INTERNAL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "eos/eos_sdk.h"
 #include "eos/eos_connect_types.h"
 #include "eos/eos_sessions_types.h"
@@ -39,6 +40,11 @@ typedef struct PlatformState {
     // Callback queue
     CallbackQueue* callbacks;
 
+    // Thread that last called EOS_Platform_Tick (0 = never ticked). In-process
+    // shortcuts between platforms are only taken when both are ticked on the
+    // same thread, since neither side's state is locked.
+    uint64_t tick_thread;
+
     // LAN networking configuration (from environment variables)
     struct {
         uint16_t discovery_port;
@@ -53,6 +59,10 @@ typedef struct PlatformState {
 extern bool g_sdk_initialized;
 extern PlatformState* g_platforms[8];
 
+// True when the calling thread is the one that ticks `platform` (implemented
+// in platform.c).
+bool platform_on_tick_thread(const PlatformState* platform);
+
 // Implemented in social_bridge.c — fires friends/presence notifications for
 // newly LAN-discovered peers. Called once per EOS_Platform_Tick.
 void social_bridge_tick(PlatformState* platform);
@@ -0,0 +1,273 @@
+#include "lan_capture.h"
+#include "lan_common.h"
+#include "internal/logging.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+static SRWLOCK g_lock = SRWLOCK_INIT;
+#define capture_lock() AcquireSRWLockExclusive(&g_lock)
+#define capture_unlock() ReleaseSRWLockExclusive(&g_lock)
+#else
+#include <pthread.h>
+#include <unistd.h>
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+#define capture_lock() pthread_mutex_lock(&g_lock)
+#define capture_unlock() pthread_mutex_unlock(&g_lock)
+#endif
+
+#define CAPTURE_PATH_MAX 512
+#define CAPTURE_FILE_BUFFER (64 * 1024)
+
+struct LanCapture {
+    uint8_t kind;
+    uint16_t local_port;
+};
+
+struct LanReplay {
+    uint8_t kind;
+    uint16_t local_port;
+    size_t offset;  // next record to look at
+};
+
+// Capture file, shared by every recording socket in the process
+static FILE* g_capture_file;
+static int g_capture_refs;
+static uint64_t g_capture_start;
+static uint64_t g_capture_records;
+static uint64_t g_capture_bytes;
+
+// Loaded replay, read-only once loaded
+static uint8_t* g_replay_data;
+static size_t g_replay_size;
+static int g_replay_refs;
+static double g_replay_speed;
+static uint64_t g_replay_start;  // 0 until the first socket polls
+
+static void put_le(uint8_t* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+// EOSLAN_CAPTURE with "%p" replaced by the process id.
+static void capture_path(const char* pattern, char* out, size_t out_size) {
+    size_t n = 0;
+    for (const char* p = pattern; *p && n + 1 < out_size; p++) {
+        if (p[0] == '%' && p[1] == 'p') {
+            int w = snprintf(out + n, out_size - n, "%d", (int)getpid());
+            if (w < 0 || (size_t)w >= out_size - n) break;
+            n += (size_t)w;
+            p++;
+        } else {
+            out[n++] = *p;
+        }
+    }
+    out[n] = '\0';
+}
+
+LanCapture* lan_capture_open(uint8_t kind, uint16_t local_port) {
+    const char* pattern = getenv("EOSLAN_CAPTURE");
+    if (!pattern || !*pattern) return NULL;
+
+    LanCapture* cap = calloc(1, sizeof(LanCapture));
+    if (!cap) return NULL;
+    cap->kind = kind;
+    cap->local_port = local_port;
+
+    capture_lock();
+    if (g_capture_refs == 0) {
+        char path[CAPTURE_PATH_MAX];
+        capture_path(pattern, path, sizeof(path));
+        g_capture_file = fopen(path, "wb");
+        if (g_capture_file) {
+            setvbuf(g_capture_file, NULL, _IOFBF, CAPTURE_FILE_BUFFER);
+            fwrite(LAN_CAPTURE_MAGIC, 1, LAN_CAPTURE_MAGIC_SIZE, g_capture_file);
+            g_capture_start = get_time_us();
+            g_capture_records = 0;
+            g_capture_bytes = 0;
+            EOS_LOG_INFO("CAPTURE: recording to %s", path);
+        } else {
+            EOS_LOG_ERROR("CAPTURE: can't create %s", path);
+        }
+    }
+    if (!g_capture_file) {
+        capture_unlock();
+        free(cap);
+        return NULL;
+    }
+    g_capture_refs++;
+    capture_unlock();
+    return cap;
+}
+
+void lan_capture_close(LanCapture* cap) {
+    if (!cap) return;
+    capture_lock();
+    if (--g_capture_refs == 0) {
+        fclose(g_capture_file);
+        g_capture_file = NULL;
+        EOS_LOG_INFO("CAPTURE: %llu datagrams, %llu bytes recorded",
+                     (unsigned long long)g_capture_records, (unsigned long long)g_capture_bytes);
+    }
+    capture_unlock();
+    free(cap);
+}
+
+void lan_capture_write(LanCapture* cap, uint8_t direction, uint32_t ip, uint16_t port,
+                       const uint8_t* data, uint32_t len) {
+    if (!cap) return;
+
+    uint8_t header[LAN_CAPTURE_RECORD_HEADER];
+    header[8] = cap->kind;
+    header[9] = direction;
+    put_le(header + 10, cap->local_port, 2);
+    memcpy(header + 12, &ip, 4);
+    memcpy(header + 16, &port, 2);
+    put_le(header + 18, len, 4);
+
+    capture_lock();
+    put_le(header, get_time_us() - g_capture_start, 8);
+    fwrite(header, 1, sizeof(header), g_capture_file);
+    if (len > 0) fwrite(data, 1, len, g_capture_file);
+    g_capture_records++;
+    g_capture_bytes += len;
+    capture_unlock();
+}
+
+// Read the whole capture. A record cut short (the process died while
+// writing) ends it.
+static bool replay_load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        EOS_LOG_ERROR("REPLAY: can't open %s", path);
+        return false;
+    }
+    uint8_t magic[LAN_CAPTURE_MAGIC_SIZE];
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+        memcmp(magic, LAN_CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        EOS_LOG_ERROR("REPLAY: %s is not a capture file", path);
+        fclose(f);
+        return false;
+    }
+
+    size_t capacity = 64 * 1024;
+    size_t size = 0;
+    uint8_t* data = malloc(capacity);
+    while (data) {
+        if (size == capacity) {
+            uint8_t* grown = realloc(data, capacity * 2);
+            if (!grown) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+        size_t n = fread(data + size, 1, capacity - size, f);
+        if (n == 0) break;
+        size += n;
+    }
+    fclose(f);
+    if (!data) {
+        EOS_LOG_ERROR("REPLAY: out of memory loading %s", path);
+        return false;
+    }
+
+    size_t offset = 0;
+    uint64_t records = 0;
+    while (offset + LAN_CAPTURE_RECORD_HEADER <= size) {
+        uint32_t len = (uint32_t)get_le(data + offset + 18, 4);
+        if (len > size - offset - LAN_CAPTURE_RECORD_HEADER) break;
+        offset += LAN_CAPTURE_RECORD_HEADER + len;
+        records++;
+    }
+
+    g_replay_data = data;
+    g_replay_size = offset;
+    EOS_LOG_INFO("REPLAY: %llu records from %s at %gx speed", (unsigned long long)records, path,
+                 g_replay_speed);
+    return true;
+}
+
+LanReplay* lan_replay_open(uint8_t kind, uint16_t local_port) {
+    const char* path = getenv("EOSLAN_REPLAY");
+    if (!path || !*path) return NULL;
+
+    LanReplay* rp = calloc(1, sizeof(LanReplay));
+    if (!rp) return NULL;
+    rp->kind = kind;
+    rp->local_port = local_port;
+
+    capture_lock();
+    if (g_replay_refs == 0) {
+        const char* speed = getenv("EOSLAN_REPLAY_SPEED");
+        g_replay_speed = speed && *speed ? atof(speed) : 1.0;
+        if (g_replay_speed < 0) g_replay_speed = 1.0;
+        g_replay_start = 0;
+        if (!replay_load(path)) {
+            capture_unlock();
+            free(rp);
+            return NULL;
+        }
+    }
+    g_replay_refs++;
+    capture_unlock();
+    return rp;
+}
+
+void lan_replay_close(LanReplay* rp) {
+    if (!rp) return;
+    capture_lock();
+    if (--g_replay_refs == 0) {
+        free(g_replay_data);
+        g_replay_data = NULL;
+        g_replay_size = 0;
+    }
+    capture_unlock();
+    free(rp);
+}
+
+// Microseconds of capture time that have played out so far.
+static uint64_t replay_elapsed(void) {
+    uint64_t now = get_time_us();
+    capture_lock();
+    if (g_replay_start == 0) g_replay_start = now;
+    uint64_t start = g_replay_start;
+    capture_unlock();
+    return (uint64_t)((double)(now - start) * g_replay_speed);
+}
+
+int lan_replay_next(LanReplay* rp, uint8_t* buf, uint32_t buf_size,
+                    uint32_t* out_ip, uint16_t* out_port, uint8_t* out_direction) {
+    if (!rp) return -1;
+
+    while (rp->offset < g_replay_size) {
+        const uint8_t* rec = g_replay_data + rp->offset;
+        uint32_t len = (uint32_t)get_le(rec + 18, 4);
+        if (rec[8] != rp->kind || (uint16_t)get_le(rec + 10, 2) != rp->local_port) {
+            rp->offset += LAN_CAPTURE_RECORD_HEADER + len;
+            continue;
+        }
+
+        if (g_replay_speed > 0 && get_le(rec, 8) > replay_elapsed()) return -1;
+
+        rp->offset += LAN_CAPTURE_RECORD_HEADER + len;
+        if (len > buf_size) len = buf_size;
+        memcpy(buf, rec + LAN_CAPTURE_RECORD_HEADER, len);
+        memcpy(out_ip, rec + 12, 4);
+        memcpy(out_port, rec + 16, 2);
+        *out_direction = rec[9];
+        return (int)len;
+    }
+    return -1;
+}
@@ -0,0 +1,92 @@
+#ifndef EOS_LAN_CAPTURE_H
+#define EOS_LAN_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Packet capture and replay for the LAN transports.
+ *
+ * EOSLAN_CAPTURE=<file> records every datagram the P2P socket and the
+ * discovery services send and receive, as the transport saw it (after
+ * EOSLAN_NETEM). "%p" in the name is replaced by the process id, so
+ * several instances on one machine can share the setting.
+ *
+ * EOSLAN_REPLAY=<file> feeds the received datagrams of a capture back in
+ * instead of reading the sockets; sends are discarded. The capture's time
+ * line restarts when the first replayed socket polls, scaled by
+ * EOSLAN_REPLAY_SPEED (default 1, 0 = as fast as they are polled).
+ *
+ * File layout (integers little-endian):
+ *
+ *   "EOSLCAP1"
+ *   records: time_us(8) kind(1) direction(1) local_port(2)
+ *            peer_ip(4, network order) peer_port(2, network order)
+ *            length(4) data
+ *
+ * time_us counts from the moment the capture was opened.
+ */
+
+#define LAN_CAPTURE_MAGIC "EOSLCAP1"
+#define LAN_CAPTURE_MAGIC_SIZE 8
+#define LAN_CAPTURE_RECORD_HEADER 22
+
+// Record kinds
+#define LAN_CAPTURE_P2P 1
+#define LAN_CAPTURE_DISCOVERY 2
+
+// Directions
+#define LAN_CAPTURE_IN 0
+#define LAN_CAPTURE_OUT 1
+
+typedef struct LanCapture LanCapture;
+typedef struct LanReplay LanReplay;
+
+/**
+ * Start recording one socket. The first caller opens the file.
+ *
+ * @param kind LAN_CAPTURE_P2P or LAN_CAPTURE_DISCOVERY
+ * @param local_port Port the socket is bound to
+ * @return Handle, or NULL if EOSLAN_CAPTURE is not set (or the file can't be opened)
+ */
+LanCapture* lan_capture_open(uint8_t kind, uint16_t local_port);
+
+/**
+ * Stop recording; the last handle closes the file.
+ */
+void lan_capture_close(LanCapture* cap);
+
+/**
+ * Append one datagram. Safe to call from any thread.
+ *
+ * @param ip / port Peer address, network byte order
+ */
+void lan_capture_write(LanCapture* cap, uint8_t direction, uint32_t ip, uint16_t port,
+                       const uint8_t* data, uint32_t len);
+
+/**
+ * Start replaying the datagrams captured for one socket. The first caller
+ * loads the file.
+ *
+ * @return Handle, or NULL if EOSLAN_REPLAY is not set (or the file can't be read)
+ */
+LanReplay* lan_replay_open(uint8_t kind, uint16_t local_port);
+
+/**
+ * Stop replaying; the last handle releases the loaded capture.
+ */
+void lan_replay_close(LanReplay* rp);
+
+/**
+ * Take the socket's next captured datagram whose time has come. Sent ones
+ * are handed out too (in capture order), for callers that need to follow
+ * what the captured run told its peers. Call from one thread per handle.
+ *
+ * @param out_ip / out_port Peer address, network byte order
+ * @param out_direction LAN_CAPTURE_IN or LAN_CAPTURE_OUT
+ * @return Datagram length, or -1 if none is due (yet)
+ */
+int lan_replay_next(LanReplay* rp, uint8_t* buf, uint32_t buf_size,
+                    uint32_t* out_ip, uint16_t* out_port, uint8_t* out_direction);
+
+#endif // EOS_LAN_CAPTURE_H
@@ -17,6 +17,7 @@
 #include <arpa/inet.h>
 #include <ifaddrs.h>
 #include <unistd.h>
+#include <pthread.h>
 #endif
 
 bool get_local_ip(char* out_ip, int out_size) {
@@ -78,6 +79,46 @@ bool get_local_ip(char* out_ip, int out_size) {
 #endif
 }
 
+bool is_local_address(const char* ip) {
+    if (!ip || !*ip) return false;
+    if (strncmp(ip, "127.", 4) == 0) return true;
+
+#ifdef _WIN32
+    IP_ADAPTER_INFO adapter_info[16];
+    DWORD buf_len = sizeof(adapter_info);
+
+    if (GetAdaptersInfo(adapter_info, &buf_len) != ERROR_SUCCESS) {
+        return false;
+    }
+
+    for (PIP_ADAPTER_INFO adapter = adapter_info; adapter; adapter = adapter->Next) {
+        for (PIP_ADDR_STRING a = &adapter->IpAddressList; a; a = a->Next) {
+            if (strcmp(a->IpAddress.String, ip) == 0) return true;
+        }
+    }
+    return false;
+#else
+    struct in_addr target;
+    if (inet_pton(AF_INET, ip, &target) != 1) return false;
+
+    struct ifaddrs *ifaddr, *ifa;
+    if (getifaddrs(&ifaddr) == -1) return false;
+
+    bool found = false;
+    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == NULL) continue;
+        if (ifa->ifa_addr->sa_family != AF_INET) continue;
+        if (((struct sockaddr_in*)ifa->ifa_addr)->sin_addr.s_addr == target.s_addr) {
+            found = true;
+            break;
+        }
+    }
+
+    freeifaddrs(ifaddr);
+    return found;
+#endif
+}
+
 bool parse_address(const char* addr, char* out_ip, uint16_t* out_port) {
     if (!addr || !out_ip || !out_port) return false;
 
@@ -111,6 +152,28 @@ uint64_t get_time_ms(void) {
 #endif
 }
 
+uint64_t get_time_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / freq.QuadPart) * 1000000 +
+           (uint64_t)(counter.QuadPart % freq.QuadPart) * 1000000 / (uint64_t)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+uint64_t lan_current_thread_id(void) {
+#ifdef _WIN32
+    return (uint64_t)GetCurrentThreadId();
+#else
+    return (uint64_t)(uintptr_t)pthread_self();
+#endif
+}
+
 // CRC32 lookup table
 static uint32_t crc32_table[256];
 static bool crc32_table_initialized = false;
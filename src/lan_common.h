@@ -25,15 +25,47 @@ void format_address(char* out, int out_size, const char* ip, uint16_t port);
  */
 uint64_t get_time_ms(void);
 
+/**
+ * Get current time in microseconds (QueryPerformanceCounter /
+ * CLOCK_MONOTONIC).
+ */
+uint64_t get_time_us(void);
+
+/**
+ * Identifier of the calling thread (never 0). Used to tell whether two
+ * in-process instances are driven from the same thread.
+ */
+uint64_t lan_current_thread_id(void);
+
 /**
  * CRC32 checksum.
  */
 uint32_t crc32(const void* data, size_t len);
 
+/**
+ * Check whether an IPv4 address belongs to this machine (loopback or the
+ * address of any local interface).
+ */
+bool is_local_address(const char* ip);
+
 /**
  * Check if localhost discovery mode should be enabled.
  * Returns true if EOSLAN_LOCALHOST_MODE env var is set to non-zero.
  */
 bool should_use_localhost_mode(void);
 
+// Minimal 32-bit atomics for the lock-free rings shared between threads (and,
+// for lan_shm, between processes). Windows users of these must include
+// <windows.h> (winsock2.h does).
+#ifdef _WIN32
+#define LAN_LOAD_ACQUIRE(p) ((uint32_t)InterlockedCompareExchange((volatile LONG*)(p), 0, 0))
+#define LAN_STORE_RELEASE(p, v) InterlockedExchange((volatile LONG*)(p), (LONG)(v))
+#define LAN_CAS(p, expected, desired) \
+    (InterlockedCompareExchange((volatile LONG*)(p), (LONG)(desired), (LONG)(expected)) == (LONG)(expected))
+#else
+#define LAN_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LAN_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define LAN_CAS(p, expected, desired) __sync_bool_compare_and_swap((p), (expected), (desired))
+#endif
+
 #endif // EOS_LAN_COMMON_H
@@ -1,5 +1,10 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // recvmmsg
+#endif
 #include "internal/lan_discovery.h"
 #include "lan_common.h"
+#include "lan_netem.h"
+#include "lan_capture.h"
 #include "internal/sessions_internal.h"
 #include "internal/logging.h"
 #include <string.h>
@@ -36,6 +41,15 @@ typedef int socklen_t;
  * the client parsed 0 attributes. Loopback/LAN UDP handles larger datagrams. */
 #define MAX_PACKET_SIZE 65536
 
+// discovery_poll reads up to this many datagrams per recvmmsg on Linux (one
+// recvfrom each elsewhere).
+#ifdef __linux__
+#define DISCOVERY_USE_MMSG 1
+#define DISCOVERY_RECV_BATCH 8
+#else
+#define DISCOVERY_RECV_BATCH 1
+#endif
+
 typedef struct {
     Session session;
     char source_ip[16];
@@ -52,6 +66,8 @@ struct DiscoveryService {
     char broadcast_addr[16];
     bool localhost_mode;  // Enable localhost unicast for Wine/Proton
     bool query_received;  // Flag to indicate a query was received and we should broadcast
+    char local_ip[16];     // source address for in-process handover
+    uint64_t poll_thread;  // thread that last called discovery_poll (0 = never)
 
     CachedSession cache[MAX_CACHED_SESSIONS];
     int cache_count;
@@ -59,10 +75,33 @@ struct DiscoveryService {
     UserBeacon user_cache[MAX_USER_BEACONS];
     int user_count;
 
-    uint8_t recv_buffer[MAX_PACKET_SIZE];
+    uint8_t recv_buffer[DISCOVERY_RECV_BATCH][MAX_PACKET_SIZE];
     uint8_t send_buffer[MAX_PACKET_SIZE];
+
+    LanNetem* netem;  // emulated conditions on sends (EOSLAN_NETEM), or NULL
+    LanCapture* capture;  // EOSLAN_CAPTURE, or NULL
+    LanReplay* replay;    // EOSLAN_REPLAY (stands in for the socket), or NULL
 };
 
+// Services created in this process. A broadcast is also handed straight to
+// the other services on its port that poll on the sending thread, so
+// platforms sharing a process see each other's sessions, lobbies and users
+// without waiting for the datagram to come back through the socket. The
+// datagram is still sent for other processes; its later arrival just
+// refreshes the same cache entry.
+#define MAX_LOCAL_SERVICES 16
+static DiscoveryService* g_local_services[MAX_LOCAL_SERVICES];
+static volatile uint32_t g_local_services_lock;
+
+static void local_services_lock(void) {
+    while (!LAN_CAS(&g_local_services_lock, 0, 1)) {
+    }
+}
+
+static void local_services_unlock(void) {
+    LAN_STORE_RELEASE(&g_local_services_lock, 0);
+}
+
 // Helper function to serialize session attribute
 static int serialize_attribute(uint8_t* buf, const SessionAttribute* attr) {
     int offset = 0;
@@ -304,6 +343,132 @@ static void add_user_to_cache(DiscoveryService* ds, const UserBeacon* user, cons
     }
 }
 
+static bool parse_user_beacon(const uint8_t* buf, int len, UserBeacon* user) {
+    int offset = 0;
+    memset(user, 0, sizeof(*user));
+
+    if (offset + 33 + 33 + 24 + PEER_DISPLAY_NAME_LEN + PRESENCE_JOININFO_LEN + 1 > len) return false;
+    memcpy(user->epic_id, buf + offset, 32); user->epic_id[32] = '\0'; offset += 33;
+    memcpy(user->puid, buf + offset, 32); user->puid[32] = '\0'; offset += 33;
+    memcpy(user->steam_id, buf + offset, 23); user->steam_id[23] = '\0'; offset += 24;
+    memcpy(user->display_name, buf + offset, PEER_DISPLAY_NAME_LEN);
+    user->display_name[PEER_DISPLAY_NAME_LEN - 1] = '\0'; offset += PEER_DISPLAY_NAME_LEN;
+    memcpy(user->join_info, buf + offset, PRESENCE_JOININFO_LEN);
+    user->join_info[PRESENCE_JOININFO_LEN - 1] = '\0'; offset += PRESENCE_JOININFO_LEN;
+
+    uint8_t prec_count = buf[offset++];
+    if (prec_count > MAX_PRESENCE_RECORDS) prec_count = MAX_PRESENCE_RECORDS;
+    for (int i = 0; i < prec_count; i++) {
+        if (offset + PRESENCE_KEY_LEN + PRESENCE_VALUE_LEN > len) return false;
+        memcpy(user->records[i].key, buf + offset, PRESENCE_KEY_LEN);
+        user->records[i].key[PRESENCE_KEY_LEN - 1] = '\0';
+        offset += PRESENCE_KEY_LEN;
+        memcpy(user->records[i].value, buf + offset, PRESENCE_VALUE_LEN);
+        user->records[i].value[PRESENCE_VALUE_LEN - 1] = '\0';
+        offset += PRESENCE_VALUE_LEN;
+        user->record_count++;
+    }
+    user->valid = true;
+    return true;
+}
+
+// Parse one discovery datagram and update the caches
+static void handle_datagram(DiscoveryService* ds, const uint8_t* buf, int len, const char* source_ip) {
+    // Parse header
+    if (len < 9) return;
+    if (memcmp(buf, DISCOVERY_MAGIC, 6) != 0) return;
+
+    uint16_t version = ntohs(*(const uint16_t*)(buf + 6));
+    if (version != DISCOVERY_VERSION) return;
+
+    uint8_t msg_type = buf[8];
+
+    if (msg_type == MSG_ANNOUNCE) {
+        Session session;
+        if (parse_announcement(buf + 9, len - 9, &session)) {
+            EOS_LOG_DEBUG("Received session announcement from %s: %s", source_ip, session.session_name);
+
+            // Add to cache
+            add_to_cache(ds, &session, source_ip);
+        }
+    } else if (msg_type == MSG_QUERY) {
+        // Another instance is searching - set flag to trigger immediate broadcast
+        ds->query_received = true;
+        EOS_LOG_DEBUG("Received query from peer, will broadcast sessions immediately");
+    } else if (msg_type == MSG_USER_BEACON) {
+        UserBeacon user;
+        if (parse_user_beacon(buf + 9, len - 9, &user)) {
+            add_user_to_cache(ds, &user, source_ip);
+        }
+    }
+}
+
+// Write a datagram to the socket (recording it first). A replay discards it.
+static void wire_send(DiscoveryService* ds, const struct sockaddr_in* dest,
+                      const uint8_t* buf, int len) {
+    lan_capture_write(ds->capture, LAN_CAPTURE_OUT, (uint32_t)dest->sin_addr.s_addr, dest->sin_port,
+                      buf, (uint32_t)len);
+    if (ds->replay) return;
+    sendto(ds->socket_fd, (const char*)buf, len, 0, (const struct sockaddr*)dest, sizeof(*dest));
+}
+
+// One datagram onto the wire, unless the emulator drops or holds it back
+// (discovery_poll sends the held ones once they are due).
+static void send_datagram(DiscoveryService* ds, const struct sockaddr_in* dest,
+                          const uint8_t* buf, int len) {
+    if (ds->netem && lan_netem_submit(ds->netem, (uint32_t)dest->sin_addr.s_addr, dest->sin_port,
+                                      buf, (uint32_t)len, get_time_ms())) {
+        return;
+    }
+    wire_send(ds, dest, buf, len);
+}
+
+// Handle a datagram read from the socket (or the replayed capture).
+static void receive_datagram(DiscoveryService* ds, const uint8_t* buf, int len,
+                             const struct sockaddr_in* from) {
+    lan_capture_write(ds->capture, LAN_CAPTURE_IN, (uint32_t)from->sin_addr.s_addr, from->sin_port,
+                      buf, (uint32_t)len);
+    char source_ip[16];
+    inet_ntop(AF_INET, &from->sin_addr, source_ip, sizeof(source_ip));
+    handle_datagram(ds, buf, len, source_ip);
+}
+
+// Send a datagram to the broadcast address (and loopback broadcast in
+// localhost mode), handing it to same-thread in-process services first.
+// Under EOSLAN_NETEM, EOSLAN_CAPTURE or EOSLAN_REPLAY the handover is
+// skipped, so in-process peers see the emulated conditions and every
+// datagram is on the wire to be recorded.
+static void broadcast_datagram(DiscoveryService* ds, const uint8_t* buf, int len) {
+    if (!ds->netem && !ds->capture && !ds->replay) {
+        uint64_t thread = lan_current_thread_id();
+        local_services_lock();
+        for (int i = 0; i < MAX_LOCAL_SERVICES; i++) {
+            DiscoveryService* peer = g_local_services[i];
+            if (!peer || peer == ds || peer->port != ds->port) continue;
+            if (peer->poll_thread != thread) continue;
+            handle_datagram(peer, buf, len, ds->local_ip);
+        }
+        local_services_unlock();
+    }
+
+    struct sockaddr_in dest = {0};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(ds->port);
+    inet_pton(AF_INET, ds->broadcast_addr, &dest.sin_addr);
+    send_datagram(ds, &dest, buf, len);
+
+    // If localhost mode, also send to loopback broadcast for Wine/Proton support
+    if (ds->localhost_mode) {
+        struct sockaddr_in lo = {0};
+        lo.sin_family = AF_INET;
+        lo.sin_port = htons(ds->port);
+        // Use loopback broadcast (127.255.255.255) instead of unicast (127.0.0.1)
+        // This allows packets to reach all sockets bound to the port on loopback
+        inet_pton(AF_INET, "127.255.255.255", &lo.sin_addr);
+        send_datagram(ds, &lo, buf, len);
+    }
+}
+
 void discovery_broadcast_user(DiscoveryService* ds, const UserBeacon* user) {
     if (!ds || !user) return;
 
@@ -337,48 +502,7 @@ void discovery_broadcast_user(DiscoveryService* ds, const UserBeacon* user) {
         offset += PRESENCE_VALUE_LEN;
     }
 
-    struct sockaddr_in dest = {0};
-    dest.sin_family = AF_INET;
-    dest.sin_port = htons(ds->port);
-    inet_pton(AF_INET, ds->broadcast_addr, &dest.sin_addr);
-    sendto(ds->socket_fd, (const char*)buf, offset, 0, (struct sockaddr*)&dest, sizeof(dest));
-
-    if (ds->localhost_mode) {
-        struct sockaddr_in lo = {0};
-        lo.sin_family = AF_INET;
-        lo.sin_port = htons(ds->port);
-        inet_pton(AF_INET, "127.255.255.255", &lo.sin_addr);
-        sendto(ds->socket_fd, (const char*)buf, offset, 0, (struct sockaddr*)&lo, sizeof(lo));
-    }
-}
-
-static bool parse_user_beacon(const uint8_t* buf, int len, UserBeacon* user) {
-    int offset = 0;
-    memset(user, 0, sizeof(*user));
-
-    if (offset + 33 + 33 + 24 + PEER_DISPLAY_NAME_LEN + PRESENCE_JOININFO_LEN + 1 > len) return false;
-    memcpy(user->epic_id, buf + offset, 32); user->epic_id[32] = '\0'; offset += 33;
-    memcpy(user->puid, buf + offset, 32); user->puid[32] = '\0'; offset += 33;
-    memcpy(user->steam_id, buf + offset, 23); user->steam_id[23] = '\0'; offset += 24;
-    memcpy(user->display_name, buf + offset, PEER_DISPLAY_NAME_LEN);
-    user->display_name[PEER_DISPLAY_NAME_LEN - 1] = '\0'; offset += PEER_DISPLAY_NAME_LEN;
-    memcpy(user->join_info, buf + offset, PRESENCE_JOININFO_LEN);
-    user->join_info[PRESENCE_JOININFO_LEN - 1] = '\0'; offset += PRESENCE_JOININFO_LEN;
-
-    uint8_t prec_count = buf[offset++];
-    if (prec_count > MAX_PRESENCE_RECORDS) prec_count = MAX_PRESENCE_RECORDS;
-    for (int i = 0; i < prec_count; i++) {
-        if (offset + PRESENCE_KEY_LEN + PRESENCE_VALUE_LEN > len) return false;
-        memcpy(user->records[i].key, buf + offset, PRESENCE_KEY_LEN);
-        user->records[i].key[PRESENCE_KEY_LEN - 1] = '\0';
-        offset += PRESENCE_KEY_LEN;
-        memcpy(user->records[i].value, buf + offset, PRESENCE_VALUE_LEN);
-        user->records[i].value[PRESENCE_VALUE_LEN - 1] = '\0';
-        offset += PRESENCE_VALUE_LEN;
-        user->record_count++;
-    }
-    user->valid = true;
-    return true;
+    broadcast_datagram(ds, buf, offset);
 }
 
 UserBeacon* discovery_get_users(DiscoveryService* ds, int* out_count) {
@@ -454,16 +578,39 @@ DiscoveryService* discovery_create(uint16_t port) {
     fcntl(ds->socket_fd, F_SETFL, flags | O_NONBLOCK);
 #endif
 
+    get_local_ip(ds->local_ip, sizeof(ds->local_ip));
+    ds->netem = lan_netem_create("OUT");
+    ds->capture = lan_capture_open(LAN_CAPTURE_DISCOVERY, ds->port);
+    ds->replay = lan_replay_open(LAN_CAPTURE_DISCOVERY, ds->port);
+
+    local_services_lock();
+    for (int i = 0; i < MAX_LOCAL_SERVICES; i++) {
+        if (!g_local_services[i]) {
+            g_local_services[i] = ds;
+            break;
+        }
+    }
+    local_services_unlock();
+
     return ds;
 }
 
 void discovery_destroy(DiscoveryService* ds) {
     if (!ds) return;
 
+    local_services_lock();
+    for (int i = 0; i < MAX_LOCAL_SERVICES; i++) {
+        if (g_local_services[i] == ds) g_local_services[i] = NULL;
+    }
+    local_services_unlock();
+
     if (ds->socket_fd >= 0) {
         close(ds->socket_fd);
     }
 
+    lan_netem_destroy(ds->netem);
+    lan_capture_close(ds->capture);
+    lan_replay_close(ds->replay);
     free(ds);
 }
 
@@ -538,24 +685,7 @@ void discovery_broadcast_session(DiscoveryService* ds, const Session* session) {
     }
     *(uint16_t*)attr_count_field = htons((uint16_t)attrs_written);
 
-    // Send broadcast
-    struct sockaddr_in dest = {0};
-    dest.sin_family = AF_INET;
-    dest.sin_port = htons(ds->port);
-    inet_pton(AF_INET, ds->broadcast_addr, &dest.sin_addr);
-
-    sendto(ds->socket_fd, (const char*)buf, offset, 0, (struct sockaddr*)&dest, sizeof(dest));
-
-    // If localhost mode, also send to loopback broadcast for Wine/Proton support
-    if (ds->localhost_mode) {
-        struct sockaddr_in lo = {0};
-        lo.sin_family = AF_INET;
-        lo.sin_port = htons(ds->port);
-        // Use loopback broadcast (127.255.255.255) instead of unicast (127.0.0.1)
-        // This allows packets to reach all sockets bound to the port on loopback
-        inet_pton(AF_INET, "127.255.255.255", &lo.sin_addr);
-        sendto(ds->socket_fd, (const char*)buf, offset, 0, (struct sockaddr*)&lo, sizeof(lo));
-    }
+    broadcast_datagram(ds, buf, offset);
 }
 
 void discovery_send_query(DiscoveryService* ds, const char* bucket_filter) {
@@ -579,34 +709,79 @@ void discovery_send_query(DiscoveryService* ds, const char* bucket_filter) {
     }
     offset += 256;
 
-    // Send broadcast
-    struct sockaddr_in dest = {0};
-    dest.sin_family = AF_INET;
-    dest.sin_port = htons(ds->port);
-    inet_pton(AF_INET, ds->broadcast_addr, &dest.sin_addr);
-
-    sendto(ds->socket_fd, (const char*)buf, offset, 0, (struct sockaddr*)&dest, sizeof(dest));
-
-    // If localhost mode, also send to loopback broadcast for Wine/Proton support
-    if (ds->localhost_mode) {
-        struct sockaddr_in lo = {0};
-        lo.sin_family = AF_INET;
-        lo.sin_port = htons(ds->port);
-        // Use loopback broadcast (127.255.255.255) instead of unicast (127.0.0.1)
-        inet_pton(AF_INET, "127.255.255.255", &lo.sin_addr);
-        sendto(ds->socket_fd, (const char*)buf, offset, 0, (struct sockaddr*)&lo, sizeof(lo));
-    }
+    broadcast_datagram(ds, buf, offset);
 }
 
 void discovery_poll(DiscoveryService* ds) {
     if (!ds) return;
 
+    ds->poll_thread = lan_current_thread_id();
+
+    // Broadcasts the emulator has held back long enough. Sends and polls
+    // both run on the game thread, so the send buffer is free here.
+    if (ds->netem) {
+        uint64_t now = get_time_ms();
+        uint32_t ip;
+        uint16_t port;
+        int len;
+        while ((len = lan_netem_release(ds->netem, now, ds->send_buffer, MAX_PACKET_SIZE,
+                                        &ip, &port)) >= 0) {
+            struct sockaddr_in dest = {0};
+            dest.sin_family = AF_INET;
+            dest.sin_port = port;
+            dest.sin_addr.s_addr = ip;
+            wire_send(ds, &dest, ds->send_buffer, len);
+        }
+    }
+
+    // Replaying a capture: its received datagrams stand in for the socket.
+    if (ds->replay) {
+        uint32_t ip;
+        uint16_t port;
+        uint8_t direction;
+        int len;
+        while ((len = lan_replay_next(ds->replay, ds->recv_buffer[0], MAX_PACKET_SIZE,
+                                      &ip, &port, &direction)) >= 0) {
+            if (direction != LAN_CAPTURE_IN) continue;
+            struct sockaddr_in from = {0};
+            from.sin_family = AF_INET;
+            from.sin_port = port;
+            from.sin_addr.s_addr = ip;
+            receive_datagram(ds, ds->recv_buffer[0], len, &from);
+        }
+        return;
+    }
+
+#ifdef DISCOVERY_USE_MMSG
+    struct mmsghdr msgs[DISCOVERY_RECV_BATCH];
+    struct iovec iov[DISCOVERY_RECV_BATCH];
+    struct sockaddr_in froms[DISCOVERY_RECV_BATCH];
+
+    while (true) {
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < DISCOVERY_RECV_BATCH; i++) {
+            iov[i].iov_base = ds->recv_buffer[i];
+            iov[i].iov_len = MAX_PACKET_SIZE;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &froms[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(froms[i]);
+        }
+        int count = recvmmsg(ds->socket_fd, msgs, DISCOVERY_RECV_BATCH, MSG_DONTWAIT, NULL);
+        if (count <= 0) break;
+
+        for (int i = 0; i < count; i++) {
+            receive_datagram(ds, ds->recv_buffer[i], (int)msgs[i].msg_len, &froms[i]);
+        }
+        if (count < DISCOVERY_RECV_BATCH) break;  // socket drained
+    }
+#else
     struct sockaddr_in from;
     socklen_t from_len = sizeof(from);
 
     while (true) {
 #ifdef _WIN32
-        int len = recvfrom(ds->socket_fd, (char*)ds->recv_buffer, MAX_PACKET_SIZE, 0,
+        int len = recvfrom(ds->socket_fd, (char*)ds->recv_buffer[0], MAX_PACKET_SIZE, 0,
                           (struct sockaddr*)&from, &from_len);
         if (len == SOCKET_ERROR) {
             int err = WSAGetLastError();
@@ -614,7 +789,7 @@ void discovery_poll(DiscoveryService* ds) {
             break;
         }
 #else
-        ssize_t len = recvfrom(ds->socket_fd, ds->recv_buffer, MAX_PACKET_SIZE, 0,
+        ssize_t len = recvfrom(ds->socket_fd, ds->recv_buffer[0], MAX_PACKET_SIZE, 0,
                                (struct sockaddr*)&from, &from_len);
         if (len <= 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) break;
@@ -622,40 +797,9 @@ void discovery_poll(DiscoveryService* ds) {
         }
 #endif
 
-        // Parse header
-        if (len < 9) continue;
-        if (memcmp(ds->recv_buffer, DISCOVERY_MAGIC, 6) != 0) continue;
-
-        uint16_t version = ntohs(*(uint16_t*)(ds->recv_buffer + 6));
-        if (version != DISCOVERY_VERSION) continue;
-
-        uint8_t msg_type = ds->recv_buffer[8];
-
-        if (msg_type == MSG_ANNOUNCE) {
-            Session session;
-            if (parse_announcement(ds->recv_buffer + 9, len - 9, &session)) {
-                // Get source IP
-                char source_ip[16];
-                inet_ntop(AF_INET, &from.sin_addr, source_ip, sizeof(source_ip));
-
-                EOS_LOG_DEBUG("Received session announcement from %s: %s", source_ip, session.session_name);
-
-                // Add to cache
-                add_to_cache(ds, &session, source_ip);
-            }
-        } else if (msg_type == MSG_QUERY) {
-            // Another instance is searching - set flag to trigger immediate broadcast
-            ds->query_received = true;
-            EOS_LOG_DEBUG("Received query from peer, will broadcast sessions immediately");
-        } else if (msg_type == MSG_USER_BEACON) {
-            UserBeacon user;
-            if (parse_user_beacon(ds->recv_buffer + 9, (int)(len - 9), &user)) {
-                char source_ip[16];
-                inet_ntop(AF_INET, &from.sin_addr, source_ip, sizeof(source_ip));
-                add_user_to_cache(ds, &user, source_ip);
-            }
-        }
+        receive_datagram(ds, ds->recv_buffer[0], (int)len, &from);
     }
+#endif
 }
 
 Session* discovery_get_sessions(DiscoveryService* ds, int* out_count) {
@@ -0,0 +1,311 @@
+#include "lan_netem.h"
+#include "lan_common.h"
+#include "internal/logging.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NETEM_SPEC_MAX 256
+#define NETEM_DEFAULT_LIMIT 1000
+#define NETEM_DEFAULT_BURST_R 25.0
+#define NETEM_DEFAULT_BURST_LOSS 100.0
+
+// A held datagram. Ties on release time go out in submission order.
+typedef struct {
+    uint64_t due;
+    uint64_t seq;
+    uint32_t ip;
+    uint16_t port;
+    uint32_t len;
+    uint8_t data[];
+} NetemPacket;
+
+struct LanNetem {
+    char direction[4];
+
+    // Conditions (percentages are 0..100)
+    double delay_ms;
+    double jitter_ms;
+    double loss;
+    double burst_p;
+    double burst_r;
+    double burst_loss;
+    double reorder;
+    double dup;
+    double rate;           // bytes per second, 0 = unlimited
+    uint32_t limit;
+    bool has_peer;
+    uint32_t peer_ip;      // network byte order
+    uint16_t peer_port;    // host byte order, 0 = any port
+
+    uint64_t rng;
+    bool bad;              // Gilbert-Elliott state
+    double link_free_at;   // when the rate-capped link finishes its last datagram (ms)
+
+    // Min-heap on (due, seq)
+    NetemPacket** heap;
+    uint32_t count;
+    uint64_t next_seq;
+
+    uint64_t stat_packets;
+    uint64_t stat_dropped;
+    uint64_t stat_duplicated;
+};
+
+// xorshift64*: cheap, and repeatable for a given seed=.
+static double netem_random(LanNetem* em) {
+    em->rng ^= em->rng >> 12;
+    em->rng ^= em->rng << 25;
+    em->rng ^= em->rng >> 27;
+    return (double)((em->rng * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+}
+
+static bool netem_chance(LanNetem* em, double percent) {
+    return percent > 0 && netem_random(em) * 100.0 < percent;
+}
+
+// Byte-wise so both sides of the comparison are independent of host order.
+static uint16_t port_from_network(uint16_t port) {
+    const uint8_t* p = (const uint8_t*)&port;
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static bool parse_peer(LanNetem* em, const char* value) {
+    unsigned a, b, c, d, port = 0;
+    int n = sscanf(value, "%u.%u.%u.%u:%u", &a, &b, &c, &d, &port);
+    if (n < 4 || a > 255 || b > 255 || c > 255 || d > 255 || port > 65535) return false;
+    uint8_t ip[4] = {(uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d};
+    memcpy(&em->peer_ip, ip, 4);
+    em->peer_port = (uint16_t)port;
+    em->has_peer = true;
+    return true;
+}
+
+static void parse_spec(LanNetem* em, const char* spec) {
+    char buf[NETEM_SPEC_MAX];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    for (char* tok = buf; tok; ) {
+        char* next = strchr(tok, ',');
+        if (next) *next++ = '\0';
+        while (*tok == ' ') tok++;
+        if (!*tok) {
+            tok = next;
+            continue;
+        }
+        char* eq = strchr(tok, '=');
+        if (!eq) {
+            EOS_LOG_WARN("NETEM: ignoring '%s' (expected key=value)", tok);
+            tok = next;
+            continue;
+        }
+        *eq = '\0';
+        const char* key = tok;
+        const char* value = eq + 1;
+        tok = next;
+
+        if (strcmp(key, "peer") == 0) {
+            if (!parse_peer(em, value)) EOS_LOG_WARN("NETEM: bad peer address '%s'", value);
+            continue;
+        }
+
+        char* end;
+        double v = strtod(value, &end);
+        if (end == value || v < 0) {
+            EOS_LOG_WARN("NETEM: bad value for %s: '%s'", key, value);
+            continue;
+        }
+        if (strcmp(key, "delay") == 0) em->delay_ms = v;
+        else if (strcmp(key, "jitter") == 0) em->jitter_ms = v;
+        else if (strcmp(key, "loss") == 0) em->loss = v;
+        else if (strcmp(key, "burst_p") == 0) em->burst_p = v;
+        else if (strcmp(key, "burst_r") == 0) em->burst_r = v;
+        else if (strcmp(key, "burst_loss") == 0) em->burst_loss = v;
+        else if (strcmp(key, "reorder") == 0) em->reorder = v;
+        else if (strcmp(key, "dup") == 0) em->dup = v;
+        else if (strcmp(key, "rate") == 0) em->rate = v;
+        else if (strcmp(key, "limit") == 0) em->limit = (uint32_t)v;
+        else if (strcmp(key, "seed") == 0) em->rng = (uint64_t)v;
+        else EOS_LOG_WARN("NETEM: unknown key '%s'", key);
+    }
+}
+
+LanNetem* lan_netem_create(const char* direction) {
+    char name[32];
+    snprintf(name, sizeof(name), "EOSLAN_NETEM_%s", direction);
+    const char* spec = getenv(name);
+    if (!spec || !*spec) spec = getenv("EOSLAN_NETEM");
+    if (!spec || !*spec) return NULL;
+
+    LanNetem* em = calloc(1, sizeof(LanNetem));
+    if (!em) return NULL;
+    snprintf(em->direction, sizeof(em->direction), "%s", direction);
+    em->burst_r = NETEM_DEFAULT_BURST_R;
+    em->burst_loss = NETEM_DEFAULT_BURST_LOSS;
+    em->limit = NETEM_DEFAULT_LIMIT;
+    parse_spec(em, spec);
+
+    if (em->delay_ms == 0 && em->jitter_ms == 0 && em->loss == 0 && em->burst_p == 0 &&
+        em->reorder == 0 && em->dup == 0 && em->rate == 0) {
+        free(em);
+        return NULL;
+    }
+    if (em->limit == 0) em->limit = 1;
+    if (em->rng == 0) em->rng = get_time_ms() ^ (uint64_t)(uintptr_t)em;
+
+    em->heap = calloc(em->limit, sizeof(NetemPacket*));
+    if (!em->heap) {
+        free(em);
+        return NULL;
+    }
+
+    EOS_LOG_INFO("NETEM %s: delay=%gms jitter=%gms loss=%g%% burst=%g/%g%% (loss %g%%) "
+                 "reorder=%g%% dup=%g%% rate=%gB/s limit=%u%s",
+                 em->direction, em->delay_ms, em->jitter_ms, em->loss, em->burst_p,
+                 em->burst_r, em->burst_loss, em->reorder, em->dup, em->rate,
+                 (unsigned)em->limit, em->has_peer ? " (one peer)" : "");
+    return em;
+}
+
+void lan_netem_destroy(LanNetem* em) {
+    if (!em) return;
+    EOS_LOG_INFO("NETEM %s: %llu packets, %llu dropped, %llu duplicated, %u still queued",
+                 em->direction, (unsigned long long)em->stat_packets,
+                 (unsigned long long)em->stat_dropped, (unsigned long long)em->stat_duplicated,
+                 (unsigned)em->count);
+    for (uint32_t i = 0; i < em->count; i++) {
+        free(em->heap[i]);
+    }
+    free(em->heap);
+    free(em);
+}
+
+static bool heap_less(const NetemPacket* a, const NetemPacket* b) {
+    return a->due != b->due ? a->due < b->due : a->seq < b->seq;
+}
+
+static void heap_push(LanNetem* em, NetemPacket* pkt) {
+    uint32_t i = em->count++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!heap_less(pkt, em->heap[parent])) break;
+        em->heap[i] = em->heap[parent];
+        i = parent;
+    }
+    em->heap[i] = pkt;
+}
+
+static NetemPacket* heap_pop(LanNetem* em) {
+    NetemPacket* top = em->heap[0];
+    NetemPacket* last = em->heap[--em->count];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= em->count) break;
+        if (child + 1 < em->count && heap_less(em->heap[child + 1], em->heap[child])) child++;
+        if (!heap_less(em->heap[child], last)) break;
+        em->heap[i] = em->heap[child];
+        i = child;
+    }
+    if (em->count > 0) em->heap[i] = last;
+    return top;
+}
+
+// Random loss, or Gilbert-Elliott bursts when burst_p is set: the state
+// moves first, then the packet is lost with the state's loss rate.
+static bool netem_lose(LanNetem* em) {
+    if (em->burst_p > 0) {
+        if (em->bad) {
+            if (netem_chance(em, em->burst_r)) em->bad = false;
+        } else if (netem_chance(em, em->burst_p)) {
+            em->bad = true;
+        }
+        if (em->bad) return netem_chance(em, em->burst_loss);
+    }
+    return netem_chance(em, em->loss);
+}
+
+// Release time of one copy: after the rate-capped link has carried it, plus
+// the (jittered) delay unless it was picked to overtake.
+static uint64_t netem_due(LanNetem* em, uint32_t len, uint64_t now_ms) {
+    double at = (double)now_ms;
+    if (em->rate > 0) {
+        if (em->link_free_at < at) em->link_free_at = at;
+        em->link_free_at += (double)len * 1000.0 / em->rate;
+        at = em->link_free_at;
+    }
+    if (!netem_chance(em, em->reorder)) {
+        double delay = em->delay_ms;
+        if (em->jitter_ms > 0) delay += (netem_random(em) * 2.0 - 1.0) * em->jitter_ms;
+        if (delay > 0) at += delay;
+    }
+    uint64_t due = (uint64_t)(at + 0.5);
+    return due < now_ms ? now_ms : due;
+}
+
+bool lan_netem_submit(LanNetem* em, uint32_t ip, uint16_t port, const uint8_t* data,
+                      uint32_t len, uint64_t now_ms) {
+    if (!em) return false;
+    if (em->has_peer && (ip != em->peer_ip ||
+                         (em->peer_port && port_from_network(port) != em->peer_port))) {
+        return false;
+    }
+
+    em->stat_packets++;
+    if (netem_lose(em)) {
+        em->stat_dropped++;
+        return true;
+    }
+
+    int copies = 1;
+    if (netem_chance(em, em->dup)) {
+        copies = 2;
+        em->stat_duplicated++;
+    }
+
+    bool taken = false;
+    for (int c = 0; c < copies; c++) {
+        uint64_t due = netem_due(em, len, now_ms);
+        // Due now with nothing ahead of it: the caller delivers it as usual.
+        if (c == 0 && due <= now_ms && em->count == 0) continue;
+
+        taken = taken || c == 0;
+        if (em->count >= em->limit) {
+            em->stat_dropped++;  // queue overflow, like a full router buffer
+            continue;
+        }
+        NetemPacket* pkt = malloc(sizeof(NetemPacket) + len);
+        if (!pkt) {
+            em->stat_dropped++;
+            continue;
+        }
+        pkt->due = due;
+        pkt->seq = em->next_seq++;
+        pkt->ip = ip;
+        pkt->port = port;
+        pkt->len = len;
+        if (len > 0) memcpy(pkt->data, data, len);
+        heap_push(em, pkt);
+    }
+    return taken;
+}
+
+int lan_netem_release(LanNetem* em, uint64_t now_ms, uint8_t* buf, uint32_t buf_size,
+                      uint32_t* out_ip, uint16_t* out_port) {
+    if (!em || em->count == 0 || em->heap[0]->due > now_ms) return -1;
+
+    NetemPacket* pkt = heap_pop(em);
+    uint32_t len = pkt->len < buf_size ? pkt->len : buf_size;
+    memcpy(buf, pkt->data, len);
+    *out_ip = pkt->ip;
+    *out_port = pkt->port;
+    free(pkt);
+    return (int)len;
+}
+
+int lan_netem_next_due(LanNetem* em, uint64_t now_ms) {
+    if (!em || em->count == 0) return -1;
+    uint64_t due = em->heap[0]->due;
+    if (due <= now_ms) return 0;
+    return (due - now_ms) > 1000000 ? 1000000 : (int)(due - now_ms);
+}
@@ -0,0 +1,77 @@
+#ifndef EOS_LAN_NETEM_H
+#define EOS_LAN_NETEM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Network condition emulator for the LAN transports.
+ *
+ * Datagrams passed to lan_netem_submit are dropped, duplicated, held back
+ * or let through according to the configured conditions; held ones wait in
+ * a queue ordered by release time and are handed back by lan_netem_release,
+ * which the owner calls from its regular flush / poll - no thread of its
+ * own. Configured with comma-separated key=value pairs:
+ *
+ *   EOSLAN_NETEM       both directions
+ *   EOSLAN_NETEM_OUT   outgoing only (replaces EOSLAN_NETEM for sends)
+ *   EOSLAN_NETEM_IN    incoming only (replaces EOSLAN_NETEM for receives)
+ *
+ *   delay=MS       fixed one-way delay
+ *   jitter=MS      uniform +/- variation on the delay (reorders packets)
+ *   loss=PCT       random loss (in the good state when burst_p is set)
+ *   burst_p=PCT    Gilbert-Elliott: chance per packet of entering the bad state
+ *   burst_r=PCT    chance per packet of leaving it again (default 25)
+ *   burst_loss=PCT loss while in the bad state (default 100)
+ *   reorder=PCT    packets sent at once, overtaking delayed ones
+ *   dup=PCT        packets delivered twice
+ *   rate=BYTES     bandwidth cap per second; excess queues up
+ *   limit=N        queue capacity in packets (default 1000); excess is dropped
+ *   peer=IP[:PORT] only affect traffic to / from this address
+ *   seed=N         random seed, for reproducible runs
+ *
+ * Example: EOSLAN_NETEM=delay=30,jitter=5,loss=1,rate=250000
+ */
+typedef struct LanNetem LanNetem;
+
+/**
+ * Create an emulator for one direction from the environment.
+ *
+ * @param direction "IN" or "OUT"
+ * @return Handle, or NULL if no conditions are configured for that direction
+ */
+LanNetem* lan_netem_create(const char* direction);
+
+/**
+ * Free the emulator and anything still queued in it.
+ */
+void lan_netem_destroy(LanNetem* em);
+
+/**
+ * Pass a datagram through the emulator.
+ *
+ * @param ip Peer IPv4 address, network byte order
+ * @param port Peer port, network byte order
+ * @return true if the emulator took the datagram (queued or dropped); false
+ *         means the caller delivers it now, as it would without emulation
+ */
+bool lan_netem_submit(LanNetem* em, uint32_t ip, uint16_t port, const uint8_t* data,
+                      uint32_t len, uint64_t now_ms);
+
+/**
+ * Take the next queued datagram whose release time has come.
+ *
+ * @param out_ip / out_port Receive the peer address given to lan_netem_submit
+ * @return Datagram length, or -1 if nothing is due
+ */
+int lan_netem_release(LanNetem* em, uint64_t now_ms, uint8_t* buf, uint32_t buf_size,
+                      uint32_t* out_ip, uint16_t* out_port);
+
+/**
+ * Milliseconds until the next queued datagram is due (0 if one is due now).
+ *
+ * @return -1 if the queue is empty
+ */
+int lan_netem_next_due(LanNetem* em, uint64_t now_ms);
+
+#endif // EOS_LAN_NETEM_H
@@ -1,5 +1,12 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // recvmmsg / sendmmsg
+#endif
 #include "lan_p2p.h"
 #include "lan_common.h"
+#include "lan_shm.h"
+#include "lan_uring.h"
+#include "lan_netem.h"
+#include "lan_capture.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,13 +25,78 @@ typedef int socklen_t;
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/select.h>
+#endif
+
+// Batched socket I/O. On Linux one recvmmsg reads up to P2P_BATCH datagrams
+// and sends are queued and written with one sendmmsg per lan_p2p_flush.
+// Elsewhere every datagram is its own recvfrom / sendto.
+#ifdef __linux__
+#define P2P_USE_MMSG 1
 #endif
+#define P2P_BATCH 32
 
 #define P2P_MAGIC "EOSP2P"
-#define P2P_VERSION 0x01
+// v2: order sequence + piggybacked ACK/selective-ACK bitfield after the sequence
+// v3: connection token after the flags; compact header for DATA/ACK
+#define P2P_VERSION 0x03
+#define P2P_HEADER_SIZE 94
+#define P2P_HEADER_SOCKET_OFFSET 40  // after magic, version, type and sender ID
+#define P2P_HEADER_TOKEN_OFFSET 74   // after the socket name, channel and flags
+
+// Compact header, used once the CONNECT/ACCEPT handshake has exchanged
+// connection tokens. The first byte can't start a full header ('E').
+//   marker(1) type(1) token(4) channel(1) flags(1)
+//   [seq(2) if RELIABLE] [order_seq(2) if ORDERED] [ack(2) ack_bits(4) if HAS_ACK]
+// followed by the payload; its length is whatever is left of the datagram.
+#define P2P_COMPACT_MARKER 0xC3
+#define P2P_COMPACT_HEADER_SIZE 8
 
 #define MAX_P2P_PACKET 4096
 
+// Replay (EOSLAN_REPLAY): how many peer/socket pairs have their connection
+// tokens mapped, and how long a datagram waits for this run to hand out the
+// token it needs.
+#define P2P_REPLAY_TOKENS 64
+#define P2P_REPLAY_WAIT_MS 1000
+
+// Optional receive thread (lan_p2p_start_io_thread). It owns recvfrom and
+// parses each datagram into a slot of a single-producer/single-consumer ring;
+// lan_p2p_recv on the game thread pops slots. Ring size must be a power of 2.
+#define P2P_IO_RING_SLOTS 256
+#define P2P_IO_WAIT_MS 20
+#define P2P_IO_SHM_WAIT_MS 1  // shared-memory inbox has no wakeup; poll it this often
+
+typedef struct {
+    P2PReceivedPacket packet;  // parsed header; packet.data points into buffer
+    uint8_t buffer[MAX_P2P_PACKET];
+} P2PIoSlot;
+
+// The connection token the captured run gave a peer for a socket, and the
+// one this run gave it. Peers address compact packets by our token, so a
+// replayed one is rewritten from the first to the second.
+typedef struct {
+    uint32_t ip;
+    uint16_t port;
+    char socket_name[33];
+    uint32_t captured;
+    uint32_t live;       // 0 until this run sends its own full header
+    bool abandoned;      // waited P2P_REPLAY_WAIT_MS in vain; pass packets as they are
+} P2PReplayToken;
+
+typedef struct {
+    P2PReplayToken tokens[P2P_REPLAY_TOKENS];
+    int token_count;
+
+    // Next received datagram, taken from the capture but not handed out yet
+    uint8_t held[MAX_P2P_PACKET];
+    int held_len;  // -1 = none
+    uint32_t held_ip;
+    uint16_t held_port;
+    uint64_t held_since;
+} P2PReplayState;
+
 struct P2PSocketManager {
 #ifdef _WIN32
     SOCKET socket_fd;
@@ -34,12 +106,69 @@ struct P2PSocketManager {
     uint16_t port;
     char local_ip[16];
 
-    uint8_t recv_buffer[MAX_P2P_PACKET];
+    uint8_t recv_buffer[MAX_P2P_PACKET];  // used when the caller has no buffer to offer
+#ifndef P2P_USE_MMSG
     uint8_t send_buffer[MAX_P2P_PACKET];
+#endif
+
+    // Same-host fast path (NULL when disabled or unavailable)
+    LanShm* shm;
+
+    // io_uring transport (lan_p2p_enable_uring; NULL when off or unavailable)
+    LanUring* uring;
+
+    // Emulated network conditions per direction (EOSLAN_NETEM; NULL when off).
+    // netem_out belongs to the sending game thread, netem_in to whichever
+    // thread receives.
+    LanNetem* netem_out;
+    LanNetem* netem_in;
+
+    // EOSLAN_CAPTURE / EOSLAN_REPLAY (NULL when off). While replaying, the
+    // capture stands in for the sockets, sends are discarded and everything
+    // is received on the game thread.
+    LanCapture* capture;
+    LanReplay* replay;
+    P2PReplayState* replay_state;
+
+    // Multicast receive socket (lan_p2p_join_group), bound to the group port
+    // and shared with other instances on this host; opened on the first join
+    // and closed with the last leave.
+#ifdef _WIN32
+    SOCKET mcast_fd;
+#else
+    int mcast_fd;
+#endif
+    uint16_t mcast_port;
+    int mcast_groups;
 
-    // Last received packet data (for returning to caller)
-    uint8_t last_recv_data[MAX_P2P_PACKET];
-    uint32_t last_recv_len;
+#ifdef P2P_USE_MMSG
+    // Datagrams that arrived in the same recvmmsg as the one handed out,
+    // waiting for the following lan_p2p_recv calls (slot 0 is never used:
+    // the first datagram goes straight into the caller's buffer).
+    uint8_t recv_batch[P2P_BATCH][MAX_P2P_PACKET];
+    struct sockaddr_in recv_batch_from[P2P_BATCH];
+    uint32_t recv_batch_len[P2P_BATCH];
+    int recv_batch_count;
+    int recv_batch_next;
+
+    // Datagrams built by lan_p2p_send, written out by lan_p2p_flush
+    uint8_t send_batch[P2P_BATCH][MAX_P2P_PACKET];
+    struct sockaddr_in send_batch_to[P2P_BATCH];
+    uint32_t send_batch_len[P2P_BATCH];
+    int send_batch_count;
+#endif
+
+    // I/O thread ring (NULL when receiving inline on the game thread)
+    P2PIoSlot* io_ring;
+    volatile uint32_t io_head;    // next slot to consume (game thread writes)
+    volatile uint32_t io_tail;    // next slot to fill (I/O thread writes)
+    volatile uint32_t io_running;
+    bool io_holding;              // caller still owns slot io_head
+#ifdef _WIN32
+    HANDLE io_thread;
+#else
+    pthread_t io_thread;
+#endif
 };
 
 P2PSocketManager* lan_p2p_create(uint16_t base_port) {
@@ -57,6 +186,11 @@ P2PSocketManager* lan_p2p_create(uint16_t base_port) {
 
     P2PSocketManager* mgr = calloc(1, sizeof(P2PSocketManager));
     if (!mgr) return NULL;
+#ifdef _WIN32
+    mgr->mcast_fd = INVALID_SOCKET;
+#else
+    mgr->mcast_fd = -1;
+#endif
 
     // Create UDP socket
     mgr->socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
@@ -121,12 +255,68 @@ P2PSocketManager* lan_p2p_create(uint16_t base_port) {
     // Get local IP
     get_local_ip(mgr->local_ip, sizeof(mgr->local_ip));
 
+    // Shared-memory inbox for instances on this machine, keyed by our port.
+    mgr->shm = lan_shm_create(mgr->port);
+
+    mgr->netem_out = lan_netem_create("OUT");
+    mgr->netem_in = lan_netem_create("IN");
+
+    mgr->capture = lan_capture_open(LAN_CAPTURE_P2P, mgr->port);
+    mgr->replay = lan_replay_open(LAN_CAPTURE_P2P, mgr->port);
+    if (mgr->replay) {
+        mgr->replay_state = calloc(1, sizeof(P2PReplayState));
+        if (mgr->replay_state) {
+            mgr->replay_state->held_len = -1;
+        } else {
+            lan_replay_close(mgr->replay);
+            mgr->replay = NULL;
+        }
+    }
+
     return mgr;
 }
 
 void lan_p2p_destroy(P2PSocketManager* mgr) {
     if (!mgr) return;
 
+    // Stop the I/O thread before its socket goes away; it notices within
+    // one P2P_IO_WAIT_MS wait.
+    if (mgr->io_ring) {
+        LAN_STORE_RELEASE(&mgr->io_running, 0);
+#ifdef _WIN32
+        WaitForSingleObject(mgr->io_thread, INFINITE);
+        CloseHandle(mgr->io_thread);
+#else
+        pthread_join(mgr->io_thread, NULL);
+#endif
+        free(mgr->io_ring);
+        mgr->io_ring = NULL;
+    }
+
+    lan_p2p_flush(mgr);
+
+    lan_uring_destroy(mgr->uring);
+    mgr->uring = NULL;
+
+    lan_netem_destroy(mgr->netem_out);
+    lan_netem_destroy(mgr->netem_in);
+
+    lan_capture_close(mgr->capture);
+    lan_replay_close(mgr->replay);
+    free(mgr->replay_state);
+    mgr->replay_state = NULL;
+
+    lan_shm_destroy(mgr->shm);
+    mgr->shm = NULL;
+
+#ifdef _WIN32
+    if (mgr->mcast_fd != INVALID_SOCKET) {
+#else
+    if (mgr->mcast_fd >= 0) {
+#endif
+        close(mgr->mcast_fd);
+    }
+
 #ifdef _WIN32
     if (mgr->socket_fd != INVALID_SOCKET) {
 #else
@@ -146,18 +336,43 @@ const char* lan_p2p_get_local_ip(P2PSocketManager* mgr) {
     return mgr ? mgr->local_ip : "127.0.0.1";
 }
 
-bool lan_p2p_send(P2PSocketManager* mgr, const P2PSendPacket* packet) {
-    if (!mgr || !packet || !packet->target_addr) return false;
+static void put_u16(uint8_t* p, uint16_t v) { v = htons(v); memcpy(p, &v, 2); }
+static void put_u32(uint8_t* p, uint32_t v) { v = htonl(v); memcpy(p, &v, 4); }
+static uint16_t get_u16(const uint8_t* p) { uint16_t v; memcpy(&v, p, 2); return ntohs(v); }
+static uint32_t get_u32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return ntohl(v); }
 
-    // Parse target address "IP:port"
-    char ip[16];
-    uint16_t port;
-    if (!parse_address(packet->target_addr, ip, &port)) {
-        return false;
+static uint8_t packet_flags(const P2PSendPacket* packet) {
+    uint8_t flags = 0;
+    if (packet->reliable) flags |= P2P_FLAG_RELIABLE;
+    if (packet->ordered) flags |= P2P_FLAG_ORDERED;
+    if (packet->has_ack) flags |= P2P_FLAG_HAS_ACK;
+    if (packet->compressed) flags |= P2P_FLAG_COMPRESSED;
+    return flags;
+}
+
+// Compact header: token + channel + flags, optional fields only when flagged.
+static int build_compact_header(uint8_t* buf, const P2PSendPacket* packet) {
+    int offset = 0;
+    uint8_t flags = packet_flags(packet);
+    buf[offset++] = P2P_COMPACT_MARKER;
+    buf[offset++] = packet->message_type;
+    put_u32(buf + offset, packet->token); offset += 4;
+    buf[offset++] = packet->channel;
+    buf[offset++] = flags;
+    if (flags & P2P_FLAG_RELIABLE) {
+        put_u16(buf + offset, (uint16_t)packet->sequence); offset += 2;
+    }
+    if (flags & P2P_FLAG_ORDERED) {
+        put_u16(buf + offset, packet->order_sequence); offset += 2;
     }
+    if (flags & P2P_FLAG_HAS_ACK) {
+        put_u16(buf + offset, packet->ack); offset += 2;
+        put_u32(buf + offset, packet->ack_bits); offset += 4;
+    }
+    return offset;
+}
 
-    // Build packet
-    uint8_t* buf = mgr->send_buffer;
+static int build_full_header(uint8_t* buf, const P2PSendPacket* packet) {
     int offset = 0;
 
     // Header: magic + version + message_type
@@ -183,70 +398,374 @@ bool lan_p2p_send(P2PSocketManager* mgr, const P2PSendPacket* packet) {
     buf[offset++] = packet->channel;
 
     // Flags
-    uint8_t flags = 0;
-    if (packet->reliable) flags |= 0x01;
-    buf[offset++] = flags;
+    buf[offset++] = packet_flags(packet);
+
+    // Sender's connection token
+    put_u32(buf + offset, packet->token); offset += 4;
 
     // Sequence number
-    *(uint32_t*)(buf + offset) = htonl(packet->sequence); offset += 4;
+    put_u32(buf + offset, packet->sequence); offset += 4;
+
+    // Order sequence + ACK block (zero unless the matching flag is set)
+    put_u16(buf + offset, packet->order_sequence); offset += 2;
+    put_u16(buf + offset, packet->has_ack ? packet->ack : 0); offset += 2;
+    put_u32(buf + offset, packet->has_ack ? packet->ack_bits : 0); offset += 4;
 
     // Data length
-    *(uint32_t*)(buf + offset) = htonl(packet->data_len); offset += 4;
+    put_u32(buf + offset, packet->data_len); offset += 4;
+    return offset;
+}
 
-    // Payload
-    if (packet->data && packet->data_len > 0) {
-        if (packet->data_len > MAX_P2P_PACKET - offset) {
-            return false;  // Too large
+// Replay: note the connection token in a full header sent to a peer, by
+// the captured run (from the capture) or by this one (from transmit).
+static void replay_note_token(P2PReplayState* rs, const uint8_t* buf, int len,
+                              uint32_t ip, uint16_t port, bool live) {
+    if (len < P2P_HEADER_SIZE || memcmp(buf, P2P_MAGIC, 6) != 0) return;
+    uint32_t token = get_u32(buf + P2P_HEADER_TOKEN_OFFSET);
+    if (token == 0) return;
+    char socket_name[33];
+    memcpy(socket_name, buf + P2P_HEADER_SOCKET_OFFSET, 32);
+    socket_name[32] = '\0';
+
+    P2PReplayToken* t = NULL;
+    for (int i = 0; i < rs->token_count; i++) {
+        P2PReplayToken* e = &rs->tokens[i];
+        if (e->ip == ip && e->port == port && strcmp(e->socket_name, socket_name) == 0) {
+            t = e;
+            break;
         }
-        memcpy(buf + offset, packet->data, packet->data_len);
-        offset += packet->data_len;
+    }
+    if (!t) {
+        if (rs->token_count == P2P_REPLAY_TOKENS) return;
+        t = &rs->tokens[rs->token_count++];
+        memset(t, 0, sizeof(*t));
+        t->ip = ip;
+        t->port = port;
+        memcpy(t->socket_name, socket_name, sizeof(t->socket_name));
     }
 
-    // Send
-    struct sockaddr_in dest = {0};
-    dest.sin_family = AF_INET;
-    dest.sin_port = htons(port);
-    inet_pton(AF_INET, ip, &dest.sin_addr);
+    // Either run may get to the handshake first. The latest token on each
+    // side wins, so a reconnect maps onto this run's newest connection.
+    if (live) {
+        t->live = token;
+        t->abandoned = false;
+    } else {
+        t->captured = token;
+    }
+}
+
+// Our multicast sends leave through the main socket and memberships are
+// taken on the interface it uses (the local IP, when one was found).
+static struct in_addr mcast_interface(P2PSocketManager* mgr) {
+    struct in_addr iface;
+    if (inet_pton(AF_INET, mgr->local_ip, &iface) != 1) iface.s_addr = htonl(INADDR_ANY);
+    return iface;
+}
 
+bool lan_p2p_open_multicast(P2PSocketManager* mgr, uint16_t port) {
+    if (!mgr || port == 0) return false;
 #ifdef _WIN32
-    int sent = sendto(mgr->socket_fd, (const char*)buf, offset, 0, (struct sockaddr*)&dest, sizeof(dest));
-    return sent == offset;
+    if (mgr->mcast_fd != INVALID_SOCKET) return true;
 #else
-    ssize_t sent = sendto(mgr->socket_fd, buf, offset, 0, (struct sockaddr*)&dest, sizeof(dest));
-    return sent == offset;
+    if (mgr->mcast_fd >= 0) return true;
 #endif
-}
 
-bool lan_p2p_recv(P2PSocketManager* mgr, P2PReceivedPacket* out) {
-    if (!mgr || !out) return false;
+    mgr->mcast_fd = socket(AF_INET, SOCK_DGRAM, 0);
+#ifdef _WIN32
+    if (mgr->mcast_fd == INVALID_SOCKET) return false;
+#else
+    if (mgr->mcast_fd < 0) return false;
+#endif
 
-    struct sockaddr_in from;
-    socklen_t from_len = sizeof(from);
+    // Every instance on this host binds the same group port (as discovery
+    // does with its broadcast port) and each gets its own copy.
+    int reuse = 1;
+    setsockopt(mgr->mcast_fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+#ifdef SO_REUSEPORT
+    setsockopt(mgr->mcast_fd, SOL_SOCKET, SO_REUSEPORT, (const char*)&reuse, sizeof(reuse));
+#endif
+#ifdef IP_MULTICAST_ALL
+    // Only the groups this socket joined, not every group joined on the host.
+    int all = 0;
+    setsockopt(mgr->mcast_fd, IPPROTO_IP, IP_MULTICAST_ALL, (const char*)&all, sizeof(all));
+#endif
 
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(mgr->mcast_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(mgr->mcast_fd);
 #ifdef _WIN32
-    int len = recvfrom(mgr->socket_fd, (char*)mgr->recv_buffer, MAX_P2P_PACKET, 0,
-                      (struct sockaddr*)&from, &from_len);
-    if (len == SOCKET_ERROR) {
-        int err = WSAGetLastError();
-        if (err == WSAEWOULDBLOCK) return false;
+        mgr->mcast_fd = INVALID_SOCKET;
+#else
+        mgr->mcast_fd = -1;
+#endif
         return false;
     }
+
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(mgr->mcast_fd, FIONBIO, &mode);
 #else
-    ssize_t len = recvfrom(mgr->socket_fd, mgr->recv_buffer, MAX_P2P_PACKET, 0,
-                           (struct sockaddr*)&from, &from_len);
-    if (len <= 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
-        return false;
+    int flags = fcntl(mgr->mcast_fd, F_GETFL, 0);
+    fcntl(mgr->mcast_fd, F_SETFL, flags | O_NONBLOCK);
+#endif
+
+    // Sends stay on the LAN and are looped back to members on this host.
+    int ttl = 1;
+    int loop = 1;
+    struct in_addr iface = mcast_interface(mgr);
+    setsockopt(mgr->socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl));
+    setsockopt(mgr->socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&loop, sizeof(loop));
+    if (iface.s_addr != htonl(INADDR_ANY)) {
+        setsockopt(mgr->socket_fd, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&iface, sizeof(iface));
     }
+
+    mgr->mcast_port = port;
+    return true;
+}
+
+// Add or drop a group membership on the multicast socket.
+static bool mcast_membership(P2PSocketManager* mgr, const P2PAddress* group, int option) {
+    if (!mgr || !group) return false;
+#ifdef _WIN32
+    if (mgr->mcast_fd == INVALID_SOCKET) return false;
+#else
+    if (mgr->mcast_fd < 0) return false;
 #endif
+    if (!IN_MULTICAST(ntohl(group->ip)) || ntohs(group->port) != mgr->mcast_port) return false;
+
+    struct ip_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr.s_addr = group->ip;
+    mreq.imr_interface = mcast_interface(mgr);
+    return setsockopt(mgr->mcast_fd, IPPROTO_IP, option, (const char*)&mreq, sizeof(mreq)) == 0;
+}
+
+bool lan_p2p_join_group(P2PSocketManager* mgr, const P2PAddress* group) {
+    return mcast_membership(mgr, group, IP_ADD_MEMBERSHIP);
+}
+
+void lan_p2p_leave_group(P2PSocketManager* mgr, const P2PAddress* group) {
+    mcast_membership(mgr, group, IP_DROP_MEMBERSHIP);
+}
+
+bool lan_p2p_resolve(const char* addr, P2PAddress* out) {
+    if (!addr || !out) return false;
+    char ip[16];
+    uint16_t port;
+    struct in_addr in;
+    if (!parse_address(addr, ip, &port) || port == 0) return false;
+    if (inet_pton(AF_INET, ip, &in) != 1) return false;
+    out->ip = (uint32_t)in.s_addr;
+    out->port = htons(port);
+    return true;
+}
+
+bool lan_p2p_is_loopback(const P2PAddress* addr) {
+    return addr && addr->ip == htonl(INADDR_LOOPBACK);
+}
+
+void lan_p2p_format_address(const P2PAddress* addr, char* out, int out_size) {
+    if (!out || out_size <= 0) return;
+    if (!addr || addr->port == 0) {
+        out[0] = '\0';
+        return;
+    }
+    char ip[16];
+    struct in_addr in;
+    in.s_addr = addr->ip;
+    inet_ntop(AF_INET, &in, ip, sizeof(ip));
+    format_address(out, out_size, ip, ntohs(addr->port));
+}
+
+// Write out the datagrams queued by transmit (sendmmsg / io_uring).
+static void flush_batch(P2PSocketManager* mgr) {
+#ifdef P2P_USE_MMSG
+    if (mgr->send_batch_count == 0) return;
+
+    int count = mgr->send_batch_count;
+    struct mmsghdr msgs[P2P_BATCH];
+    struct iovec iov[P2P_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < count; i++) {
+        iov[i].iov_base = mgr->send_batch[i];
+        iov[i].iov_len = mgr->send_batch_len[i];
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &mgr->send_batch_to[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+
+    // The io_uring path takes the whole batch in one submission; sendmmsg
+    // covers whatever it could not.
+    int done = mgr->uring ? lan_uring_send(mgr->uring, msgs, count) : 0;
+    while (done < count) {
+        int sent = sendmmsg(mgr->socket_fd, msgs + done, (unsigned int)(count - done), 0);
+        if (sent > 0) {
+            done += sent;
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            done++;  // the kernel refused this datagram; drop it as a failed sendto would
+        }
+    }
+    mgr->send_batch_count = 0;
+#else
+    (void)mgr;
+#endif
+}
+
+// Where the next outgoing datagram is built: the next batch slot (writing
+// out a full batch first), or the single send buffer.
+static uint8_t* next_send_buffer(P2PSocketManager* mgr) {
+#ifdef P2P_USE_MMSG
+    if (mgr->send_batch_count == P2P_BATCH) flush_batch(mgr);
+    return mgr->send_batch[mgr->send_batch_count];
+#else
+    return mgr->send_buffer;
+#endif
+}
+
+// Put a datagram built in next_send_buffer on its way.
+static bool transmit(P2PSocketManager* mgr, uint32_t ip, uint16_t port, uint8_t* buf, int len) {
+    lan_capture_write(mgr->capture, LAN_CAPTURE_OUT, ip, port, buf, (uint32_t)len);
+    if (mgr->replay) {
+        replay_note_token(mgr->replay_state, buf, len, ip, port, true);
+        return true;
+    }
+
+    // Same-host peer: hand the datagram over through shared memory.
+    // Multicast always goes through the kernel, which loops it back to
+    // members on this host.
+    bool group = IN_MULTICAST(ntohl(ip));
+    if (!group && mgr->shm && lan_shm_send(mgr->shm, ip, ntohs(port), buf, (uint32_t)len)) {
+        return true;
+    }
+
+    // Send
+    struct sockaddr_in dest = {0};
+    dest.sin_family = AF_INET;
+    dest.sin_port = port;
+    dest.sin_addr.s_addr = ip;
+
+#if defined(P2P_USE_MMSG)
+    // Queued; written out by the next lan_p2p_flush.
+    mgr->send_batch_to[mgr->send_batch_count] = dest;
+    mgr->send_batch_len[mgr->send_batch_count] = (uint32_t)len;
+    mgr->send_batch_count++;
+    return true;
+#elif defined(_WIN32)
+    int sent = sendto(mgr->socket_fd, (const char*)buf, len, 0, (struct sockaddr*)&dest, sizeof(dest));
+    return sent == len;
+#else
+    ssize_t sent = sendto(mgr->socket_fd, buf, len, 0, (struct sockaddr*)&dest, sizeof(dest));
+    return sent == len;
+#endif
+}
+
+// Send what the outgoing emulator has held back long enough.
+static void netem_release_out(P2PSocketManager* mgr) {
+    if (!mgr->netem_out) return;
+    uint64_t now = get_time_ms();
+    for (;;) {
+        uint8_t* buf = next_send_buffer(mgr);
+        uint32_t ip;
+        uint16_t port;
+        int len = lan_netem_release(mgr->netem_out, now, buf, MAX_P2P_PACKET, &ip, &port);
+        if (len < 0) break;
+        transmit(mgr, ip, port, buf, len);
+    }
+}
+
+bool lan_p2p_send(P2PSocketManager* mgr, const P2PSendPacket* packet) {
+    if (!mgr || !packet || packet->target.port == 0) return false;
+
+    uint8_t* buf = next_send_buffer(mgr);
+
+    // Build packet (headers are a few dozen bytes, well inside the buffer)
+    uint32_t offset = (uint32_t)(packet->compact ? build_compact_header(buf, packet)
+                                                 : build_full_header(buf, packet));
+
+    // Payload
+    if (packet->data && packet->data_len > 0) {
+        if (packet->data_len > MAX_P2P_PACKET - offset) {
+            return false;  // Too large
+        }
+        memcpy(buf + offset, packet->data, packet->data_len);
+        offset += packet->data_len;
+    }
+
+    // Emulated conditions: the datagram may be dropped, duplicated or held
+    // back; held ones go out from a later lan_p2p_flush.
+    if (mgr->netem_out && lan_netem_submit(mgr->netem_out, packet->target.ip, packet->target.port,
+                                           buf, offset, get_time_ms())) {
+        return true;
+    }
+    return transmit(mgr, packet->target.ip, packet->target.port, buf, (int)offset);
+}
+
+void lan_p2p_flush(P2PSocketManager* mgr) {
+    if (!mgr) return;
+    netem_release_out(mgr);
+    flush_batch(mgr);
+    lan_shm_tick(mgr->shm);
+}
+
+// Parse one datagram in place. out->data points into buf, so it stays valid
+// as long as buf does.
+static bool parse_datagram(uint8_t* buf, int len, const struct sockaddr_in* from,
+                           P2PReceivedPacket* out) {
+
+    // Get sender address
+    out->sender_addr.ip = (uint32_t)from->sin_addr.s_addr;
+    out->sender_addr.port = from->sin_port;
+
+    if (len >= P2P_COMPACT_HEADER_SIZE && buf[0] == P2P_COMPACT_MARKER) {
+        int offset = 1;
+        out->compact = true;
+        out->sender_id[0] = '\0';
+        out->socket_name[0] = '\0';
+        out->message_type = buf[offset++];
+        out->token = get_u32(buf + offset); offset += 4;
+        out->channel = buf[offset++];
+        uint8_t flags = buf[offset++];
+        out->reliable = (flags & P2P_FLAG_RELIABLE) != 0;
+        out->ordered = (flags & P2P_FLAG_ORDERED) != 0;
+        out->has_ack = (flags & P2P_FLAG_HAS_ACK) != 0;
+        out->compressed = (flags & P2P_FLAG_COMPRESSED) != 0;
+
+        int need = offset + (out->reliable ? 2 : 0) + (out->ordered ? 2 : 0) + (out->has_ack ? 6 : 0);
+        if (len < need) return false;
+
+        out->sequence = 0;
+        out->order_sequence = 0;
+        out->ack = 0;
+        out->ack_bits = 0;
+        if (out->reliable) { out->sequence = get_u16(buf + offset); offset += 2; }
+        if (out->ordered) { out->order_sequence = get_u16(buf + offset); offset += 2; }
+        if (out->has_ack) {
+            out->ack = get_u16(buf + offset); offset += 2;
+            out->ack_bits = get_u32(buf + offset); offset += 4;
+        }
+
+        out->data_len = (uint32_t)(len - offset);
+        if (out->data_len > 0) {
+            out->data = buf + offset;
+        } else {
+            out->data = NULL;
+        }
+        return true;
+    }
 
     // Parse header
-    if (len < 82) return false;  // Minimum header size
-    if (memcmp(mgr->recv_buffer, P2P_MAGIC, 6) != 0) return false;
-    if (mgr->recv_buffer[6] != P2P_VERSION) return false;
+    if (len < P2P_HEADER_SIZE) return false;  // Minimum header size
+    if (memcmp(buf, P2P_MAGIC, 6) != 0) return false;
+    if (buf[6] != P2P_VERSION) return false;
 
-    uint8_t* buf = mgr->recv_buffer;
     int offset = 7;
+    out->compact = false;
 
     // Message type
     out->message_type = buf[offset++];
@@ -266,26 +785,28 @@ bool lan_p2p_recv(P2PSocketManager* mgr, P2PReceivedPacket* out) {
 
     // Flags
     uint8_t flags = buf[offset++];
-    out->reliable = (flags & 0x01) != 0;
+    out->reliable = (flags & P2P_FLAG_RELIABLE) != 0;
+    out->ordered = (flags & P2P_FLAG_ORDERED) != 0;
+    out->has_ack = (flags & P2P_FLAG_HAS_ACK) != 0;
+    out->compressed = (flags & P2P_FLAG_COMPRESSED) != 0;
+
+    // Sender's connection token
+    out->token = get_u32(buf + offset); offset += 4;
 
     // Sequence number
-    out->sequence = ntohl(*(uint32_t*)(buf + offset)); offset += 4;
+    out->sequence = get_u32(buf + offset); offset += 4;
 
-    // Data length
-    out->data_len = ntohl(*(uint32_t*)(buf + offset)); offset += 4;
+    // Order sequence + ACK block
+    out->order_sequence = get_u16(buf + offset); offset += 2;
+    out->ack = get_u16(buf + offset); offset += 2;
+    out->ack_bits = get_u32(buf + offset); offset += 4;
 
-    // Get sender address
-    char ip[16];
-    inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
-    snprintf(out->sender_addr, sizeof(out->sender_addr), "%s:%d", ip, ntohs(from.sin_port));
+    // Data length
+    out->data_len = get_u32(buf + offset); offset += 4;
 
-    // Copy payload
-    if (out->data_len > 0 && offset + out->data_len <= len) {
-        if (out->data_len > MAX_P2P_PACKET) {
-            out->data_len = MAX_P2P_PACKET;
-        }
-        memcpy(mgr->last_recv_data, buf + offset, out->data_len);
-        out->data = mgr->last_recv_data;
+    // Payload
+    if (out->data_len > 0 && offset + out->data_len <= (uint32_t)len) {
+        out->data = buf + offset;
     } else {
         out->data = NULL;
         out->data_len = 0;
@@ -293,3 +814,414 @@ bool lan_p2p_recv(P2PSocketManager* mgr, P2PReceivedPacket* out) {
 
     return true;
 }
+
+// Non-blocking receive of one raw datagram. Returns its length, or -1 when
+// the socket has nothing (or failed).
+static int recv_datagram(P2PSocketManager* mgr, uint8_t* buf, uint32_t buf_size,
+                         struct sockaddr_in* from) {
+#if defined(P2P_USE_MMSG)
+    // Hand out what the last recvmmsg left over before asking the kernel again.
+    if (mgr->recv_batch_next < mgr->recv_batch_count) {
+        int i = mgr->recv_batch_next++;
+        uint32_t len = mgr->recv_batch_len[i];
+        if (len > buf_size) len = buf_size;
+        memcpy(buf, mgr->recv_batch[i], len);
+        *from = mgr->recv_batch_from[i];
+        return (int)len;
+    }
+
+    // Completions of the multishot receive: no syscall while any are queued.
+    if (lan_uring_receiving(mgr->uring)) {
+        return lan_uring_recv(mgr->uring, buf, buf_size, from);
+    }
+
+    struct mmsghdr msgs[P2P_BATCH];
+    struct iovec iov[P2P_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < P2P_BATCH; i++) {
+        iov[i].iov_base = (i == 0) ? buf : mgr->recv_batch[i];
+        iov[i].iov_len = (i == 0) ? buf_size : MAX_P2P_PACKET;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = (i == 0) ? (void*)from : (void*)&mgr->recv_batch_from[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+    int count = recvmmsg(mgr->socket_fd, msgs, P2P_BATCH, MSG_DONTWAIT, NULL);
+    if (count <= 0) return -1;
+    for (int i = 1; i < count; i++) {
+        mgr->recv_batch_len[i] = msgs[i].msg_len;
+    }
+    mgr->recv_batch_count = count;
+    mgr->recv_batch_next = 1;
+    return (int)msgs[0].msg_len;
+#else
+    socklen_t from_len = sizeof(*from);
+
+#ifdef _WIN32
+    int len = recvfrom(mgr->socket_fd, (char*)buf, (int)buf_size, 0,
+                      (struct sockaddr*)from, &from_len);
+    if (len == SOCKET_ERROR) {
+        int err = WSAGetLastError();
+        if (err == WSAEWOULDBLOCK) return -1;
+        return -1;
+    }
+    return len;
+#else
+    ssize_t len = recvfrom(mgr->socket_fd, buf, buf_size, 0,
+                           (struct sockaddr*)from, &from_len);
+    if (len <= 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return -1;
+        return -1;
+    }
+    return (int)len;
+#endif
+#endif
+}
+
+// Non-blocking receive of one datagram from the multicast socket, if open.
+static int recv_mcast_datagram(P2PSocketManager* mgr, uint8_t* buf, uint32_t buf_size,
+                               struct sockaddr_in* from) {
+    socklen_t from_len = sizeof(*from);
+#ifdef _WIN32
+    if (mgr->mcast_fd == INVALID_SOCKET) return -1;
+    int len = recvfrom(mgr->mcast_fd, (char*)buf, (int)buf_size, 0,
+                       (struct sockaddr*)from, &from_len);
+    return len == SOCKET_ERROR ? -1 : len;
+#else
+    if (mgr->mcast_fd < 0) return -1;
+    ssize_t len = recvfrom(mgr->mcast_fd, buf, buf_size, 0,
+                           (struct sockaddr*)from, &from_len);
+    return len <= 0 ? -1 : (int)len;
+#endif
+}
+
+// Whether the socket is read through the io_uring completion queue.
+static bool uring_receiving(P2PSocketManager* mgr) {
+#ifdef P2P_USE_MMSG
+    return lan_uring_receiving(mgr->uring);
+#else
+    (void)mgr;
+    return false;
+#endif
+}
+
+// Block up to timeout_ms for the socket (or the multicast socket) to become
+// readable. With io_uring receives the ring descriptor stands in for the
+// socket, which the pending multishot receive drains.
+static bool wait_readable(P2PSocketManager* mgr, int timeout_ms) {
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+#ifdef _WIN32
+    FD_SET(mgr->socket_fd, &readfds);
+    if (mgr->mcast_fd != INVALID_SOCKET) FD_SET(mgr->mcast_fd, &readfds);
+    return select(0, &readfds, NULL, NULL, &tv) > 0;
+#else
+    int max_fd = uring_receiving(mgr) ? lan_uring_fd(mgr->uring) : mgr->socket_fd;
+    FD_SET(max_fd, &readfds);
+    if (mgr->mcast_fd >= 0) {
+        FD_SET(mgr->mcast_fd, &readfds);
+        if (mgr->mcast_fd > max_fd) max_fd = mgr->mcast_fd;
+    }
+    return select(max_fd + 1, &readfds, NULL, NULL, &tv) > 0;
+#endif
+}
+
+// Next datagram from the shared-memory inbox, reported as coming from
+// 127.0.0.1:<sender port> so replies also take the same-host path.
+static int recv_shm_datagram(P2PSocketManager* mgr, uint8_t* buf, uint32_t buf_size,
+                             struct sockaddr_in* from) {
+    if (!mgr->shm) return -1;
+    uint16_t from_port = 0;
+    int len = lan_shm_recv(mgr->shm, buf, buf_size, &from_port);
+    if (len < 0) return -1;
+    memset(from, 0, sizeof(*from));
+    from->sin_family = AF_INET;
+    from->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    from->sin_port = htons(from_port);
+    return len;
+}
+
+// Incoming emulated conditions: true when the emulator took a datagram just
+// read off the wire (held back or dropped) instead of letting it through.
+static bool netem_hold(P2PSocketManager* mgr, const uint8_t* buf, int len,
+                       const struct sockaddr_in* from) {
+    return mgr->netem_in && lan_netem_submit(mgr->netem_in, (uint32_t)from->sin_addr.s_addr,
+                                             from->sin_port, buf, (uint32_t)len, get_time_ms());
+}
+
+// A held datagram whose delay is up, or -1.
+static int netem_take(P2PSocketManager* mgr, uint8_t* buf, uint32_t buf_size,
+                      struct sockaddr_in* from) {
+    if (!mgr->netem_in) return -1;
+    uint32_t ip;
+    uint16_t port;
+    int len = lan_netem_release(mgr->netem_in, get_time_ms(), buf, buf_size, &ip, &port);
+    if (len < 0) return -1;
+    memset(from, 0, sizeof(*from));
+    from->sin_family = AF_INET;
+    from->sin_addr.s_addr = ip;
+    from->sin_port = port;
+    return len;
+}
+
+// Next received datagram of the capture being replayed whose time has
+// come, or -1. The captured run's sends tell which tokens it handed out; a
+// compact packet addressed to one gets this run's token for the same peer
+// instead, and waits (up to P2P_REPLAY_WAIT_MS) for this run to hand it out.
+static int recv_replay_datagram(P2PSocketManager* mgr, uint8_t* buf, uint32_t buf_size,
+                                struct sockaddr_in* from) {
+    P2PReplayState* rs = mgr->replay_state;
+    while (rs->held_len < 0) {
+        uint8_t direction;
+        int len = lan_replay_next(mgr->replay, rs->held, sizeof(rs->held),
+                                  &rs->held_ip, &rs->held_port, &direction);
+        if (len < 0) return -1;
+        if (direction == LAN_CAPTURE_OUT) {
+            replay_note_token(rs, rs->held, len, rs->held_ip, rs->held_port, false);
+            continue;
+        }
+        rs->held_len = len;
+        rs->held_since = get_time_ms();
+    }
+
+    if (rs->held_len >= P2P_COMPACT_HEADER_SIZE && rs->held[0] == P2P_COMPACT_MARKER) {
+        uint32_t token = get_u32(rs->held + 2);
+        for (int i = 0; i < rs->token_count; i++) {
+            P2PReplayToken* t = &rs->tokens[i];
+            if (t->captured != token) continue;
+            if (t->live == 0 && !t->abandoned) {
+                if (get_time_ms() - rs->held_since < P2P_REPLAY_WAIT_MS) return -1;
+                t->abandoned = true;
+            }
+            if (t->live != 0) put_u32(rs->held + 2, t->live);
+            break;
+        }
+    }
+
+    uint32_t len = (uint32_t)rs->held_len < buf_size ? (uint32_t)rs->held_len : buf_size;
+    memcpy(buf, rs->held, len);
+    memset(from, 0, sizeof(*from));
+    from->sin_family = AF_INET;
+    from->sin_addr.s_addr = rs->held_ip;
+    from->sin_port = rs->held_port;
+    rs->held_len = -1;
+    return (int)len;
+}
+
+// Parse a datagram that is about to be handed out, recording it first.
+static bool take_datagram(P2PSocketManager* mgr, uint8_t* buf, int len,
+                          const struct sockaddr_in* from, P2PReceivedPacket* out) {
+    lan_capture_write(mgr->capture, LAN_CAPTURE_IN, (uint32_t)from->sin_addr.s_addr,
+                      from->sin_port, buf, (uint32_t)len);
+    return parse_datagram(buf, len, from, out);
+}
+
+#ifdef P2P_USE_MMSG
+// I/O thread: read up to `max` datagrams with one recvmmsg straight into the
+// ring slots starting at `tail`. Returns how many slots now hold a parsed
+// packet (datagrams that fail to parse are squeezed out).
+static uint32_t io_recv_batch(P2PSocketManager* mgr, uint32_t tail, uint32_t max) {
+    struct mmsghdr msgs[P2P_BATCH];
+    struct iovec iov[P2P_BATCH];
+    struct sockaddr_in from[P2P_BATCH];
+    if (max > P2P_BATCH) max = P2P_BATCH;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (uint32_t i = 0; i < max; i++) {
+        P2PIoSlot* slot = &mgr->io_ring[(tail + i) & (P2P_IO_RING_SLOTS - 1)];
+        iov[i].iov_base = slot->buffer;
+        iov[i].iov_len = sizeof(slot->buffer);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &from[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+    }
+    int count = recvmmsg(mgr->socket_fd, msgs, max, MSG_DONTWAIT, NULL);
+    if (count <= 0) return 0;
+
+    uint64_t now = get_time_ms();
+    uint64_t now_us = get_time_us();
+    uint32_t filled = 0;
+    for (int i = 0; i < count; i++) {
+        P2PIoSlot* slot = &mgr->io_ring[(tail + filled) & (P2P_IO_RING_SLOTS - 1)];
+        if (filled != (uint32_t)i) {
+            memcpy(slot->buffer, mgr->io_ring[(tail + i) & (P2P_IO_RING_SLOTS - 1)].buffer, msgs[i].msg_len);
+        }
+        if (!take_datagram(mgr, slot->buffer, (int)msgs[i].msg_len, &from[i], &slot->packet)) continue;
+        slot->packet.received_at = now;
+        slot->packet.received_us = now_us;
+        filled++;
+    }
+    return filled;
+}
+#endif
+
+static void io_sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    usleep((useconds_t)ms * 1000);
+#endif
+}
+
+// How long the I/O thread may sleep: its poll interval, cut short when the
+// incoming emulator has a datagram coming due.
+static int io_wait_ms(P2PSocketManager* mgr) {
+    int wait = mgr->shm ? P2P_IO_SHM_WAIT_MS : P2P_IO_WAIT_MS;
+    int due = lan_netem_next_due(mgr->netem_in, get_time_ms());
+    return (due >= 0 && due < wait) ? due : wait;
+}
+
+// I/O thread body: drain the socket into the ring as soon as datagrams land,
+// stamping each with its arrival time. When the ring is full we stop reading
+// and let the kernel buffer absorb the burst until the game thread catches up.
+static void io_thread_run(P2PSocketManager* mgr) {
+    while (LAN_LOAD_ACQUIRE(&mgr->io_running)) {
+        uint32_t tail = mgr->io_tail;
+        uint32_t free_slots = P2P_IO_RING_SLOTS - (tail - LAN_LOAD_ACQUIRE(&mgr->io_head));
+        if (free_slots == 0) {
+            io_sleep_ms(1);
+            continue;
+        }
+        P2PIoSlot* slot = &mgr->io_ring[tail & (P2P_IO_RING_SLOTS - 1)];
+        struct sockaddr_in from;
+        // A due datagram from the emulator has already been through it.
+        int len = netem_take(mgr, slot->buffer, sizeof(slot->buffer), &from);
+        bool fresh = len < 0;
+        if (len < 0) len = recv_shm_datagram(mgr, slot->buffer, sizeof(slot->buffer), &from);
+        if (len < 0) len = recv_mcast_datagram(mgr, slot->buffer, sizeof(slot->buffer), &from);
+        if (len < 0 && uring_receiving(mgr)) {
+            // Reap completions first; sleep on the ring only once they run out.
+            len = recv_datagram(mgr, slot->buffer, sizeof(slot->buffer), &from);
+            if (len < 0) {
+                wait_readable(mgr, io_wait_ms(mgr));
+                continue;
+            }
+        }
+        if (len < 0) {
+            if (!wait_readable(mgr, io_wait_ms(mgr))) continue;
+#ifdef P2P_USE_MMSG
+            // The batch is parsed in place, so it can't pass the emulator.
+            if (!mgr->netem_in) {
+                uint32_t filled = io_recv_batch(mgr, tail, free_slots);
+                if (filled > 0) LAN_STORE_RELEASE(&mgr->io_tail, tail + filled);
+                continue;
+            }
+#endif
+            len = recv_datagram(mgr, slot->buffer, sizeof(slot->buffer), &from);
+        }
+        if (len < 0) continue;
+        if (fresh && netem_hold(mgr, slot->buffer, len, &from)) continue;
+        if (!take_datagram(mgr, slot->buffer, len, &from, &slot->packet)) continue;
+        slot->packet.received_at = get_time_ms();
+        slot->packet.received_us = get_time_us();
+        LAN_STORE_RELEASE(&mgr->io_tail, tail + 1);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI io_thread_main(LPVOID arg) {
+    io_thread_run((P2PSocketManager*)arg);
+    return 0;
+}
+#else
+static void* io_thread_main(void* arg) {
+    io_thread_run((P2PSocketManager*)arg);
+    return NULL;
+}
+#endif
+
+// Game-thread side of the ring. The slot handed out stays owned by the caller
+// until the next call, matching the inline path's buffer lifetime.
+static bool io_ring_pop(P2PSocketManager* mgr, P2PReceivedPacket* out) {
+    uint32_t head = mgr->io_head;
+    if (mgr->io_holding) {
+        head++;
+        LAN_STORE_RELEASE(&mgr->io_head, head);
+        mgr->io_holding = false;
+    }
+    if (head == LAN_LOAD_ACQUIRE(&mgr->io_tail)) return false;
+
+    *out = mgr->io_ring[head & (P2P_IO_RING_SLOTS - 1)].packet;
+    mgr->io_holding = true;
+    return true;
+}
+
+bool lan_p2p_enable_uring(P2PSocketManager* mgr) {
+#ifdef P2P_USE_MMSG
+    if (!mgr) return false;
+    if (!mgr->uring) mgr->uring = lan_uring_create(mgr->socket_fd);
+    return mgr->uring != NULL;
+#else
+    (void)mgr;
+    return false;
+#endif
+}
+
+bool lan_p2p_wire_only(P2PSocketManager* mgr) {
+    return mgr && (mgr->netem_out || mgr->netem_in || mgr->capture || mgr->replay);
+}
+
+
+bool lan_p2p_start_io_thread(P2PSocketManager* mgr) {
+    if (!mgr || mgr->replay) return false;  // a replay is fed from lan_p2p_recv
+    if (mgr->io_ring) return true;
+
+    mgr->io_ring = calloc(P2P_IO_RING_SLOTS, sizeof(P2PIoSlot));
+    if (!mgr->io_ring) return false;
+    mgr->io_head = 0;
+    mgr->io_tail = 0;
+    mgr->io_holding = false;
+    mgr->io_running = 1;
+
+#ifdef _WIN32
+    mgr->io_thread = CreateThread(NULL, 0, io_thread_main, mgr, 0, NULL);
+    bool started = (mgr->io_thread != NULL);
+#else
+    bool started = (pthread_create(&mgr->io_thread, NULL, io_thread_main, mgr) == 0);
+#endif
+    if (!started) {
+        free(mgr->io_ring);
+        mgr->io_ring = NULL;
+        mgr->io_running = 0;
+    }
+    return started;
+}
+
+bool lan_p2p_recv(P2PSocketManager* mgr, P2PReceivedPacket* out, uint8_t* buf, uint32_t buf_size) {
+    if (!mgr || !out) return false;
+
+    // The I/O thread has already read the datagram into its ring slot.
+    if (mgr->io_ring) {
+        return io_ring_pop(mgr, out);
+    }
+
+    if (!buf || buf_size == 0) {
+        buf = mgr->recv_buffer;
+        buf_size = sizeof(mgr->recv_buffer);
+    }
+
+    struct sockaddr_in from;
+    for (;;) {
+        int len;
+        if (mgr->replay) {
+            len = recv_replay_datagram(mgr, buf, buf_size, &from);
+        } else {
+            len = recv_shm_datagram(mgr, buf, buf_size, &from);
+            if (len < 0) len = recv_datagram(mgr, buf, buf_size, &from);
+            if (len < 0) len = recv_mcast_datagram(mgr, buf, buf_size, &from);
+            // Everything on the wire passes the emulator before anything it
+            // held back is handed out.
+            if (len >= 0 && netem_hold(mgr, buf, len, &from)) continue;
+            if (len < 0) len = netem_take(mgr, buf, buf_size, &from);
+        }
+        if (len < 0) return false;
+        if (!take_datagram(mgr, buf, len, &from, out)) continue;  // not ours - keep draining
+        out->received_at = get_time_ms();
+        out->received_us = get_time_us();
+        return true;
+    }
+}
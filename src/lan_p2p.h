@@ -6,22 +6,39 @@
 
 typedef struct P2PSocketManager P2PSocketManager;
 
+// Resolved IPv4 peer address (both fields in network byte order). Resolved
+// once per peer so the per-packet paths never touch "IP:port" strings.
+typedef struct {
+    uint32_t ip;
+    uint16_t port;  // 0 = unresolved
+} P2PAddress;
+
 // Received packet info
 typedef struct {
-    char sender_id[33];
-    char sender_addr[64];
-    char socket_name[33];
+    char sender_id[33];     // empty for compact packets
+    P2PAddress sender_addr;
+    char socket_name[33];   // empty for compact packets
     uint8_t channel;
     uint8_t message_type;  // DATA, CONNECT, ACCEPT, CLOSE
     uint8_t* data;
     uint32_t data_len;
     uint32_t sequence;
+    uint16_t order_sequence;
     bool reliable;
+    bool ordered;
+    bool has_ack;
+    bool compressed;   // payload is compressed (P2P_FLAG_COMPRESSED)
+    uint16_t ack;
+    uint32_t ack_bits;
+    bool compact;      // compact header: token identifies the connection
+    uint32_t token;    // compact: our token for the connection; full: the sender's token
+    uint64_t received_at;  // get_time_ms() when the datagram was read off the socket
+    uint64_t received_us;  // get_time_us() at the same moment (arrival timestamps)
 } P2PReceivedPacket;
 
 // Packet to send
 typedef struct {
-    const char* target_addr;  // "IP:port"
+    P2PAddress target;
     const char* sender_id;
     const char* socket_name;
     uint8_t channel;
@@ -29,7 +46,15 @@ typedef struct {
     const uint8_t* data;
     uint32_t data_len;
     uint32_t sequence;
+    uint16_t order_sequence;
     bool reliable;
+    bool ordered;
+    bool has_ack;       // piggyback an ACK for the peer's reliable stream
+    bool compressed;    // payload is compressed (P2P_FLAG_COMPRESSED)
+    uint16_t ack;       // last reliable sequence received contiguously
+    uint32_t ack_bits;  // bit i = sequence ack + 1 + i also received
+    bool compact;       // send the token-only header (sender_id/socket_name unused)
+    uint32_t token;     // compact: receiver's token; full: our token, announced to the peer
 } P2PSendPacket;
 
 // P2P message types
@@ -37,6 +62,19 @@ typedef struct {
 #define P2P_MSG_CONNECT 0x02
 #define P2P_MSG_ACCEPT 0x03
 #define P2P_MSG_CLOSE 0x04
+#define P2P_MSG_ACK 0x05
+#define P2P_MSG_BUNDLE 0x06  // several DATA records for one connection (coalescing)
+#define P2P_MSG_PING 0x07    // keepalive probe on an idle connection
+#define P2P_MSG_PONG 0x08    // answer to PING (echoes its payload)
+#define P2P_MSG_MCAST 0x09   // DATA sent once to a session's multicast group
+#define P2P_MSG_GROUP 0x0A   // multicast group membership (probe / heard / confirm / left)
+#define P2P_MSG_FEC 0x0B     // unreliable DATA in an FEC group, or the group's parity
+
+// Header flags
+#define P2P_FLAG_RELIABLE 0x01
+#define P2P_FLAG_ORDERED 0x02
+#define P2P_FLAG_HAS_ACK 0x04
+#define P2P_FLAG_COMPRESSED 0x08  // DATA payload is compressed (p2p_compress.c)
 
 /**
  * Create P2P socket manager.
@@ -61,6 +99,24 @@ uint16_t lan_p2p_get_port(P2PSocketManager* mgr);
  */
 const char* lan_p2p_get_local_ip(P2PSocketManager* mgr);
 
+/**
+ * Resolve an "IP:port" string.
+ *
+ * @return false if the string isn't a valid IPv4 address and port
+ */
+bool lan_p2p_resolve(const char* addr, P2PAddress* out);
+
+/**
+ * Format a resolved address as "IP:port".
+ */
+void lan_p2p_format_address(const P2PAddress* addr, char* out, int out_size);
+
+/**
+ * Whether an address is 127.0.0.1, as datagrams taken from the shared-memory
+ * inbox are reported.
+ */
+bool lan_p2p_is_loopback(const P2PAddress* addr);
+
 /**
  * Send a packet to a peer.
  *
@@ -70,14 +126,77 @@ const char* lan_p2p_get_local_ip(P2PSocketManager* mgr);
  */
 bool lan_p2p_send(P2PSocketManager* mgr, const P2PSendPacket* packet);
 
+/**
+ * Write out datagrams queued by lan_p2p_send. Where the platform supports
+ * batched sends (Linux sendmmsg) lan_p2p_send only queues, so callers flush
+ * once per tick; elsewhere sends go out immediately and this is a no-op.
+ * lan_p2p_destroy flushes too.
+ */
+void lan_p2p_flush(P2PSocketManager* mgr);
+
+/**
+ * Open the multicast receive socket on `port` (shared with other instances
+ * on this host) and set up the main socket for multicast sends. Call before
+ * lan_p2p_start_io_thread; the socket is closed by lan_p2p_destroy.
+ *
+ * @return true if the socket is open
+ */
+bool lan_p2p_open_multicast(P2PSocketManager* mgr, uint16_t port);
+
+/**
+ * Join / leave a multicast group (an administratively scoped IPv4 address
+ * on the port given to lan_p2p_open_multicast). Datagrams sent to the group
+ * are returned by lan_p2p_recv like any other. Packets are sent to a group
+ * with lan_p2p_send, targeting the group address.
+ *
+ * @return false if the multicast socket is not open or the join failed
+ */
+bool lan_p2p_join_group(P2PSocketManager* mgr, const P2PAddress* group);
+void lan_p2p_leave_group(P2PSocketManager* mgr, const P2PAddress* group);
+
+/**
+ * Move the socket onto io_uring (Linux): a multishot receive into
+ * kernel-provided buffers, and one submission per lan_p2p_flush. Call
+ * before lan_p2p_start_io_thread. If the kernel later refuses the multishot
+ * receive, receives quietly go back to recvmmsg.
+ *
+ * @return true if the rings are set up; false leaves the socket as it was
+ */
+bool lan_p2p_enable_uring(P2PSocketManager* mgr);
+
+/**
+ * Whether all traffic has to go through this socket: EOSLAN_NETEM
+ * conditions, EOSLAN_CAPTURE or EOSLAN_REPLAY apply to it. Traffic that
+ * would skip the socket (in-process delivery) should take the wire instead.
+ */
+bool lan_p2p_wire_only(P2PSocketManager* mgr);
+
+/**
+ * Start a background thread that reads and parses datagrams as they arrive
+ * (instead of only when lan_p2p_recv is called). lan_p2p_recv then pops the
+ * already-parsed packets. The thread is stopped by lan_p2p_destroy.
+ *
+ * @param mgr Manager handle
+ * @return true if the thread is running (never while replaying a capture,
+ *         which is fed from lan_p2p_recv)
+ */
+bool lan_p2p_start_io_thread(P2PSocketManager* mgr);
+
 /**
  * Receive a packet.
  * Returns false if no packet available.
  *
+ * The datagram is read into buf and parsed in place, so out_packet->data
+ * points into buf (no payload copy). With the I/O thread running, or when buf
+ * is NULL, it points into a buffer owned by the manager instead, valid until
+ * the next call.
+ *
  * @param mgr Manager handle
- * @param out_packet Receives packet data (buffer owned by manager, valid until next call)
+ * @param out_packet Receives packet data
+ * @param buf Caller buffer to receive into (may be NULL)
+ * @param buf_size Size of buf
  * @return true if packet received
  */
-bool lan_p2p_recv(P2PSocketManager* mgr, P2PReceivedPacket* out_packet);
+bool lan_p2p_recv(P2PSocketManager* mgr, P2PReceivedPacket* out_packet, uint8_t* buf, uint32_t buf_size);
 
 #endif // EOS_LAN_P2P_H
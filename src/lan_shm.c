@@ -0,0 +1,455 @@
+#include "lan_shm.h"
+#include "lan_common.h"
+#include "internal/logging.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#endif
+
+#define LAN_SHM_MAGIC 0x4D485345  // "ESHM"
+#define LAN_SHM_VERSION 4
+#define LAN_SHM_LANES 8           // concurrent senders per inbox
+#define LAN_SHM_SLOTS 128         // datagrams per lane (power of 2): a full lane drops
+// Largest datagram the P2P layer builds: a full wire header plus a
+// P2P_COALESCE_FRAME_MAX bundle or a full CONNECT payload. Anything larger
+// would leave this path for UDP and race the datagrams still in the lane.
+#define LAN_SHM_SLOT_BYTES 1536
+#define LAN_SHM_MAX_PEERS 16
+#define LAN_SHM_RETRY_MS 1000
+#define LAN_SHM_HEARTBEAT_MS 500  // how often live processes refresh their stamps
+#define LAN_SHM_STALE_MS 10000    // a stamp this old is stale even if the pid exists
+
+typedef struct {
+    uint32_t len;
+    uint8_t data[LAN_SHM_SLOT_BYTES];
+} LanShmSlot;
+
+// One sender -> owner ring. The indices sit on separate cache lines so the
+// two processes don't false-share.
+// The claiming sender stamps its pid and refreshes the heartbeat while it
+// lives, so a lane left claimed by a crashed sender can be reclaimed
+// (shm_stale). A free lane has pid 0 and the time it was freed.
+typedef struct {
+    volatile uint32_t sender_port;  // claiming sender's P2P port, 0 = free
+    volatile uint32_t sender_pid;   // claiming sender's process, 0 = not stamped yet
+    volatile uint32_t heartbeat;    // get_time_ms() of the sender's last refresh
+    uint8_t pad0[52];
+    volatile uint32_t tail;         // written by the sender
+    uint8_t pad1[60];
+    volatile uint32_t head;         // written by the inbox owner
+    uint8_t pad2[60];
+    LanShmSlot slots[LAN_SHM_SLOTS];
+} LanShmLane;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    volatile uint32_t generation;  // bumped whenever an owner (re)initialises the inbox
+    volatile uint32_t active;      // cleared when the owner shuts down
+    volatile uint32_t owner_pid;   // the inbox owner's process
+    volatile uint32_t owner_heartbeat;  // get_time_ms() of the owner's last refresh
+    LanShmLane lanes[LAN_SHM_LANES];
+} LanShmSegment;
+
+#ifdef _WIN32
+typedef HANDLE ShmHandle;
+#define SHM_NO_HANDLE NULL
+#else
+typedef int ShmHandle;  // unused on POSIX: the fd is closed right after mmap
+#define SHM_NO_HANDLE 0
+#endif
+
+// A peer inbox we send to (or an address we know is not same-host).
+typedef struct {
+    uint32_t addr;          // IPv4, network order
+    uint16_t port;
+    bool local;             // addr is one of ours
+    LanShmSegment* seg;     // NULL = not attached
+    ShmHandle handle;
+    int lane;
+    uint32_t generation;
+    uint64_t retry_at;      // no inbox last time: don't look again before this
+    bool in_use;
+} LanShmPeer;
+
+struct LanShm {
+    uint16_t port;
+    uint32_t pid;
+    uint64_t heartbeat_at;  // next refresh of our lane stamps (sending thread, lan_shm_tick)
+    uint64_t owner_stamp_at;  // next refresh of the inbox owner stamp (receiving thread)
+    char name[64];
+    LanShmSegment* inbox;
+    ShmHandle inbox_handle;
+    int next_lane;  // round-robin start so one busy sender can't starve others
+    LanShmPeer peers[LAN_SHM_MAX_PEERS];
+};
+
+static uint32_t shm_current_pid(void) {
+#ifdef _WIN32
+    return (uint32_t)GetCurrentProcessId();
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+// Whether a process still exists. Anything but a definite "no such process"
+// counts as alive.
+static bool shm_process_alive(uint32_t pid) {
+#ifdef _WIN32
+    HANDLE h = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+    if (!h) return GetLastError() != ERROR_INVALID_PARAMETER;
+    bool alive = WaitForSingleObject(h, 0) == WAIT_TIMEOUT;
+    CloseHandle(h);
+    return alive;
+#else
+    return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+#endif
+}
+
+// Whether the process behind a pid/heartbeat stamp is gone: its process has
+// exited, or it has not refreshed the heartbeat for LAN_SHM_STALE_MS (hung,
+// or the pid was reused). The pid is only looked up once a few heartbeats
+// have been missed.
+static bool shm_stale(uint32_t pid, uint32_t heartbeat, uint32_t now) {
+    int32_t age = (int32_t)(now - heartbeat);
+    if (age <= 2 * LAN_SHM_HEARTBEAT_MS) return false;
+    if (age > LAN_SHM_STALE_MS) return true;
+    return pid != 0 && !shm_process_alive(pid);
+}
+
+// Whether an inbox's owner is still running. An inbox left active by a
+// crashed owner is treated as shut down; the next instance on its port
+// re-initialises it.
+static bool shm_inbox_live(LanShmSegment* seg, uint32_t now) {
+    return LAN_LOAD_ACQUIRE(&seg->active) &&
+           !shm_stale(LAN_LOAD_ACQUIRE(&seg->owner_pid), LAN_LOAD_ACQUIRE(&seg->owner_heartbeat), now);
+}
+
+static void shm_name(char* out, size_t size, uint16_t port) {
+#ifdef _WIN32
+    snprintf(out, size, "Local\\eoslan-p2p-%u", (unsigned)port);
+#else
+    snprintf(out, size, "/eoslan-p2p-%u", (unsigned)port);
+#endif
+}
+
+// Map the inbox segment for `port`. create=true makes it if needed (owner);
+// otherwise only an existing inbox is opened (sender).
+static LanShmSegment* shm_map(uint16_t port, bool create, ShmHandle* out_handle) {
+    char name[64];
+    shm_name(name, sizeof(name), port);
+    *out_handle = SHM_NO_HANDLE;
+
+#ifdef _WIN32
+    HANDLE h = create
+        ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                             (DWORD)sizeof(LanShmSegment), name)
+        : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+    if (!h) return NULL;
+    LanShmSegment* seg = (LanShmSegment*)MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LanShmSegment));
+    if (!seg) {
+        CloseHandle(h);
+        return NULL;
+    }
+    *out_handle = h;
+    return seg;
+#else
+    int fd = shm_open(name, create ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+    if (fd < 0) return NULL;
+    if (create) {
+        if (ftruncate(fd, (off_t)sizeof(LanShmSegment)) != 0) {
+            close(fd);
+            return NULL;
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(LanShmSegment)) {
+            close(fd);
+            return NULL;
+        }
+    }
+    void* p = mmap(NULL, sizeof(LanShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (p == MAP_FAILED) ? NULL : (LanShmSegment*)p;
+#endif
+}
+
+static void shm_unmap(LanShmSegment* seg, ShmHandle handle) {
+    if (!seg) return;
+#ifdef _WIN32
+    UnmapViewOfFile(seg);
+    if (handle) CloseHandle(handle);
+#else
+    (void)handle;
+    munmap(seg, sizeof(LanShmSegment));
+#endif
+}
+
+LanShm* lan_shm_create(uint16_t port) {
+    const char* env = getenv("EOSLAN_SHM");
+    if (env && atoi(env) == 0) return NULL;
+
+    LanShm* shm = calloc(1, sizeof(LanShm));
+    if (!shm) return NULL;
+    shm->port = port;
+    shm->pid = shm_current_pid();
+    shm_name(shm->name, sizeof(shm->name), port);
+
+    shm->inbox = shm_map(port, true, &shm->inbox_handle);
+    if (!shm->inbox) {
+        free(shm);
+        return NULL;
+    }
+
+    // (Re)initialise. A segment left behind by a crashed instance on this port
+    // gets a new generation, which tells still-attached senders to reclaim.
+    LanShmSegment* seg = shm->inbox;
+    LAN_STORE_RELEASE(&seg->active, 0);
+    uint32_t now = (uint32_t)get_time_ms();
+    uint32_t generation = (seg->magic == LAN_SHM_MAGIC) ? seg->generation + 1 : now;
+    memset(seg->lanes, 0, sizeof(seg->lanes));
+    for (int i = 0; i < LAN_SHM_LANES; i++) seg->lanes[i].heartbeat = now;
+    seg->magic = LAN_SHM_MAGIC;
+    seg->version = LAN_SHM_VERSION;
+    seg->owner_pid = shm->pid;
+    seg->owner_heartbeat = now;
+    shm->heartbeat_at = now + LAN_SHM_HEARTBEAT_MS;
+    shm->owner_stamp_at = now + LAN_SHM_HEARTBEAT_MS;
+    LAN_STORE_RELEASE(&seg->generation, generation);
+    LAN_STORE_RELEASE(&seg->active, 1);
+    return shm;
+}
+
+static void shm_detach(LanShm* shm, LanShmPeer* peer) {
+    if (!peer->seg) return;
+    // Give the lane back if the inbox is still the one we claimed it in.
+    LanShmLane* lane = &peer->seg->lanes[peer->lane];
+    if (LAN_LOAD_ACQUIRE(&peer->seg->generation) == peer->generation &&
+        LAN_LOAD_ACQUIRE(&lane->sender_port) == shm->port) {
+        LAN_STORE_RELEASE(&lane->sender_pid, 0u);
+        LAN_STORE_RELEASE(&lane->heartbeat, (uint32_t)get_time_ms());
+        LAN_CAS(&lane->sender_port, (uint32_t)shm->port, 0u);
+    }
+    shm_unmap(peer->seg, peer->handle);
+    peer->seg = NULL;
+    peer->handle = SHM_NO_HANDLE;
+}
+
+void lan_shm_destroy(LanShm* shm) {
+    if (!shm) return;
+
+    for (int i = 0; i < LAN_SHM_MAX_PEERS; i++) {
+        if (shm->peers[i].in_use) shm_detach(shm, &shm->peers[i]);
+    }
+
+    // Tell attached senders we're gone before the name disappears.
+    LAN_STORE_RELEASE(&shm->inbox->active, 0);
+    shm_unmap(shm->inbox, shm->inbox_handle);
+#ifndef _WIN32
+    shm_unlink(shm->name);
+#endif
+    free(shm);
+}
+
+// Take over a lane whose sender is stale. Whoever swaps the dead pid for
+// its own wins the lane. Only drained lanes are taken, so the owner never
+// reads a dead sender's datagrams as ours.
+static bool shm_reclaim_lane(LanShm* shm, LanShmLane* lane, uint32_t now) {
+    uint32_t port = LAN_LOAD_ACQUIRE(&lane->sender_port);
+    uint32_t pid = LAN_LOAD_ACQUIRE(&lane->sender_pid);
+    if (port == 0 || port == shm->port) return false;
+    if (LAN_LOAD_ACQUIRE(&lane->head) != LAN_LOAD_ACQUIRE(&lane->tail)) return false;
+    if (!shm_stale(pid, LAN_LOAD_ACQUIRE(&lane->heartbeat), now)) return false;
+    if (!LAN_CAS(&lane->sender_pid, pid, shm->pid)) return false;
+    LAN_STORE_RELEASE(&lane->heartbeat, now);
+    LAN_STORE_RELEASE(&lane->sender_port, (uint32_t)shm->port);
+    EOS_LOG_INFO("SHM: reclaimed inbox lane of stale sender port %u (pid %u)",
+                 (unsigned)port, (unsigned)pid);
+    return true;
+}
+
+// Attach to a peer's inbox and claim a lane in it: the one we already hold,
+// a free one, or failing that one whose sender is stale.
+static bool shm_attach(LanShm* shm, LanShmPeer* peer) {
+    LanShmSegment* seg = shm_map(peer->port, false, &peer->handle);
+    if (!seg) return false;
+
+    uint32_t now = (uint32_t)get_time_ms();
+    if (seg->magic != LAN_SHM_MAGIC || seg->version != LAN_SHM_VERSION ||
+        !shm_inbox_live(seg, now)) {
+        shm_unmap(seg, peer->handle);
+        return false;
+    }
+
+    uint32_t me = shm->port;
+    int lane = -1;
+    for (int i = 0; i < LAN_SHM_LANES && lane < 0; i++) {
+        if (LAN_LOAD_ACQUIRE(&seg->lanes[i].sender_port) == me) lane = i;
+    }
+    for (int i = 0; i < LAN_SHM_LANES && lane < 0; i++) {
+        if (LAN_CAS(&seg->lanes[i].sender_port, 0u, me)) lane = i;
+    }
+    for (int i = 0; i < LAN_SHM_LANES && lane < 0; i++) {
+        if (shm_reclaim_lane(shm, &seg->lanes[i], now)) lane = i;
+    }
+    if (lane < 0) {
+        shm_unmap(seg, peer->handle);
+        return false;
+    }
+    LAN_STORE_RELEASE(&seg->lanes[lane].sender_pid, shm->pid);
+    LAN_STORE_RELEASE(&seg->lanes[lane].heartbeat, now);
+
+    peer->seg = seg;
+    peer->lane = lane;
+    peer->generation = LAN_LOAD_ACQUIRE(&seg->generation);
+    return true;
+}
+
+// Find (or start tracking) the peer at addr:port. Returns NULL when the
+// address isn't same-host or the peer has no usable inbox right now.
+static LanShmPeer* shm_peer(LanShm* shm, uint32_t addr, uint16_t port) {
+    LanShmPeer* peer = NULL;
+    LanShmPeer* spare = NULL;
+    for (int i = 0; i < LAN_SHM_MAX_PEERS; i++) {
+        LanShmPeer* p = &shm->peers[i];
+        if (!p->in_use) {
+            if (!spare || spare->in_use) spare = p;
+            continue;
+        }
+        if (p->addr == addr && p->port == port) {
+            peer = p;
+            break;
+        }
+        // Remote addresses are cheap to re-learn; recycle their entries when
+        // the table is full.
+        if (!p->local && !spare) spare = p;
+    }
+
+    if (!peer) {
+        if (!spare) return NULL;
+        if (spare->in_use) shm_detach(shm, spare);
+        memset(spare, 0, sizeof(*spare));
+        spare->in_use = true;
+        spare->addr = addr;
+        spare->port = port;
+        char ip[16];
+        struct in_addr in;
+        in.s_addr = addr;
+        inet_ntop(AF_INET, &in, ip, sizeof(ip));
+        spare->local = is_local_address(ip);
+        peer = spare;
+    }
+
+    if (!peer->local) return NULL;
+    if (peer->seg) {
+        // The owner shut down or a new instance took over the port.
+        LanShmSegment* seg = peer->seg;
+        if (LAN_LOAD_ACQUIRE(&seg->active) &&
+            LAN_LOAD_ACQUIRE(&seg->generation) == peer->generation &&
+            LAN_LOAD_ACQUIRE(&seg->lanes[peer->lane].sender_port) == shm->port) {
+            return peer;
+        }
+        shm_detach(shm, peer);
+        peer->retry_at = 0;
+    }
+
+    uint64_t now = get_time_ms();
+    if (now < peer->retry_at) return NULL;
+    if (!shm_attach(shm, peer)) {
+        peer->retry_at = now + LAN_SHM_RETRY_MS;
+        return NULL;
+    }
+    return peer;
+}
+
+bool lan_shm_send(LanShm* shm, uint32_t ip, uint16_t port, const uint8_t* data, uint32_t len) {
+    if (!shm || !data || len == 0 || len > LAN_SHM_SLOT_BYTES) return false;
+
+    LanShmPeer* peer = shm_peer(shm, ip, port);
+    if (!peer) return false;
+
+    LanShmLane* lane = &peer->seg->lanes[peer->lane];
+    uint32_t tail = lane->tail;
+    if (tail - LAN_LOAD_ACQUIRE(&lane->head) >= LAN_SHM_SLOTS) {
+        // Owner is behind: drop it as a full socket buffer would. Sent by
+        // UDP it would overtake the datagrams still in the lane.
+        return true;
+    }
+
+    LanShmSlot* slot = &lane->slots[tail & (LAN_SHM_SLOTS - 1)];
+    slot->len = len;
+    memcpy(slot->data, data, len);
+    LAN_STORE_RELEASE(&lane->tail, tail + 1);
+    return true;
+}
+
+// Refresh the stamp of every lane we hold. Inboxes whose owner has gone
+// stale are let go; sends fall back to UDP until a new owner takes over the
+// port. peers[] belongs to the sending thread, so this runs there.
+void lan_shm_tick(LanShm* shm) {
+    if (!shm) return;
+    uint64_t now = get_time_ms();
+    if (now < shm->heartbeat_at) return;
+
+    uint32_t stamp = (uint32_t)now;
+    for (int i = 0; i < LAN_SHM_MAX_PEERS; i++) {
+        LanShmPeer* peer = &shm->peers[i];
+        if (!peer->in_use || !peer->seg) continue;
+        if (!shm_inbox_live(peer->seg, stamp)) {
+            shm_detach(shm, peer);
+            peer->retry_at = now + LAN_SHM_RETRY_MS;
+            continue;
+        }
+        LanShmLane* lane = &peer->seg->lanes[peer->lane];
+        if (LAN_LOAD_ACQUIRE(&lane->sender_port) == shm->port) {
+            LAN_STORE_RELEASE(&lane->heartbeat, stamp);
+        }
+    }
+    shm->heartbeat_at = now + LAN_SHM_HEARTBEAT_MS;
+}
+
+int lan_shm_recv(LanShm* shm, uint8_t* buf, uint32_t buf_size, uint16_t* out_from_port) {
+    if (!shm || !buf) return -1;
+
+    // The receiving thread vouches for the inbox owner; lane stamps are
+    // refreshed by the sending thread (lan_shm_tick).
+    LanShmSegment* seg = shm->inbox;
+    uint64_t now = get_time_ms();
+    if (now >= shm->owner_stamp_at) {
+        LAN_STORE_RELEASE(&seg->owner_heartbeat, (uint32_t)now);
+        shm->owner_stamp_at = now + LAN_SHM_HEARTBEAT_MS;
+    }
+
+    for (int i = 0; i < LAN_SHM_LANES; i++) {
+        int idx = (shm->next_lane + i) % LAN_SHM_LANES;
+        LanShmLane* lane = &seg->lanes[idx];
+        uint32_t head = lane->head;
+        if (head == LAN_LOAD_ACQUIRE(&lane->tail)) continue;
+
+        LanShmSlot* slot = &lane->slots[head & (LAN_SHM_SLOTS - 1)];
+        uint32_t len = slot->len;
+        if (len > LAN_SHM_SLOT_BYTES) len = 0;  // corrupt - skip it
+        if (len > buf_size) len = buf_size;
+        memcpy(buf, slot->data, len);
+        if (out_from_port) *out_from_port = (uint16_t)LAN_LOAD_ACQUIRE(&lane->sender_port);
+        LAN_STORE_RELEASE(&lane->head, head + 1);
+
+        shm->next_lane = (idx + 1) % LAN_SHM_LANES;
+        if (len == 0) continue;
+        return (int)len;
+    }
+    return -1;
+}
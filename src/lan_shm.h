@@ -0,0 +1,64 @@
+#ifndef EOS_LAN_SHM_H
+#define EOS_LAN_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Same-host P2P fast path.
+ *
+ * Every instance owns an inbox segment in shared memory named after its bound
+ * P2P UDP port (unique per machine). A sender that targets a local address
+ * attaches to the peer's inbox, claims one of its lanes and writes whole wire
+ * datagrams into that lane's single-producer/single-consumer ring, skipping
+ * the socket and the loopback stack. Anything that can't go this way (remote
+ * peer, no inbox, oversize datagram) falls back to UDP. A datagram that finds
+ * its lane full is dropped, as a full socket buffer would drop it; sending it
+ * by UDP would let it overtake the ones still in the lane.
+ *
+ * Owners and senders stamp their inbox and lanes with their pid and a
+ * heartbeat. A lane held by a sender that crashed is reclaimed by the next
+ * sender that needs one, and an inbox whose owner crashed is no longer used.
+ *
+ * Disable with EOSLAN_SHM=0.
+ */
+typedef struct LanShm LanShm;
+
+/**
+ * Create this instance's inbox for the given P2P port.
+ *
+ * @return Handle, or NULL if disabled or shared memory is unavailable
+ */
+LanShm* lan_shm_create(uint16_t port);
+
+/**
+ * Detach from all peers and remove the inbox.
+ */
+void lan_shm_destroy(LanShm* shm);
+
+/**
+ * Deliver a datagram to a same-host peer's inbox.
+ *
+ * @param ip Target IPv4 address, network byte order (only local addresses are eligible)
+ * @param port Target P2P port
+ * @return true if taken (delivered, or dropped on a full lane); false means
+ *         the caller should use UDP
+ */
+bool lan_shm_send(LanShm* shm, uint32_t ip, uint16_t port, const uint8_t* data, uint32_t len);
+
+/**
+ * Refresh this instance's stamps in the peer inboxes it sends to and let go
+ * of inboxes whose owner has crashed. Call regularly from the thread that
+ * calls lan_shm_send.
+ */
+void lan_shm_tick(LanShm* shm);
+
+/**
+ * Take the next datagram from the inbox.
+ *
+ * @param out_from_port Receives the sender's P2P port
+ * @return Datagram length, or -1 if the inbox is empty
+ */
+int lan_shm_recv(LanShm* shm, uint8_t* buf, uint32_t buf_size, uint16_t* out_from_port);
+
+#endif // EOS_LAN_SHM_H
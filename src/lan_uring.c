@@ -0,0 +1,406 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // struct mmsghdr
+#endif
+#include "lan_uring.h"
+#include "lan_common.h"
+#include <string.h>
+#include <stdlib.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+// Multishot RECVMSG (Linux 6.0) is the newest feature used; its flag is a
+// macro, unlike the enum values, so headers older than that build the stubs
+// at the bottom.
+#ifdef IORING_RECV_MULTISHOT
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define URING_TX_ENTRIES 64       // >= P2P_BATCH datagrams per flush
+#define URING_RX_ENTRIES 4        // only the multishot receive and its cancel
+#define URING_RX_CQ_ENTRIES 512   // receive completions between two reaps
+#define URING_BUFS 256            // provided receive buffers (power of 2)
+#define URING_PAYLOAD 4096        // MAX_P2P_PACKET in lan_p2p.c
+#define URING_BUF_BYTES (sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + URING_PAYLOAD)
+#define URING_BGID 0
+
+#define URING_TAG_RECV 1
+#define URING_TAG_SEND 2
+#define URING_TAG_CANCEL 3
+
+// One mapped io_uring instance.
+typedef struct {
+    int fd;
+    void* sq_map;
+    size_t sq_map_len;
+    void* cq_map;
+    size_t cq_map_len;
+    struct io_uring_sqe* sqes;
+    size_t sqes_len;
+    uint32_t sq_entries;
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_mask;
+    uint32_t* sq_array;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t* cq_mask;
+    struct io_uring_cqe* cqes;
+} UringQueue;
+
+struct LanUring {
+    int socket_fd;
+    UringQueue tx;
+    UringQueue rx;
+
+    // Provided receive buffers: the ring the kernel picks from, and the
+    // URING_BUFS buffers it points at.
+    struct io_uring_buf_ring* buf_ring;
+    uint8_t* buf_mem;
+    uint16_t buf_tail;
+
+    struct msghdr recv_msg;  // multishot template: room for the sender address only
+    bool armed;              // a multishot receive is pending in the kernel
+    bool rx_failed;          // the kernel refused it; the caller reads the socket
+    uint32_t tx_unreaped;    // send completions a failed wait left in the queue
+};
+
+static int uring_setup(uint32_t entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, uint32_t opcode, void* arg, uint32_t nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void queue_close(UringQueue* q) {
+    if (q->sqes) munmap(q->sqes, q->sqes_len);
+    if (q->cq_map) munmap(q->cq_map, q->cq_map_len);
+    if (q->sq_map) munmap(q->sq_map, q->sq_map_len);
+    if (q->fd >= 0) close(q->fd);
+    memset(q, 0, sizeof(*q));
+    q->fd = -1;
+}
+
+static bool queue_open(UringQueue* q, uint32_t entries, uint32_t cq_entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    if (cq_entries) {
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = cq_entries;
+    }
+    memset(q, 0, sizeof(*q));
+    q->fd = uring_setup(entries, &p);
+    if (q->fd < 0) return false;
+
+    q->sq_entries = p.sq_entries;
+    q->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    q->cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    q->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    void* sq = mmap(NULL, q->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    q->fd, IORING_OFF_SQ_RING);
+    void* cq = mmap(NULL, q->cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    q->fd, IORING_OFF_CQ_RING);
+    void* sqes = mmap(NULL, q->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      q->fd, IORING_OFF_SQES);
+    q->sq_map = (sq == MAP_FAILED) ? NULL : sq;
+    q->cq_map = (cq == MAP_FAILED) ? NULL : cq;
+    q->sqes = (sqes == MAP_FAILED) ? NULL : sqes;
+    if (!q->sq_map || !q->cq_map || !q->sqes) {
+        queue_close(q);
+        return false;
+    }
+
+    uint8_t* s = q->sq_map;
+    q->sq_head = (uint32_t*)(s + p.sq_off.head);
+    q->sq_tail = (uint32_t*)(s + p.sq_off.tail);
+    q->sq_mask = (uint32_t*)(s + p.sq_off.ring_mask);
+    q->sq_array = (uint32_t*)(s + p.sq_off.array);
+    uint8_t* c = q->cq_map;
+    q->cq_head = (uint32_t*)(c + p.cq_off.head);
+    q->cq_tail = (uint32_t*)(c + p.cq_off.tail);
+    q->cq_mask = (uint32_t*)(c + p.cq_off.ring_mask);
+    q->cqes = (struct io_uring_cqe*)(c + p.cq_off.cqes);
+    return true;
+}
+
+// Next free submission entry, cleared; NULL when the queue is full. Made
+// visible to the kernel by queue_publish.
+static struct io_uring_sqe* queue_sqe(UringQueue* q, uint32_t* tail) {
+    if (*tail - LAN_LOAD_ACQUIRE(q->sq_head) >= q->sq_entries) return NULL;
+    uint32_t idx = *tail & *q->sq_mask;
+    struct io_uring_sqe* sqe = &q->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    q->sq_array[idx] = idx;
+    (*tail)++;
+    return sqe;
+}
+
+static void queue_publish(UringQueue* q, uint32_t tail) {
+    LAN_STORE_RELEASE(q->sq_tail, tail);
+}
+
+// Oldest unread completion, or NULL. Consumed by queue_advance.
+static struct io_uring_cqe* queue_cqe(UringQueue* q) {
+    uint32_t head = *q->cq_head;
+    if (head == LAN_LOAD_ACQUIRE(q->cq_tail)) return NULL;
+    return &q->cqes[head & *q->cq_mask];
+}
+
+static void queue_advance(UringQueue* q) {
+    LAN_STORE_RELEASE(q->cq_head, *q->cq_head + 1);
+}
+
+static uint8_t* recv_buffer(LanUring* ring, uint16_t bid) {
+    return ring->buf_mem + (size_t)bid * URING_BUF_BYTES;
+}
+
+// Hand a receive buffer back to the kernel.
+static void recycle_buffer(LanUring* ring, uint16_t bid) {
+    struct io_uring_buf* b = &ring->buf_ring->bufs[ring->buf_tail & (URING_BUFS - 1)];
+    b->addr = (uint64_t)(uintptr_t)recv_buffer(ring, bid);
+    b->len = (uint32_t)URING_BUF_BYTES;
+    b->bid = bid;
+    ring->buf_tail++;
+    LAN_STORE_RELEASE(&ring->buf_ring->tail, ring->buf_tail);
+}
+
+LanUring* lan_uring_create(int socket_fd) {
+    LanUring* ring = calloc(1, sizeof(LanUring));
+    if (!ring) return NULL;
+    ring->socket_fd = socket_fd;
+    ring->tx.fd = -1;
+    ring->rx.fd = -1;
+
+    if (!queue_open(&ring->tx, URING_TX_ENTRIES, URING_TX_ENTRIES * 2) ||
+        !queue_open(&ring->rx, URING_RX_ENTRIES, URING_RX_CQ_ENTRIES)) {
+        lan_uring_destroy(ring);
+        return NULL;
+    }
+
+    // The buffer ring must be page aligned; one page holds 256 entries.
+    void* br = mmap(NULL, URING_BUFS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* mem = mmap(NULL, URING_BUFS * URING_BUF_BYTES, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring->buf_ring = (br == MAP_FAILED) ? NULL : br;
+    ring->buf_mem = (mem == MAP_FAILED) ? NULL : mem;
+    if (!ring->buf_ring || !ring->buf_mem) {
+        lan_uring_destroy(ring);
+        return NULL;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = URING_BUFS;
+    reg.bgid = URING_BGID;
+    if (uring_register(ring->rx.fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        lan_uring_destroy(ring);
+        return NULL;
+    }
+    for (uint16_t i = 0; i < URING_BUFS; i++) {
+        recycle_buffer(ring, i);
+    }
+
+    // No iovec: with buffer select the payload goes into the picked buffer,
+    // after a recvmsg_out header and the sender address.
+    ring->recv_msg.msg_namelen = sizeof(struct sockaddr_in);
+    return ring;
+}
+
+void lan_uring_destroy(LanUring* ring) {
+    if (!ring) return;
+
+    // Cancel the multishot receive before its buffers go away.
+    if (ring->armed && ring->rx.fd >= 0) {
+        uint32_t tail = *ring->rx.sq_tail;
+        struct io_uring_sqe* sqe = queue_sqe(&ring->rx, &tail);
+        if (sqe) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = URING_TAG_RECV;
+            sqe->user_data = URING_TAG_CANCEL;
+            queue_publish(&ring->rx, tail);
+            uring_enter(ring->rx.fd, 1, 1, IORING_ENTER_GETEVENTS);
+        }
+    }
+
+    if (ring->tx.fd >= 0 || ring->tx.sq_map) queue_close(&ring->tx);
+    if (ring->rx.fd >= 0 || ring->rx.sq_map) queue_close(&ring->rx);
+    if (ring->buf_mem) munmap(ring->buf_mem, URING_BUFS * URING_BUF_BYTES);
+    if (ring->buf_ring) munmap(ring->buf_ring, URING_BUFS * sizeof(struct io_uring_buf));
+    free(ring);
+}
+
+int lan_uring_send(LanUring* ring, struct mmsghdr* msgs, int count) {
+    if (!ring || count <= 0) return 0;
+
+    UringQueue* q = &ring->tx;
+    uint32_t tail = *q->sq_tail;
+    uint32_t queued = 0;
+    while (queued < (uint32_t)count) {
+        struct io_uring_sqe* sqe = queue_sqe(q, &tail);
+        if (!sqe) break;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = ring->socket_fd;
+        sqe->addr = (uint64_t)(uintptr_t)&msgs[queued].msg_hdr;
+        sqe->len = 1;
+        // MSG_DONTWAIT: a full socket buffer fails the send (the datagram is
+        // dropped, as with sendmmsg) instead of parking it for a retry that
+        // would read the buffers after we return.
+        sqe->msg_flags = MSG_DONTWAIT;
+        sqe->user_data = URING_TAG_SEND;
+        queued++;
+    }
+    if (queued == 0) return 0;
+    queue_publish(q, tail);
+
+    // Non-blocking sends complete during submission, so waiting for all of
+    // them costs nothing extra and frees the caller's buffers. Completions an
+    // earlier call could not wait for are reaped along with this batch.
+    uint32_t to_submit = queued;
+    uint32_t waiting = queued + ring->tx_unreaped;
+    ring->tx_unreaped = 0;
+    while (waiting > 0) {
+        int ret = uring_enter(q->fd, to_submit, waiting, IORING_ENTER_GETEVENTS);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            if (to_submit == 0) {
+                // Cannot wait any longer; the next call reaps the rest so
+                // they are not counted against its own batch.
+                ring->tx_unreaped = waiting;
+                break;
+            }
+            // Take back what the kernel never picked up: it points at the
+            // caller's buffers, which the caller now sends itself. The sends
+            // it did consume still post completions; wait for those.
+            LAN_STORE_RELEASE(q->sq_tail, *q->sq_tail - to_submit);
+            queued -= to_submit;
+            waiting -= to_submit;
+            to_submit = 0;
+            continue;
+        }
+        if (ret > 0) to_submit = (uint32_t)ret >= to_submit ? 0 : to_submit - (uint32_t)ret;
+        struct io_uring_cqe* cqe;
+        while (waiting > 0 && (cqe = queue_cqe(q)) != NULL) {
+            queue_advance(q);
+            waiting--;
+        }
+    }
+    return (int)queued;
+}
+
+static bool arm_recv(LanUring* ring) {
+    uint32_t tail = *ring->rx.sq_tail;
+    struct io_uring_sqe* sqe = queue_sqe(&ring->rx, &tail);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = ring->socket_fd;
+    sqe->addr = (uint64_t)(uintptr_t)&ring->recv_msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = URING_TAG_RECV;
+    queue_publish(&ring->rx, tail);
+    if (uring_enter(ring->rx.fd, 1, 0, 0) != 1) return false;
+    ring->armed = true;
+    return true;
+}
+
+int lan_uring_recv(LanUring* ring, uint8_t* buf, uint32_t buf_size, struct sockaddr_in* from) {
+    if (!ring || ring->rx_failed) return -1;
+
+    for (;;) {
+        // The receive stops when it runs out of buffers or completion space;
+        // by then the buffers it filled are back, so arm it again.
+        if (!ring->armed && !arm_recv(ring)) return -1;
+
+        struct io_uring_cqe* cqe = queue_cqe(&ring->rx);
+        if (!cqe) return -1;
+        int res = cqe->res;
+        uint32_t flags = cqe->flags;
+        uint64_t tag = cqe->user_data;
+        queue_advance(&ring->rx);
+        if (tag != URING_TAG_RECV) continue;
+        if (!(flags & IORING_CQE_F_MORE)) ring->armed = false;
+
+        if (res < 0) {
+            if (res == -EINVAL || res == -EOPNOTSUPP) {
+                ring->rx_failed = true;  // kernel without multishot RECVMSG
+                return -1;
+            }
+            continue;  // -ENOBUFS and friends: re-armed above
+        }
+        if (!(flags & IORING_CQE_F_BUFFER)) continue;
+
+        uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+        uint8_t* b = recv_buffer(ring, bid);
+        struct io_uring_recvmsg_out out;
+        memcpy(&out, b, sizeof(out));
+        size_t offset = sizeof(out) + ring->recv_msg.msg_namelen + ring->recv_msg.msg_controllen;
+        uint32_t len = (uint32_t)res > offset ? (uint32_t)(res - offset) : 0;
+        if (len > out.payloadlen) len = out.payloadlen;
+        if (len > buf_size) len = buf_size;
+
+        memset(from, 0, sizeof(*from));
+        memcpy(from, b + sizeof(out), out.namelen < sizeof(*from) ? out.namelen : sizeof(*from));
+        memcpy(buf, b + offset, len);
+        recycle_buffer(ring, bid);
+        return (int)len;
+    }
+}
+
+bool lan_uring_receiving(LanUring* ring) {
+    return ring && !ring->rx_failed;
+}
+
+int lan_uring_fd(LanUring* ring) {
+    return ring ? ring->rx.fd : -1;
+}
+
+#else
+
+LanUring* lan_uring_create(int socket_fd) {
+    (void)socket_fd;
+    return NULL;
+}
+
+void lan_uring_destroy(LanUring* ring) {
+    (void)ring;
+}
+
+int lan_uring_send(LanUring* ring, struct mmsghdr* msgs, int count) {
+    (void)ring; (void)msgs; (void)count;
+    return 0;
+}
+
+int lan_uring_recv(LanUring* ring, uint8_t* buf, uint32_t buf_size, struct sockaddr_in* from) {
+    (void)ring; (void)buf; (void)buf_size; (void)from;
+    return -1;
+}
+
+bool lan_uring_receiving(LanUring* ring) {
+    (void)ring;
+    return false;
+}
+
+int lan_uring_fd(LanUring* ring) {
+    (void)ring;
+    return -1;
+}
+
+#endif
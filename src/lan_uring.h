@@ -0,0 +1,65 @@
+#ifndef EOS_LAN_URING_H
+#define EOS_LAN_URING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * io_uring transport for the P2P UDP socket (Linux only).
+ *
+ * Two rings per socket, so the receiving thread (game thread or I/O thread)
+ * and the sending game thread never share one. Receives use a single
+ * multishot RECVMSG into a ring of kernel-provided buffers: the kernel keeps
+ * filling completions as datagrams land, and reading them is a memory load,
+ * not a syscall. Sends are SENDMSG entries submitted together with one
+ * io_uring_enter per flush.
+ *
+ * Enable with EOSLAN_IO_URING=1. Everything that can't use the ring (old
+ * kernel, io_uring disabled, no header at build time) falls back to
+ * recvmmsg / sendmmsg.
+ */
+typedef struct LanUring LanUring;
+
+struct mmsghdr;
+struct sockaddr_in;
+
+/**
+ * Set up the rings and provided receive buffers for a bound UDP socket.
+ *
+ * @return Handle, or NULL if io_uring is unavailable
+ */
+LanUring* lan_uring_create(int socket_fd);
+
+/**
+ * Cancel the pending receive and release the rings. The socket stays open.
+ */
+void lan_uring_destroy(LanUring* ring);
+
+/**
+ * Send datagrams (one msghdr each) with a single submission. Returns once
+ * the kernel is done with them, so the buffers may be reused right away.
+ *
+ * @return How many datagrams were handed to the kernel; the caller sends the rest itself
+ */
+int lan_uring_send(LanUring* ring, struct mmsghdr* msgs, int count);
+
+/**
+ * Take the next received datagram, arming the multishot receive first if
+ * needed. Call from one thread only.
+ *
+ * @return Datagram length, or -1 if none has completed yet
+ */
+int lan_uring_recv(LanUring* ring, uint8_t* buf, uint32_t buf_size, struct sockaddr_in* from);
+
+/**
+ * Whether receives go through the ring. Turns false for good when the
+ * kernel rejects the multishot receive; the caller then reads the socket.
+ */
+bool lan_uring_receiving(LanUring* ring);
+
+/**
+ * Descriptor that polls readable while received datagrams are waiting.
+ */
+int lan_uring_fd(LanUring* ring);
+
+#endif // EOS_LAN_URING_H
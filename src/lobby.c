@@ -743,6 +743,9 @@ EOS_DECLARE_FUNC(void) EOS_Lobby_CreateLobby(
     /* Add the owner as the first member. */
     lobby_add_member(l, l->owner_id);
 
+    /* Members' P2P traffic can be addressed to the lobby as a whole. */
+    if (state->platform->p2p) p2p_group_join(state->platform->p2p, l->lobby_id);
+
     state->local_lobby_count++;
 
     /* Start announcing immediately. */
@@ -806,6 +809,9 @@ EOS_DECLARE_FUNC(void) EOS_Lobby_DestroyLobby(
     /* This lobby drove our presence join-info; drop it so friends stop seeing us
      * as joinable. */
     if (l->presence_enabled) social_bridge_clear_lobby_presence();
+    if (state->platform && state->platform->p2p) {
+        p2p_group_leave(state->platform->p2p, l->lobby_id);
+    }
 
     index = (int)(l - state->local_lobbies);
     if (index >= 0 && index < state->local_lobby_count) {
@@ -868,6 +874,10 @@ static EOS_EResult lobby_join_common(LobbyState* state, const Lobby* snapshot,
     if (state->platform && state->platform->p2p && l->owner_id &&
         l->host_address[0] != '\0') {
         p2p_register_peer_address(state->platform->p2p, l->owner_id, l->host_address);
+        p2p_prewarm_peer(state->platform->p2p, l->owner_id);
+    }
+    if (state->platform && state->platform->p2p) {
+        p2p_group_join(state->platform->p2p, l->lobby_id);
     }
 
     state->local_lobby_count++;
@@ -1010,6 +1020,9 @@ EOS_DECLARE_FUNC(void) EOS_Lobby_LeaveLobby(
     lobby_fire_member_status(state, Options->LobbyId, Options->LocalUserId, EOS_LMS_LEFT);
 
     if (l->presence_enabled) social_bridge_clear_lobby_presence();
+    if (state->platform && state->platform->p2p) {
+        p2p_group_leave(state->platform->p2p, l->lobby_id);
+    }
 
     index = (int)(l - state->local_lobbies);
     if (index >= 0 && index < state->local_lobby_count) {
@@ -2,12 +2,15 @@
 
 #include "eos/eos_p2p.h"
 #include "eos/eos_p2p_types.h"
+#include "eoslan/eoslan_p2p.h"
 #include "internal/p2p_internal.h"
 #include "internal/platform_internal.h"
 #include "internal/connect_internal.h"
 #include "internal/callbacks.h"
 #include "internal/logging.h"
+#include "lan_common.h"
 #include "lan_p2p.h"
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -25,20 +28,79 @@
 #define MSG_CONNECT 2
 #define MSG_ACCEPT  3
 #define MSG_CLOSE   4
-
-// Re-send an unanswered CONNECT at most this often (ms).
-#define P2P_CONNECT_RESEND_MS 250
-
-// Helper: Get current time in milliseconds
-static uint64_t get_time_ms(void) {
-#ifdef _WIN32
-    return GetTickCount64();
-#else
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-#endif
-}
+#define MSG_ACK     5
+#define MSG_BUNDLE  6
+#define MSG_PING    7
+#define MSG_PONG    8
+#define MSG_MCAST   9
+#define MSG_GROUP   10
+#define MSG_FEC     11
+
+// MSG_GROUP kinds. A member probes each of its multicast groups every
+// P2P_GROUP_PROBE_MS; a peer that hears the probe answers HEARD, the prober
+// then multicasts to it and answers CONFIRM, after which the peer takes the
+// prober's MSG_MCAST DATA for that group. LEFT undoes it and ends the
+// membership. Membership itself is unicast, whether or not multicast is on:
+// each side sends JOINED to its established peers, a peer in the same group
+// answers MEMBER, and either marks the sender as a member of the group.
+#define GROUP_PROBE   0
+#define GROUP_HEARD   1
+#define GROUP_CONFIRM 2
+#define GROUP_LEFT    3
+#define GROUP_JOINED  4
+#define GROUP_MEMBER  5
+#define P2P_GROUP_PROBE_MS 1000
+
+// Multicast group port (EOSLAN_P2P_MULTICAST_PORT).
+#define P2P_MCAST_PORT 7800
+
+// FEC defaults: packets per parity (EOSLAN_P2P_FEC_K, 25% overhead) and the
+// age at which a partial group is closed (EOSLAN_P2P_FEC_FLUSH_MS), which
+// bounds how late a rebuilt packet can be.
+#define P2P_FEC_K 4
+#define P2P_FEC_FLUSH_MS 50
+
+// Handshake retransmission: CONNECT (and CLOSE) re-sends back off
+// exponentially from the initial interval up to the cap, with +/-25% jitter.
+// An unanswered CONNECT is given up after EOSLAN_CONNECT_TIMEOUT_MS
+// (default P2P_CONNECT_TIMEOUT_MS); CLOSE is sent P2P_CLOSE_SENDS times.
+#define P2P_HANDSHAKE_RTO_INITIAL_MS 100
+#define P2P_HANDSHAKE_RTO_MAX_MS 2000
+#define P2P_CONNECT_TIMEOUT_MS 30000
+#define P2P_CLOSE_SENDS 3
+
+// Room for queued reliable DATA carried in a CONNECT payload (bytes).
+#define P2P_CONNECT_PAYLOAD_MAX 1200
+
+// Compression offer, appended to every CONNECT and sent as the ACCEPT
+// payload: marker(4) version(1) dictionary id(4). The marker reads as a
+// DATA record longer than the datagram, so a record walk stops at it.
+#define P2P_OFFER_SIZE 9
+#define P2P_OFFER_VERSION 1
+static const uint8_t p2p_offer_marker[4] = {0xFF, 0x00, 0xFF, 0xFF};
+
+// Payloads shorter than this are not worth compressing (bytes).
+#define P2P_COMPRESS_MIN 32
+
+// Outgoing-queue slots one connection may hold before it is established, so
+// a peer that never answers cannot take the whole queue from the others.
+#define P2P_CONNECTING_QUEUE_MAX (MAX_SEND_QUEUE / 4)
+
+// Liveness defaults (EOSLAN_P2P_KEEPALIVE_MS, EOSLAN_P2P_INTERRUPT_MS,
+// EOSLAN_P2P_IDLE_TIMEOUT_MS).
+#define P2P_KEEPALIVE_MS 1000
+#define P2P_INTERRUPT_MS 5000
+#define P2P_IDLE_TIMEOUT_MS 30000
+
+// Send pacer bucket size (EOSLAN_P2P_PACE_BURST), in bytes.
+#define P2P_PACE_BURST (64 * 1024)
+
+// Fair scheduler (EOSLAN_P2P_FAIR): bytes sent per tick by default
+// (EOSLAN_P2P_FAIR_BUDGET), and the deficit round robin quantum - one
+// max-size packet, so every connection with room sends at least one packet
+// per round.
+#define P2P_FAIR_BUDGET (128 * 1024)
+#define P2P_FAIR_QUANTUM EOS_P2P_MAX_PACKET_SIZE
 
 // Helper: Copy ProductUserId to string.
 // Emit the REAL 32-char hex (the same value that travels on the wire), not the
@@ -82,22 +144,215 @@ static bool socket_id_equal(const EOS_P2P_SocketId* a, const EOS_P2P_SocketId* b
     return strcmp(a->SocketName, b->SocketName) == 0;
 }
 
-// Helper: Find connection
-static PeerConnection* find_connection(P2PState* state, EOS_ProductUserId peer, const EOS_P2P_SocketId* socket_id) {
-    if (!state || !peer || !socket_id) return NULL;
+// Helper: FNV-1a hash of a peer's hex id, extended by the socket name when
+// one is given (conn_index) or not (peer_index).
+static uint32_t conn_key_hash(const char* hex, const char* socket_name) {
+    uint32_t h = 2166136261u;
+    for (const char* p = hex; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    if (socket_name) {
+        h = (h ^ 0xFFu) * 16777619u;  // separator: "ab"+"c" != "a"+"bc"
+        for (const char* p = socket_name; *p; p++) {
+            h = (h ^ (uint8_t)*p) * 16777619u;
+        }
+    }
+    return h;
+}
 
-    for (int i = 0; i < MAX_CONNECTIONS; i++) {
-        PeerConnection* conn = &state->connections[i];
-        if (!conn->valid) continue;
-        if (!product_user_id_equal(conn->peer_id, peer)) continue;
+static uint32_t conn_table_hash(const PeerConnection* conn, bool by_peer) {
+    return by_peer ? conn->peer_hash : conn->key_hash;
+}
+
+// Helper: Put a connection slot into one of the lookup tables
+static void conn_table_insert(P2PState* state, int16_t* table, bool by_peer, int slot) {
+    uint32_t mask = P2P_CONN_HASH_SIZE - 1;
+    uint32_t pos = conn_table_hash(&state->connections[slot], by_peer) & mask;
+    while (table[pos] != P2P_NO_SLOT) pos = (pos + 1) & mask;
+    table[pos] = (int16_t)slot;
+}
+
+// Helper: Take a connection slot out of a lookup table. Backward-shift
+// deletion keeps every probe run intact without tombstones.
+static void conn_table_remove(P2PState* state, int16_t* table, bool by_peer, int slot) {
+    uint32_t mask = P2P_CONN_HASH_SIZE - 1;
+    uint32_t pos = conn_table_hash(&state->connections[slot], by_peer) & mask;
+    while (table[pos] != slot) {
+        if (table[pos] == P2P_NO_SLOT) return;
+        pos = (pos + 1) & mask;
+    }
+
+    uint32_t hole = pos;
+    for (uint32_t next = (hole + 1) & mask; table[next] != P2P_NO_SLOT; next = (next + 1) & mask) {
+        uint32_t home = conn_table_hash(&state->connections[table[next]], by_peer) & mask;
+        // The entry may move back only if the hole lies between its home
+        // position and where it sits now.
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            table[hole] = table[next];
+            hole = next;
+        }
+    }
+    table[hole] = P2P_NO_SLOT;
+}
+
+// Helper: First connection to a peer (by hex id); the rest follow peer_next
+static PeerConnection* find_peer_connections(P2PState* state, const char* hex) {
+    uint32_t mask = P2P_CONN_HASH_SIZE - 1;
+    uint32_t h = conn_key_hash(hex, NULL);
+    for (uint32_t pos = h & mask; state->peer_index[pos] != P2P_NO_SLOT; pos = (pos + 1) & mask) {
+        PeerConnection* conn = &state->connections[state->peer_index[pos]];
+        if (conn->peer_hash == h && strcmp(conn->peer_id_string, hex) == 0) return conn;
+    }
+    return NULL;
+}
+
+static PeerConnection* next_peer_connection(P2PState* state, const PeerConnection* conn) {
+    return (conn->peer_next == P2P_NO_SLOT) ? NULL : &state->connections[conn->peer_next];
+}
+
+// Find a connection by the peer's 32-char hex id (used on the receive path,
+// where EOS_ProductUserId_FromString hands back a fresh pointer each call so
+// pointer identity cannot be relied upon).
+static PeerConnection* find_connection_by_hex(P2PState* state, const char* hex,
+                                              const EOS_P2P_SocketId* socket_id) {
+    if (!state || !hex || !socket_id) return NULL;
+    uint32_t mask = P2P_CONN_HASH_SIZE - 1;
+    uint32_t h = conn_key_hash(hex, socket_id->SocketName);
+    for (uint32_t pos = h & mask; state->conn_index[pos] != P2P_NO_SLOT; pos = (pos + 1) & mask) {
+        PeerConnection* conn = &state->connections[state->conn_index[pos]];
+        if (conn->key_hash != h) continue;
+        if (strcmp(conn->peer_id_string, hex) != 0) continue;
         if (!socket_id_equal(&conn->socket_id, socket_id)) continue;
         return conn;
     }
     return NULL;
 }
 
-// Helper: Create new connection
-static PeerConnection* create_connection(P2PState* state, EOS_ProductUserId peer, const EOS_P2P_SocketId* socket_id) {
+// Helper: handle_index entry for a ProductUserId handle and socket. The
+// first 8 bytes of the socket name are mixed in as one load, so a peer's
+// sockets get entries of their own without hashing the string.
+static P2PHandleEntry* handle_entry(P2PState* state, EOS_ProductUserId peer,
+                                    const EOS_P2P_SocketId* socket_id) {
+    uint64_t name;
+    memcpy(&name, socket_id->SocketName, sizeof(name));
+    uint64_t h = ((uint64_t)(uintptr_t)peer ^ name) * 0x9E3779B97F4A7C15ull;
+    return &state->handle_index[(h >> 32) & (P2P_CONN_HASH_SIZE - 1)];
+}
+
+// Helper: Find connection (send path). A repeat send to the same handle and
+// socket is answered from handle_index without touching the hex id.
+static PeerConnection* find_connection(P2PState* state, EOS_ProductUserId peer, const EOS_P2P_SocketId* socket_id) {
+    if (!state || !peer || !socket_id) return NULL;
+    P2PHandleEntry* entry = handle_entry(state, peer, socket_id);
+    if (entry->peer == peer) {
+        PeerConnection* conn = &state->connections[entry->slot];
+        if (socket_id_equal(&conn->socket_id, socket_id)) return conn;
+    }
+
+    char hex[33];
+    product_user_id_to_string(peer, hex, sizeof(hex));
+    PeerConnection* conn = find_connection_by_hex(state, hex, socket_id);
+    if (conn) {
+        entry->peer = peer;
+        entry->slot = (int16_t)(conn - state->connections);
+    }
+    return conn;
+}
+
+// Helper: Add a connection to both lookup tables (its id and socket are final)
+static void index_connection(P2PState* state, PeerConnection* conn) {
+    int slot = (int)(conn - state->connections);
+    conn->key_hash = conn_key_hash(conn->peer_id_string, conn->socket_id.SocketName);
+    conn->peer_hash = conn_key_hash(conn->peer_id_string, NULL);
+    conn_table_insert(state, state->conn_index, false, slot);
+
+    // Join the peer's chain; the table entry names the newest connection.
+    PeerConnection* head = find_peer_connections(state, conn->peer_id_string);
+    if (!head) {
+        conn->peer_next = P2P_NO_SLOT;
+        conn_table_insert(state, state->peer_index, true, slot);
+        return;
+    }
+    conn->peer_next = (int)(head - state->connections);
+    uint32_t mask = P2P_CONN_HASH_SIZE - 1;
+    uint32_t pos = conn->peer_hash & mask;
+    while (state->peer_index[pos] != conn->peer_next) pos = (pos + 1) & mask;
+    state->peer_index[pos] = (int16_t)slot;
+}
+
+// Helper: Remove a connection from both lookup tables
+static void unindex_connection(P2PState* state, PeerConnection* conn) {
+    int slot = (int)(conn - state->connections);
+    conn_table_remove(state, state->conn_index, false, slot);
+    for (int i = 0; i < P2P_CONN_HASH_SIZE; i++) {
+        if (state->handle_index[i].slot == slot) state->handle_index[i].peer = NULL;
+    }
+
+    PeerConnection* head = find_peer_connections(state, conn->peer_id_string);
+    if (head == conn) {
+        if (conn->peer_next == P2P_NO_SLOT) {
+            conn_table_remove(state, state->peer_index, true, slot);
+        } else {
+            uint32_t mask = P2P_CONN_HASH_SIZE - 1;
+            uint32_t pos = conn->peer_hash & mask;
+            while (state->peer_index[pos] != slot) pos = (pos + 1) & mask;
+            state->peer_index[pos] = (int16_t)conn->peer_next;
+        }
+    } else {
+        for (PeerConnection* c = head; c; c = next_peer_connection(state, c)) {
+            if (c->peer_next == slot) {
+                c->peer_next = conn->peer_next;
+                break;
+            }
+        }
+    }
+    conn->peer_next = P2P_NO_SLOT;
+}
+
+// Helper: Empty the lookup tables
+static void conn_index_reset(P2PState* state) {
+    for (int i = 0; i < P2P_CONN_HASH_SIZE; i++) {
+        state->conn_index[i] = P2P_NO_SLOT;
+        state->peer_index[i] = P2P_NO_SLOT;
+        state->handle_index[i].peer = NULL;
+        state->handle_index[i].slot = P2P_NO_SLOT;
+    }
+}
+
+// Helper: Set the peer's "IP:port" and its resolved form together
+static void set_peer_address(PeerConnection* conn, const char* address) {
+    strncpy(conn->peer_address, address, sizeof(conn->peer_address) - 1);
+    conn->peer_address[sizeof(conn->peer_address) - 1] = '\0';
+    if (!lan_p2p_resolve(conn->peer_address, &conn->addr)) {
+        memset(&conn->addr, 0, sizeof(conn->addr));
+    }
+}
+
+// Helper: Give a fresh connection slot its local token. The low byte is the
+// slot index so compact packets demux with one array lookup; the upper bits
+// change per connection so packets from a previous incarnation of the slot
+// (or of the peer) no longer match and are dropped.
+static void assign_local_token(P2PState* state, PeerConnection* conn) {
+    uint32_t slot = (uint32_t)(conn - state->connections);
+    do {
+        state->token_generation = (state->token_generation + 1) & 0xFFFFFF;
+    } while (state->token_generation == 0);
+    conn->local_token = (state->token_generation << 8) | slot;
+}
+
+// Helper: Find connection by the token carried in a compact header
+static PeerConnection* find_connection_by_token(P2PState* state, uint32_t token) {
+    uint32_t slot = token & 0xFF;
+    if (slot >= MAX_CONNECTIONS) return NULL;
+    PeerConnection* conn = &state->connections[slot];
+    if (!conn->valid || conn->local_token != token) return NULL;
+    return conn;
+}
+
+// Helper: Create new connection. `hex` keys it on the peer's wire id when
+// known; NULL derives it from `peer`.
+static PeerConnection* create_connection(P2PState* state, EOS_ProductUserId peer, const char* hex,
+                                         const EOS_P2P_SocketId* socket_id) {
     if (!state || !peer || !socket_id) return NULL;
 
     // Find free slot
@@ -108,11 +363,33 @@ static PeerConnection* create_connection(P2PState* state, EOS_ProductUserId peer
         // Initialize connection
         memset(conn, 0, sizeof(PeerConnection));
         conn->valid = true;
+        assign_local_token(state, conn);
         conn->peer_id = peer;
-        product_user_id_to_string(peer, conn->peer_id_string, sizeof(conn->peer_id_string));
+        if (hex) {
+            strncpy(conn->peer_id_string, hex, sizeof(conn->peer_id_string) - 1);
+            conn->peer_id_string[sizeof(conn->peer_id_string) - 1] = '\0';
+        } else {
+            product_user_id_to_string(peer, conn->peer_id_string, sizeof(conn->peer_id_string));
+        }
+        conn->peer_handle = EOS_ProductUserId_FromString(conn->peer_id_string);
+        if (!conn->peer_handle) conn->peer_handle = peer;
         copy_socket_id(&conn->socket_id, socket_id);
         conn->state = CONN_STATE_NONE;
         conn->last_activity = get_time_ms();
+        conn->send_first = P2P_NO_SLOT;
+        conn->send_last = P2P_NO_SLOT;
+        index_connection(state, conn);
+
+        // A pre-warmed path to this peer already measured the round trip,
+        // and multicast confirmed with the peer covers every socket.
+        for (PeerConnection* c = find_peer_connections(state, conn->peer_id_string); c;
+             c = next_peer_connection(state, c)) {
+            if (c == conn) continue;
+            conn->group_confirmed |= c->group_confirmed;
+            conn->group_accepted |= c->group_accepted;
+            conn->group_member |= c->group_member;
+            if (conn->rtt_hint_ms == 0) conn->rtt_hint_ms = c->rtt_hint_ms;
+        }
 
         state->connection_count++;
         return conn;
@@ -121,6 +398,59 @@ static PeerConnection* create_connection(P2PState* state, EOS_ProductUserId peer
     return NULL;  // No free slots
 }
 
+static void drop_queued_packets(P2PState* state, PeerConnection* conn);
+
+// Helper: Tear down a connection slot (drops its queued packets and frees
+// its reliability state)
+static void release_connection(P2PState* state, PeerConnection* conn) {
+    if (!state || !conn || !conn->valid) return;
+    drop_queued_packets(state, conn);
+    if (conn->rel) {
+        p2p_rel_destroy(conn->rel);
+        conn->rel = NULL;
+    }
+    p2p_fec_destroy(conn->fec);
+    conn->fec = NULL;
+    free(conn->frame);
+    conn->frame = NULL;
+    unindex_connection(state, conn);
+    conn->state = CONN_STATE_CLOSED;
+    conn->valid = false;
+    if (state->connection_count > 0) state->connection_count--;
+}
+
+// Helper: Reliability state for a connection, created on first use
+static ReliableState* connection_rel(PeerConnection* conn) {
+    if (!conn) return NULL;
+    if (!conn->rel) {
+        conn->rel = p2p_rel_create();
+        if (conn->rtt_hint_ms != 0) p2p_rel_seed_rto(conn->rel, conn->rtt_hint_ms);
+    }
+    return conn->rel;
+}
+
+// Helper: FEC state for a connection, created on first use
+static FecState* connection_fec(PeerConnection* conn) {
+    if (!conn) return NULL;
+    if (!conn->fec) conn->fec = p2p_fec_create();
+    return conn->fec;
+}
+
+// Helper: A connection without a socket name is the address book entry for
+// a peer. It only ever carries the pre-warm handshake (p2p_prewarm_peer) and
+// is never reported to the game.
+static bool is_transport_connection(const PeerConnection* conn) {
+    return conn->socket_id.SocketName[0] == '\0';
+}
+
+// Helper: Whether DATA may go out on a connection: it is established, or it
+// is a fast-start connection to a pre-warmed peer still waiting for its ACCEPT
+// (p2p_open_connection).
+static bool can_transmit(const PeerConnection* conn) {
+    return conn->state == CONN_STATE_ESTABLISHED ||
+           (conn->state == CONN_STATE_REQUESTING && conn->fast_start);
+}
+
 // Helper: Check if socket is auto-accepted
 static bool is_socket_auto_accepted(P2PState* state, const EOS_P2P_SocketId* socket_id) {
     if (!state || !socket_id) return false;
@@ -135,46 +465,229 @@ static bool is_socket_auto_accepted(P2PState* state, const EOS_P2P_SocketId* soc
     return false;
 }
 
-// Helper: Queue received packet
-static bool queue_received_packet(P2PState* state, const ReceivedPacket* packet) {
-    if (!state || !packet) return false;
+// Helper: Empty the receive queue and chain every slot onto the free list
+static void recv_queue_reset(P2PState* state) {
+    for (int i = 0; i < MAX_RECV_QUEUE; i++) {
+        ReceivedPacket* pkt = &state->recv_queue[i];
+        if (pkt->valid) p2p_pool_free(&state->pool, pkt->block, pkt->block_size);
+        pkt->data = NULL;
+        pkt->block = NULL;
+        pkt->valid = false;
+        pkt->borrow_id = 0;
+        pkt->next = (i + 1 < MAX_RECV_QUEUE) ? i + 1 : P2P_NO_SLOT;
+        pkt->prev = P2P_NO_SLOT;
+        pkt->channel_next = P2P_NO_SLOT;
+        pkt->channel_prev = P2P_NO_SLOT;
+    }
+    state->recv_free = 0;
+    state->recv_first = P2P_NO_SLOT;
+    state->recv_last = P2P_NO_SLOT;
+    for (int ch = 0; ch < P2P_CHANNELS; ch++) {
+        state->channel_first[ch] = P2P_NO_SLOT;
+        state->channel_last[ch] = P2P_NO_SLOT;
+        state->channel_bytes[ch] = 0;
+    }
+    state->recv_count = 0;
+    state->incoming_queue_current_bytes = 0;
+    state->incoming_queue_full = false;
+}
 
-    // Check if queue is full
-    if (state->recv_count >= MAX_RECV_QUEUE) {
-        EOS_LOG_WARN("P2P: Received packet queue full, dropping packet");
+// Helper: The receive-queue slot the next packet will occupy, or NULL if the
+// queue is full.
+static ReceivedPacket* recv_queue_free_slot(P2PState* state) {
+    if (state->recv_free == P2P_NO_SLOT) return NULL;
+    return &state->recv_queue[state->recv_free];
+}
 
-        // TODO: Fire queue full notification
+// Helper: Oldest queued packet, optionally restricted to one channel
+static ReceivedPacket* recv_queue_peek(P2PState* state, const uint8_t* channel) {
+    int idx = channel ? state->channel_first[*channel] : state->recv_first;
+    return (idx == P2P_NO_SLOT) ? NULL : &state->recv_queue[idx];
+}
 
-        return false;
-    }
+// Helper: Unlink a queued packet from both lists. Its slot and payload stay
+// in use (and count against the queue limits) until recv_queue_free.
+static void recv_queue_unlink(P2PState* state, ReceivedPacket* pkt) {
+    if (pkt->prev != P2P_NO_SLOT) state->recv_queue[pkt->prev].next = pkt->next;
+    else state->recv_first = pkt->next;
+    if (pkt->next != P2P_NO_SLOT) state->recv_queue[pkt->next].prev = pkt->prev;
+    else state->recv_last = pkt->prev;
+
+    if (pkt->channel_prev != P2P_NO_SLOT) state->recv_queue[pkt->channel_prev].channel_next = pkt->channel_next;
+    else state->channel_first[pkt->channel] = pkt->channel_next;
+    if (pkt->channel_next != P2P_NO_SLOT) state->recv_queue[pkt->channel_next].channel_prev = pkt->channel_prev;
+    else state->channel_last[pkt->channel] = pkt->channel_prev;
+    pkt->prev = pkt->next = pkt->channel_next = pkt->channel_prev = P2P_NO_SLOT;
+}
 
-    // Check queue size limit
-    if (state->incoming_queue_max_bytes > 0) {
-        if (state->incoming_queue_current_bytes + packet->size > state->incoming_queue_max_bytes) {
-            EOS_LOG_WARN("P2P: Incoming queue size limit exceeded");
-            return false;
+// Helper: Release an unlinked packet's payload and return its slot
+static void recv_queue_free(P2PState* state, ReceivedPacket* pkt) {
+    int idx = (int)(pkt - state->recv_queue);
+    state->channel_bytes[pkt->channel] -= pkt->size;
+    state->incoming_queue_current_bytes -= pkt->size;
+    state->recv_count--;
+    state->incoming_queue_full = false;
+
+    p2p_pool_free(&state->pool, pkt->block, pkt->block_size);
+    pkt->data = NULL;
+    pkt->block = NULL;
+    pkt->valid = false;
+    pkt->borrow_id = 0;
+    pkt->next = state->recv_free;
+    state->recv_free = idx;
+}
+
+// Helper: Take a queued packet out of the queue and return its slot
+static void recv_queue_remove(P2PState* state, ReceivedPacket* pkt) {
+    if (!pkt->valid || pkt->borrow_id != 0) return;
+    recv_queue_unlink(state, pkt);
+    recv_queue_free(state, pkt);
+}
+
+// Helper: Copy a queued packet out (payload truncated to max_size) and
+// remove it from the queue. Returns the number of bytes written.
+static uint32_t recv_queue_take(P2PState* state, ReceivedPacket* pkt, EOS_P2P_SocketId* out_socket,
+                                uint8_t* out_channel, void* out_data, uint32_t max_size) {
+    if (out_socket) copy_socket_id(out_socket, &pkt->socket_id);
+    if (out_channel) *out_channel = pkt->channel;
+
+    uint32_t copy_size = (pkt->size < max_size) ? pkt->size : max_size;
+    memcpy(out_data, pkt->data, copy_size);
+
+    // Remove from queue (also updates queue size tracking)
+    recv_queue_remove(state, pkt);
+    return copy_size;
+}
+
+static void p2p_fire_queue_full(P2PState* state, uint8_t channel, uint32_t size);
+
+// Helper: Queue received packet. A payload received in place (inside
+// state->recv_block) that would need a full-size block anyway takes that
+// block over; any other is copied into a pool block sized to fit.
+// A packet that does not fit (no free slot, or over the incoming byte limit)
+// is refused; the first refusal fires the queue-full notification. Reliable
+// DATA refused here is not acknowledged, so the sender retransmits it.
+static bool queue_received_packet(P2PState* state, const ReceivedPacket* header,
+                                  const uint8_t* data, uint32_t size) {
+    if (!state || !header) return false;
+
+    ReceivedPacket* slot = recv_queue_free_slot(state);
+    bool over_limit = state->incoming_queue_max_bytes > 0 &&
+                      state->incoming_queue_current_bytes + size > state->incoming_queue_max_bytes;
+    if (!slot || over_limit) {
+        if (!state->incoming_queue_full) {
+            EOS_LOG_WARN("P2P: Incoming packet queue full (%d packets, %llu/%llu bytes) - refusing packets",
+                         state->recv_count,
+                         (unsigned long long)state->incoming_queue_current_bytes,
+                         (unsigned long long)state->incoming_queue_max_bytes);
+            state->incoming_queue_full = true;
+            p2p_fire_queue_full(state, header->channel, size);
         }
+        return false;
     }
 
     // Add to queue
-    int idx = state->recv_tail;
-    memcpy(&state->recv_queue[idx], packet, sizeof(ReceivedPacket));
-    state->recv_tail = (state->recv_tail + 1) % MAX_RECV_QUEUE;
+    if (size > P2P_POOL_BLOCK_MAX) size = P2P_POOL_BLOCK_MAX;
+    uint8_t* block = state->recv_block;
+    uint32_t block_size = P2P_POOL_DATAGRAM;
+    uint8_t* payload;
+    if (block && size > P2P_POOL_ADOPT_MIN && data >= block && data + size <= block + block_size) {
+        state->recv_block = NULL;  // p2p_tick takes a fresh one for the next datagram
+        payload = (uint8_t*)data;
+    } else {
+        block_size = size;
+        block = p2p_pool_alloc(&state->pool, size);
+        if (!block) return false;
+        if (data && size > 0) memcpy(block, data, size);
+        payload = block;
+    }
+
+    int idx = state->recv_free;
+    state->recv_free = slot->next;
+
+    slot->sender = header->sender;
+    slot->sender_handle = header->sender_handle;
+    slot->arrival_us = header->arrival_us;
+    slot->borrow_id = 0;
+    memcpy(slot->sender_id_string, header->sender_id_string, sizeof(slot->sender_id_string));
+    copy_socket_id(&slot->socket_id, &header->socket_id);
+    slot->channel = header->channel;
+    slot->data = payload;
+    slot->size = size;
+    slot->block = block;
+    slot->block_size = block_size;
+    slot->valid = true;
+
+    // Append to the arrival-order list and to the channel's list.
+    slot->next = P2P_NO_SLOT;
+    slot->prev = state->recv_last;
+    if (state->recv_last != P2P_NO_SLOT) state->recv_queue[state->recv_last].next = idx;
+    else state->recv_first = idx;
+    state->recv_last = idx;
+
+    slot->channel_next = P2P_NO_SLOT;
+    slot->channel_prev = state->channel_last[slot->channel];
+    if (slot->channel_prev != P2P_NO_SLOT) state->recv_queue[slot->channel_prev].channel_next = idx;
+    else state->channel_first[slot->channel] = idx;
+    state->channel_last[slot->channel] = idx;
+
     state->recv_count++;
-    state->incoming_queue_current_bytes += packet->size;
+    state->channel_bytes[slot->channel] += size;
+    state->incoming_queue_current_bytes += size;
 
     return true;
 }
 
-// Helper: Queue pending send packet
-static bool queue_pending_packet(P2PState* state, const PendingPacket* packet) {
-    if (!state || !packet) return false;
+// Helper: Chain every outgoing-queue slot onto the free list
+static void send_queue_reset(P2PState* state) {
+    for (int i = 0; i < MAX_SEND_QUEUE; i++) {
+        PendingPacket* pkt = &state->send_queue[i];
+        pkt->valid = false;
+        pkt->data = NULL;
+        pkt->next = (i + 1 < MAX_SEND_QUEUE) ? i + 1 : P2P_NO_SLOT;
+    }
+    state->send_free = 0;
+    state->send_count = 0;
+    state->backlog_first = P2P_NO_SLOT;
+    state->outgoing_queue_current_bytes = 0;
+}
+
+// Helper: Put a connection on / take it off the list of connections with
+// queued packets
+static void backlog_add(P2PState* state, PeerConnection* conn) {
+    if (conn->backlogged) return;
+    int idx = (int)(conn - state->connections);
+    conn->backlog_prev = P2P_NO_SLOT;
+    conn->backlog_next = state->backlog_first;
+    if (state->backlog_first != P2P_NO_SLOT) state->connections[state->backlog_first].backlog_prev = idx;
+    state->backlog_first = idx;
+    conn->backlogged = true;
+}
+
+static void backlog_remove(P2PState* state, PeerConnection* conn) {
+    if (!conn->backlogged) return;
+    if (conn->backlog_prev != P2P_NO_SLOT) state->connections[conn->backlog_prev].backlog_next = conn->backlog_next;
+    else state->backlog_first = conn->backlog_next;
+    if (conn->backlog_next != P2P_NO_SLOT) state->connections[conn->backlog_next].backlog_prev = conn->backlog_prev;
+    conn->backlog_prev = conn->backlog_next = P2P_NO_SLOT;
+    conn->backlogged = false;
+}
+
+// Helper: Queue pending send packet on its connection, copying `data`
+// (packet->size bytes) into a pool block
+static bool queue_pending_packet(P2PState* state, PeerConnection* conn,
+                                 const PendingPacket* packet, const void* data) {
+    if (!state || !conn || !packet) return false;
 
     // Check if queue is full
-    if (state->send_count >= MAX_SEND_QUEUE) {
+    if (state->send_free == P2P_NO_SLOT) {
         EOS_LOG_WARN("P2P: Send packet queue full");
         return false;
     }
+    if (conn->state != CONN_STATE_ESTABLISHED && conn->send_count >= P2P_CONNECTING_QUEUE_MAX) {
+        EOS_LOG_WARN("P2P: Send queue for %s full while connecting", conn->peer_id_string);
+        return false;
+    }
 
     // Check queue size limit
     if (state->outgoing_queue_max_bytes > 0) {
@@ -184,16 +697,60 @@ static bool queue_pending_packet(P2PState* state, const PendingPacket* packet) {
         }
     }
 
-    // Add to queue
-    int idx = state->send_tail;
-    memcpy(&state->send_queue[idx], packet, sizeof(PendingPacket));
-    state->send_tail = (state->send_tail + 1) % MAX_SEND_QUEUE;
+    uint8_t* block = p2p_pool_alloc(&state->pool, packet->size);
+    if (!block) return false;
+    if (data && packet->size > 0) memcpy(block, data, packet->size);
+
+    // Append to the connection's queue
+    int idx = state->send_free;
+    PendingPacket* slot = &state->send_queue[idx];
+    state->send_free = slot->next;
+    memcpy(slot, packet, sizeof(PendingPacket));
+    slot->data = block;
+    slot->next = P2P_NO_SLOT;
+    slot->valid = true;
+
+    if (conn->send_last != P2P_NO_SLOT) state->send_queue[conn->send_last].next = idx;
+    else conn->send_first = idx;
+    conn->send_last = idx;
+    conn->send_count++;
+    conn->send_bytes += packet->size;
+    backlog_add(state, conn);
+
     state->send_count++;
     state->outgoing_queue_current_bytes += packet->size;
 
     return true;
 }
 
+// Helper: Take packet `idx` out of the connection's queue (`prev` is the
+// packet before it, P2P_NO_SLOT at the head) and return its slot.
+static void send_queue_take(P2PState* state, PeerConnection* conn, int prev, int idx) {
+    PendingPacket* pkt = &state->send_queue[idx];
+    if (prev != P2P_NO_SLOT) state->send_queue[prev].next = pkt->next;
+    else conn->send_first = pkt->next;
+    if (conn->send_last == idx) conn->send_last = prev;
+
+    conn->send_count--;
+    conn->send_bytes -= pkt->size;
+    if (conn->send_count == 0) backlog_remove(state, conn);
+    state->send_count--;
+    state->outgoing_queue_current_bytes -= pkt->size;
+
+    p2p_pool_free(&state->pool, pkt->data, pkt->size);
+    pkt->data = NULL;
+    pkt->valid = false;
+    pkt->next = state->send_free;
+    state->send_free = idx;
+}
+
+// Helper: Drop everything queued for a connection
+static void drop_queued_packets(P2PState* state, PeerConnection* conn) {
+    while (conn->send_first != P2P_NO_SLOT) {
+        send_queue_take(state, conn, P2P_NO_SLOT, conn->send_first);
+    }
+}
+
 // ----------------------------------------------------------------------------
 // LAN transport helpers (wire the lan_p2p UDP socket into the P2P state)
 // ----------------------------------------------------------------------------
@@ -231,47 +788,419 @@ static const char* p2p_local_hex(P2PState* state) {
     return ((EOS_ProductUserIdDetails*)p)->id_string;
 }
 
-// Find a connection by the peer's 32-char hex id (used on the receive path,
-// where EOS_ProductUserId_FromString hands back a fresh pointer each call so
-// pointer identity cannot be relied upon).
-static PeerConnection* find_connection_by_hex(P2PState* state, const char* hex,
-                                              const EOS_P2P_SocketId* socket_id) {
-    if (!state || !hex || !socket_id) return NULL;
-    for (int i = 0; i < MAX_CONNECTIONS; i++) {
-        PeerConnection* conn = &state->connections[i];
-        if (!conn->valid) continue;
-        if (!socket_id_equal(&conn->socket_id, socket_id)) continue;
-        if (strcmp(conn->peer_id_string, hex) != 0) continue;
-        return conn;
-    }
-    return NULL;
-}
+// Address, stamp and send a prepared wire packet. Any ACK owed to the peer's
+// reliable stream rides along for free, so a busy connection rarely needs a
+// standalone MSG_ACK.
+static void p2p_flush_frame(P2PState* state, PeerConnection* conn);
 
-// Send one wire message to a peer over the LAN UDP socket.
-static void p2p_send_msg(P2PState* state, PeerConnection* conn, uint8_t msg_type,
-                         uint8_t channel, const uint8_t* data, uint32_t data_len) {
-    if (!state || !state->sock || !conn) return;
-    if (conn->peer_address[0] == '\0') {
+static void p2p_send_wire(P2PState* state, PeerConnection* conn, P2PSendPacket* pkt) {
+    if (!state || !state->sock || !conn || !pkt) return;
+    if (conn->addr.port == 0) {
         EOS_LOG_DEBUG("P2P: cannot send msg %u to %s - no peer address yet",
-                      (unsigned)msg_type, conn->peer_id_string);
+                      (unsigned)pkt->message_type, conn->peer_id_string);
         return;
     }
 
+    // Coalesced DATA goes out before anything sent after it. A pending frame
+    // also carries the ACK, so a standalone one is then redundant.
+    if (pkt->message_type != MSG_BUNDLE && conn->frame && conn->frame->count > 0) {
+        p2p_flush_frame(state, conn);
+        if (pkt->message_type == MSG_ACK) return;
+    }
+
+    // DATA, ACK and keepalives use the compact header once the peer has told
+    // us its token; everything else (and anything before the handshake) carries
+    // the full ids plus our own token so the peer can learn it.
     const char* local = p2p_local_hex(state);
+    pkt->target = conn->addr;
+    pkt->sender_id = local ? local : "";
+    pkt->socket_name = conn->socket_id.SocketName;
+    pkt->compact = conn->remote_token != 0 &&
+                   (pkt->message_type == MSG_DATA || pkt->message_type == MSG_ACK ||
+                    pkt->message_type == MSG_BUNDLE || pkt->message_type == MSG_PING ||
+                    pkt->message_type == MSG_PONG || pkt->message_type == MSG_FEC);
+    pkt->token = pkt->compact ? conn->remote_token : conn->local_token;
+
+    if (conn->rel && conn->rel->ack_pending) {
+        pkt->has_ack = true;
+        p2p_rel_build_ack(conn->rel, &pkt->ack, &pkt->ack_bits);
+        conn->rel->ack_pending = false;
+    }
 
+    lan_p2p_send(state->sock, pkt);
+}
+
+// Send one unsequenced wire message (control or unreliable DATA) to a peer.
+static void p2p_send_msg(P2PState* state, PeerConnection* conn, uint8_t msg_type,
+                         uint8_t channel, const uint8_t* data, uint32_t data_len) {
     P2PSendPacket pkt;
     memset(&pkt, 0, sizeof(pkt));
-    pkt.target_addr = conn->peer_address;
-    pkt.sender_id = local ? local : "";
-    pkt.socket_name = conn->socket_id.SocketName;
     pkt.channel = channel;
     pkt.message_type = msg_type;
     pkt.data = data;
     pkt.data_len = data_len;
-    pkt.sequence = 0;
-    pkt.reliable = false;
+    p2p_send_wire(state, conn, &pkt);
+}
 
-    lan_p2p_send(state->sock, &pkt);
+// Send the connection's coalesced DATA records as one MSG_BUNDLE datagram.
+static void p2p_flush_frame(P2PState* state, PeerConnection* conn) {
+    CoalesceFrame* frame = conn->frame;
+    if (!frame || frame->count == 0) return;
+
+    P2PSendPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.message_type = MSG_BUNDLE;
+    pkt.data = frame->data;
+    pkt.data_len = frame->len;
+    frame->len = 0;
+    frame->count = 0;
+    p2p_send_wire(state, conn, &pkt);
+}
+
+// Helper: The compressor, created without a dictionary on first use when
+// EOSLAN_P2P_COMPRESS_DICT did not provide one.
+static P2PCompressor* p2p_compressor(P2PState* state) {
+    if (!state->compressor) state->compressor = p2p_compress_create(NULL, 0);
+    return state->compressor;
+}
+
+// Helper: Write our compression offer (P2P_OFFER_SIZE bytes). Every build
+// that understands it can decompress, so it is sent whether or not we
+// compress ourselves; the dictionary id must match for the peer to use it.
+static uint32_t p2p_put_offer(P2PState* state, uint8_t* out) {
+    uint32_t dict_id = state->compressor ? state->compressor->dict_id : 0;
+    memcpy(out, p2p_offer_marker, sizeof(p2p_offer_marker));
+    out[4] = P2P_OFFER_VERSION;
+    out[5] = (uint8_t)(dict_id >> 24);
+    out[6] = (uint8_t)(dict_id >> 16);
+    out[7] = (uint8_t)(dict_id >> 8);
+    out[8] = (uint8_t)dict_id;
+    return P2P_OFFER_SIZE;
+}
+
+static void p2p_send_accept(P2PState* state, PeerConnection* conn) {
+    uint8_t offer[P2P_OFFER_SIZE];
+    p2p_send_msg(state, conn, MSG_ACCEPT, 0, offer, p2p_put_offer(state, offer));
+}
+
+// Helper: Take the compression offer that ends a CONNECT (after its DATA
+// records) or makes up an ACCEPT. A peer without one, or with a different
+// dictionary, gets our DATA uncompressed.
+static void p2p_recv_offer(P2PState* state, PeerConnection* conn, const P2PReceivedPacket* rp) {
+    const uint8_t* p = rp->data;
+    const uint8_t* end = rp->data ? rp->data + rp->data_len : NULL;
+    const uint8_t* offer = NULL;
+    while (p && end - p >= 4) {
+        if (end - p == P2P_OFFER_SIZE && memcmp(p, p2p_offer_marker, sizeof(p2p_offer_marker)) == 0) {
+            offer = p;
+            break;
+        }
+        long need = 4 + ((p[1] & P2P_FLAG_RELIABLE) ? 2 : 0) + ((p[1] & P2P_FLAG_ORDERED) ? 2 : 0);
+        if (end - p < need) break;
+        p += need + ((p[need - 2] << 8) | p[need - 1]);
+    }
+
+    bool decompresses = false;
+    if (offer && offer[4] == P2P_OFFER_VERSION) {
+        uint32_t dict_id = ((uint32_t)offer[5] << 24) | ((uint32_t)offer[6] << 16) |
+                           ((uint32_t)offer[7] << 8) | offer[8];
+        uint32_t ours = state->compressor ? state->compressor->dict_id : 0;
+        decompresses = dict_id == ours;
+        if (!decompresses && !conn->peer_decompresses && state->compressor) {
+            EOS_LOG_WARN("P2P: %s has compression dictionary %08x, we have %08x - not compressing to it",
+                         conn->peer_id_string, (unsigned)dict_id, (unsigned)ours);
+        }
+    }
+    conn->peer_decompresses = decompresses;
+}
+
+// Helper: Compress a DATA payload for the wire when the peer took our offer.
+// On success *data / *size describe the compressed form in packed.
+static bool p2p_compress_data(P2PState* state, PeerConnection* conn,
+                              const uint8_t** data, uint32_t* size, uint8_t* packed) {
+    P2PCompressor* c = p2p_compressor(state);
+    if (!c) return false;
+    if (state->compress_train_path[0]) p2p_compress_sample(c, *data, *size);
+    if (!conn->peer_decompresses || *size < P2P_COMPRESS_MIN) return false;
+
+    uint64_t start = get_time_us();
+    uint32_t n = p2p_compress(c, *data, *size, packed, *size - 1);
+    conn->compress_us += get_time_us() - start;
+    conn->compress_in_bytes += *size;
+    if (n == 0) {
+        conn->packets_stored_raw++;
+        conn->compress_out_bytes += *size;
+        return false;
+    }
+    conn->packets_compressed++;
+    conn->compress_out_bytes += n;
+    *data = packed;
+    *size = n;
+    return true;
+}
+
+// Write one DATA record (MSG_BUNDLE payloads, and DATA carried on CONNECT)
+// and return its length. Layout:
+//   channel(1) flags(1) [seq(2) if RELIABLE] [order_seq(2) if ORDERED] len(2) payload
+static uint32_t p2p_put_record(uint8_t* rec, uint8_t channel, bool reliable, bool ordered,
+                               bool compressed, uint16_t sequence, uint16_t order_sequence,
+                               const uint8_t* data, uint32_t size) {
+    uint32_t off = 0;
+    uint8_t flags = 0;
+    if (reliable) flags |= P2P_FLAG_RELIABLE;
+    if (ordered) flags |= P2P_FLAG_ORDERED;
+    if (compressed) flags |= P2P_FLAG_COMPRESSED;
+    rec[off++] = channel;
+    rec[off++] = flags;
+    if (reliable) {
+        rec[off++] = (uint8_t)(sequence >> 8);
+        rec[off++] = (uint8_t)sequence;
+    }
+    if (ordered) {
+        rec[off++] = (uint8_t)(order_sequence >> 8);
+        rec[off++] = (uint8_t)order_sequence;
+    }
+    rec[off++] = (uint8_t)(size >> 8);
+    rec[off++] = (uint8_t)size;
+    if (size > 0) memcpy(rec + off, data, size);
+    return off + size;
+}
+
+// Append a DATA packet to the connection's coalescing frame (p2p_put_record).
+// Returns false when the packet must be sent on its own (coalescing off, the
+// peer's token not known yet, or the packet too large for a frame).
+static bool p2p_coalesce(P2PState* state, PeerConnection* conn, uint8_t channel,
+                         bool reliable, bool ordered, bool compressed,
+                         uint16_t sequence, uint16_t order_sequence,
+                         const uint8_t* data, uint32_t size) {
+    if (!state->coalesce || conn->remote_token == 0) return false;
+
+    uint32_t header = 4 + (reliable ? 2 : 0) + (ordered ? 2 : 0);
+    if (header + size > state->coalesce_budget) return false;
+
+    if (!conn->frame) {
+        conn->frame = calloc(1, sizeof(CoalesceFrame));
+        if (!conn->frame) return false;
+    }
+    CoalesceFrame* frame = conn->frame;
+
+    uint64_t now_us = get_time_us();
+    if (frame->count > 0) {
+        bool full = frame->len + header + size > state->coalesce_budget;
+        bool expired = state->coalesce_deadline_us > 0 &&
+                       now_us - frame->started_us >= state->coalesce_deadline_us;
+        if (full || expired) {
+            p2p_flush_frame(state, conn);
+            if (expired) lan_p2p_flush(state->sock);
+        }
+    }
+    if (frame->count == 0) frame->started_us = now_us;
+
+    frame->len += p2p_put_record(frame->data + frame->len, channel, reliable, ordered, compressed,
+                                 sequence, order_sequence, data, size);
+    frame->count++;
+    return true;
+}
+
+// (Re)transmit a tracked reliable packet and arm its retransmission timer.
+static void p2p_send_reliable_slot(P2PState* state, PeerConnection* conn,
+                                   ReliableSendSlot* slot, uint64_t now) {
+    // A packet tracked before the connection was up (see p2p_send_connect)
+    // is timed from its first transmission, not from when it was queued.
+    if (slot->transmissions == 0) slot->first_sent_at = now;
+
+    if (p2p_coalesce(state, conn, slot->channel, true, slot->ordered, slot->compressed,
+                     slot->sequence, slot->order_sequence, slot->data, slot->size)) {
+        p2p_rel_mark_sent(conn->rel, slot, now);
+        return;
+    }
+
+    P2PSendPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.channel = slot->channel;
+    pkt.message_type = MSG_DATA;
+    pkt.data = slot->data;
+    pkt.data_len = slot->size;
+    pkt.sequence = slot->sequence;
+    pkt.order_sequence = slot->order_sequence;
+    pkt.reliable = true;
+    pkt.ordered = slot->ordered;
+    pkt.compressed = slot->compressed;
+    p2p_send_wire(state, conn, &pkt);
+    p2p_rel_mark_sent(conn->rel, slot, now);
+}
+
+// Hand a DATA payload to the application receive queue.
+static bool p2p_deliver_data(P2PState* state, PeerConnection* conn, const EOS_P2P_SocketId* sock_id,
+                             uint8_t channel, const uint8_t* data, uint32_t data_len,
+                             uint64_t arrival_us) {
+    ReceivedPacket header;
+    header.sender = conn->peer_id;
+    header.sender_handle = conn->peer_handle;
+    memcpy(header.sender_id_string, conn->peer_id_string, sizeof(header.sender_id_string));
+    copy_socket_id(&header.socket_id, sock_id);
+    header.channel = channel;
+    header.arrival_us = arrival_us;
+    if (!queue_received_packet(state, &header, data, data_len)) return false;
+    conn->packets_received++;
+    conn->bytes_received += data_len;
+    EOS_LOG_DEBUG("P2P: recv DATA %u bytes from %s (ch %u)",
+                  data_len, conn->peer_id_string, (unsigned)channel);
+    return true;
+}
+
+// Find the other end of `conn` when it is a platform in this process that
+// is ticked on the calling thread, so DATA can go straight into its receive
+// queue. Both connections must name each other's token (and user), and the
+// wire must hold nothing that a direct packet could overtake: no reliable
+// packets of ours in flight, none held for ordering on the peer's side.
+// Emulated network conditions and captures need the wire, so they turn the
+// shortcut off.
+static P2PState* p2p_direct_peer(P2PState* state, PeerConnection* conn,
+                                 PeerConnection** out_peer_conn) {
+    if (conn->remote_token == 0) return NULL;
+    if (lan_p2p_wire_only(state->sock)) return NULL;
+    if (conn->rel && conn->rel->in_flight > 0) return NULL;
+
+    for (int i = 0; i < 8; i++) {
+        PlatformState* platform = g_platforms[i];
+        if (!platform || !platform->p2p || platform->p2p == state) continue;
+
+        P2PState* peer = platform->p2p;
+        PeerConnection* peer_conn = find_connection_by_token(peer, conn->remote_token);
+        if (!peer_conn || peer_conn->remote_token != conn->local_token) continue;
+        if (peer_conn->state != CONN_STATE_ESTABLISHED) return NULL;
+        if (peer_conn->rel && peer_conn->rel->held_count > 0) return NULL;
+
+        const char* peer_hex = p2p_local_hex(peer);
+        const char* local_hex = p2p_local_hex(state);
+        if (!peer_hex || !local_hex) continue;
+        if (strcmp(peer_hex, conn->peer_id_string) != 0) continue;
+        if (strcmp(local_hex, peer_conn->peer_id_string) != 0) continue;
+
+        if (!platform_on_tick_thread(platform)) return NULL;
+        *out_peer_conn = peer_conn;
+        return peer;
+    }
+    return NULL;
+}
+
+// Send pacing: refill the connection's token bucket and report whether it
+// may put more DATA on the wire. A packet is allowed while any tokens are
+// left and may overdraw the bucket, so a paced connection never holds back
+// a small packet behind a large one (which would reorder reliable DATA).
+static bool p2p_pace_allow(P2PState* state, PeerConnection* conn, uint64_t now_us) {
+    if (state->pace_rate == 0) return true;
+
+    if (conn->pace_refill_us == 0) {
+        conn->pace_tokens = state->pace_burst;
+    } else if (now_us > conn->pace_refill_us) {
+        uint64_t elapsed = now_us - conn->pace_refill_us;
+        if (elapsed > 1000000) elapsed = 1000000;
+        conn->pace_tokens += (int64_t)(elapsed * state->pace_rate / 1000000);
+        if (conn->pace_tokens > (int64_t)state->pace_burst) conn->pace_tokens = state->pace_burst;
+    }
+    conn->pace_refill_us = now_us;
+    return conn->pace_tokens > 0;
+}
+
+static void p2p_pace_charge(P2PState* state, PeerConnection* conn, uint32_t size) {
+    if (state->pace_rate != 0) conn->pace_tokens -= size;
+}
+
+// Close the connection's open FEC group with its parity packet.
+static void p2p_send_fec_parity(P2PState* state, PeerConnection* conn) {
+    uint8_t buf[P2P_FEC_HEADER + 1 + P2P_FEC_RECORD_MAX];
+    uint32_t len = p2p_fec_parity(conn->fec, buf);
+    if (len == 0) return;
+    p2p_send_msg(state, conn, MSG_FEC, 0, buf, len);
+    p2p_pace_charge(state, conn, len);
+}
+
+// Send unreliable DATA on an FEC channel as part of the connection's open
+// group, closing the group once it holds fec_k packets. Returns false when
+// the FEC state cannot be allocated (the caller sends it unprotected).
+static bool p2p_send_fec(P2PState* state, PeerConnection* conn, uint8_t channel,
+                         const uint8_t* data, uint32_t size) {
+    FecState* fs = connection_fec(conn);
+    if (!fs) return false;
+
+    uint8_t buf[P2P_FEC_HEADER + EOS_P2P_MAX_PACKET_SIZE];
+    uint32_t len = p2p_fec_wrap(fs, channel, data, size, buf, get_time_ms());
+    p2p_send_msg(state, conn, MSG_FEC, channel, buf, len);
+    if (fs->send_count >= state->fec_k) p2p_send_fec_parity(state, conn);
+    return true;
+}
+
+// Send DATA on an established connection. A peer platform in this process
+// gets the payload queued directly; otherwise unreliable packets take the
+// unsequenced fast path and reliable ones enter the connection's send window.
+// Returns false (nothing sent) when the reliable window is full or the
+// connection's send pacer is out of tokens.
+static bool p2p_send_data(P2PState* state, PeerConnection* conn, uint8_t channel,
+                          bool reliable, bool ordered, const uint8_t* data, uint32_t size) {
+    PeerConnection* peer_conn = NULL;
+    P2PState* peer = p2p_direct_peer(state, conn, &peer_conn);
+    if (peer) {
+        if (p2p_deliver_data(peer, peer_conn, &peer_conn->socket_id, channel, data, size,
+                             get_time_us())) {
+            peer_conn->last_activity = get_time_ms();
+            conn->packets_sent++;
+            conn->bytes_sent += size;
+            return true;
+        }
+        // The peer's queue is full: an unreliable packet is dropped exactly
+        // as it would be off the socket; a reliable one goes over the wire so
+        // retransmission delivers it once the peer drains its queue.
+        if (!reliable) return true;
+    }
+
+    if (!p2p_pace_allow(state, conn, get_time_us())) return false;
+    if (!reliable && state->fec_channel[channel] && p2p_send_fec(state, conn, channel, data, size)) {
+        p2p_pace_charge(state, conn, size);
+        conn->packets_sent++;
+        conn->bytes_sent += size;
+        return true;
+    }
+
+    // Stats count what the application sent; pacing charges what goes out.
+    uint32_t app_size = size;
+    uint8_t packed[EOS_P2P_MAX_PACKET_SIZE];
+    bool compressed = false;
+
+    if (!reliable) {
+        compressed = state->compress_channel[channel] &&
+                     p2p_compress_data(state, conn, &data, &size, packed);
+        if (!p2p_coalesce(state, conn, channel, false, false, compressed, 0, 0, data, size)) {
+            P2PSendPacket pkt;
+            memset(&pkt, 0, sizeof(pkt));
+            pkt.channel = channel;
+            pkt.message_type = MSG_DATA;
+            pkt.compressed = compressed;
+            pkt.data = data;
+            pkt.data_len = size;
+            p2p_send_wire(state, conn, &pkt);
+        }
+        p2p_pace_charge(state, conn, size);
+        conn->packets_sent++;
+        conn->bytes_sent += app_size;
+        return true;
+    }
+
+    ReliableState* rs = connection_rel(conn);
+    if (!rs || !p2p_rel_can_send(rs)) return false;
+
+    compressed = state->compress_channel[channel] &&
+                 p2p_compress_data(state, conn, &data, &size, packed);
+    uint64_t now = get_time_ms();
+    ReliableSendSlot* slot = p2p_rel_track(rs, channel, ordered, data, size, now);
+    if (!slot) return false;
+    slot->compressed = compressed;
+    p2p_send_reliable_slot(state, conn, slot, now);
+    p2p_pace_charge(state, conn, size);
+    conn->packets_sent++;
+    conn->bytes_sent += app_size;
+    return true;
 }
 
 // Fire the stored "incoming connection request" notifications for a connection.
@@ -279,6 +1208,7 @@ static void p2p_send_msg(P2PState* state, PeerConnection* conn, uint8_t msg_type
 // value, pointers reference stable storage) to match the lobby/sessions style
 // and avoid re-entrancy while we are still inside the tick.
 static void p2p_fire_conn_request(P2PState* state, PeerConnection* conn) {
+    if (is_transport_connection(conn)) return;
     EOS_ProductUserId local = p2p_local_puid(state);
     for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
         P2PNotification* n = &state->conn_request_notifs[i];
@@ -300,8 +1230,11 @@ static void p2p_fire_conn_request(P2PState* state, PeerConnection* conn) {
     }
 }
 
-// Fire the stored "connection established" notifications for a connection.
-static void p2p_fire_conn_established(P2PState* state, PeerConnection* conn) {
+// Fire the stored "connection established" notifications for a connection
+// (EOS_CET_Reconnection when it recovers from an interruption).
+static void p2p_fire_conn_established(P2PState* state, PeerConnection* conn,
+                                      EOS_EConnectionEstablishedType type) {
+    if (is_transport_connection(conn)) return;
     EOS_ProductUserId local = p2p_local_puid(state);
     for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
         P2PNotification* n = &state->conn_established_notifs[i];
@@ -314,7 +1247,7 @@ static void p2p_fire_conn_established(P2PState* state, PeerConnection* conn) {
         info.LocalUserId = local;
         info.RemoteUserId = conn->peer_id;
         info.SocketId = &conn->socket_id;
-        info.ConnectionType = EOS_CET_NewConnection;
+        info.ConnectionType = type;
         info.NetworkType = EOS_NCT_DirectConnection;
 
         if (state->platform && state->platform->callbacks) {
@@ -325,9 +1258,34 @@ static void p2p_fire_conn_established(P2PState* state, PeerConnection* conn) {
     }
 }
 
+// Fire the stored "connection interrupted" notifications for a connection.
+static void p2p_fire_conn_interrupted(P2PState* state, PeerConnection* conn) {
+    if (is_transport_connection(conn)) return;
+    EOS_ProductUserId local = p2p_local_puid(state);
+    for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
+        P2PNotification* n = &state->conn_interrupted_notifs[i];
+        if (!n->active || !n->callback) continue;
+        if (n->has_socket_filter && !socket_id_equal(&n->socket_filter, &conn->socket_id)) continue;
+
+        EOS_P2P_OnPeerConnectionInterruptedInfo info;
+        memset(&info, 0, sizeof(info));
+        info.ClientData = n->client_data;
+        info.LocalUserId = local;
+        info.RemoteUserId = conn->peer_id;
+        info.SocketId = &conn->socket_id;
+
+        if (state->platform && state->platform->callbacks) {
+            callback_queue_push(state->platform->callbacks, n->callback, &info, sizeof(info));
+        } else {
+            ((EOS_P2P_OnPeerConnectionInterruptedCallback)n->callback)(&info);
+        }
+    }
+}
+
 // Fire the stored "remote connection closed" notifications for a connection.
 static void p2p_fire_conn_closed(P2PState* state, PeerConnection* conn,
                                  EOS_EConnectionClosedReason reason) {
+    if (is_transport_connection(conn)) return;
     EOS_ProductUserId local = p2p_local_puid(state);
     for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
         P2PNotification* n = &state->conn_closed_notifs[i];
@@ -350,37 +1308,585 @@ static void p2p_fire_conn_closed(P2PState* state, PeerConnection* conn,
     }
 }
 
-// Flush any queued (delayed-delivery) packets whose target connection has
-// reached ESTABLISHED. Called every tick; this is also what drains a peer's
-// backlog right after we receive its ACCEPT.
-static void p2p_flush_send_queue(P2PState* state) {
-    if (state->send_count <= 0) return;
+// Fire the stored "incoming packet queue full" notifications for a packet
+// that did not fit.
+static void p2p_fire_queue_full(P2PState* state, uint8_t channel, uint32_t size) {
+    EOS_ProductUserId local = p2p_local_puid(state);
+    for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
+        P2PNotification* n = &state->queue_full_notifs[i];
+        if (!n->active || !n->callback) continue;
 
-    int flushed = 0;
-    for (int i = 0; i < MAX_SEND_QUEUE; i++) {
-        PendingPacket* pkt = &state->send_queue[i];
-        if (!pkt->valid) continue;
+        EOS_P2P_OnIncomingPacketQueueFullInfo info;
+        memset(&info, 0, sizeof(info));
+        info.ClientData = n->client_data;
+        info.PacketQueueMaxSizeBytes = state->incoming_queue_max_bytes;
+        info.PacketQueueCurrentSizeBytes = state->incoming_queue_current_bytes;
+        info.OverflowPacketLocalUserId = local;
+        info.OverflowPacketChannel = channel;
+        info.OverflowPacketSizeBytes = size;
 
-        PeerConnection* conn = find_connection(state, pkt->target, &pkt->socket_id);
-        if (!conn || conn->state != CONN_STATE_ESTABLISHED) continue;
-
-        p2p_send_msg(state, conn, MSG_DATA, pkt->channel, pkt->data, pkt->size);
-
-        pkt->valid = false;
-        if (state->send_count > 0) state->send_count--;
-        if (state->outgoing_queue_current_bytes >= pkt->size) {
-            state->outgoing_queue_current_bytes -= pkt->size;
+        if (state->platform && state->platform->callbacks) {
+            callback_queue_push(state->platform->callbacks, n->callback, &info, sizeof(info));
         } else {
-            state->outgoing_queue_current_bytes = 0;
+            ((EOS_P2P_OnIncomingPacketQueueFullCallback)n->callback)(&info);
+        }
+    }
+}
+
+// Send an established connection's queued packets, oldest first so reliable
+// ones enter the send window in the order the game queued them. Stops at
+// the first packet the reliable window or the pacer holds back; the rest
+// wait for a later tick. Returns the number of packets sent.
+static int p2p_flush_connection_queue(P2PState* state, PeerConnection* conn) {
+    int flushed = 0;
+    while (conn->send_first != P2P_NO_SLOT) {
+        PendingPacket* pkt = &state->send_queue[conn->send_first];
+        if (!p2p_send_data(state, conn, pkt->channel, pkt->reliable, pkt->ordered,
+                           pkt->data, pkt->size)) {
+            break;
         }
+        send_queue_take(state, conn, P2P_NO_SLOT, conn->send_first);
         flushed++;
     }
+    return flushed;
+}
+
+// Flush queued (delayed-delivery) packets on every established connection
+// that has any. Called every tick; only connections with a backlog are
+// visited.
+static void p2p_flush_send_queue(P2PState* state) {
+    int flushed = 0;
+    int next;
+    for (int idx = state->backlog_first; idx != P2P_NO_SLOT; idx = next) {
+        PeerConnection* conn = &state->connections[idx];
+        next = conn->backlog_next;
+        if (!can_transmit(conn)) continue;
+        flushed += p2p_flush_connection_queue(state, conn);
+    }
 
     if (flushed > 0) {
         EOS_LOG_DEBUG("P2P: flushed %d queued DATA packet(s) on established connections", flushed);
     }
 }
 
+// ----------------------------------------------------------------------------
+// Fair scheduling (EOSLAN_P2P_FAIR). SendPacket queues everything and the
+// tick drains the connection queues: packets on priority channels first, on
+// every connection, then the rest by deficit round robin under a per-tick
+// byte budget, so a large burst to one peer cannot delay the others.
+// ----------------------------------------------------------------------------
+
+// Helper: First queued packet at or after `idx` that is not on a priority
+// channel; *prev follows along (the packet before the returned one).
+static int next_bulk_packet(P2PState* state, int idx, int* prev) {
+    while (idx != P2P_NO_SLOT && state->priority_channel[state->send_queue[idx].channel]) {
+        *prev = idx;
+        idx = state->send_queue[idx].next;
+    }
+    return idx;
+}
+
+// Send a connection's queued priority-channel packets, oldest first, until
+// one is held back. Returns the bytes sent.
+static uint32_t p2p_send_priority(P2PState* state, PeerConnection* conn) {
+    uint32_t sent = 0;
+    int prev = P2P_NO_SLOT;
+    int idx = conn->send_first;
+    while (idx != P2P_NO_SLOT) {
+        PendingPacket* pkt = &state->send_queue[idx];
+        int next = pkt->next;
+        if (!state->priority_channel[pkt->channel]) {
+            prev = idx;
+            idx = next;
+            continue;
+        }
+        if (!p2p_send_data(state, conn, pkt->channel, pkt->reliable, pkt->ordered,
+                           pkt->data, pkt->size)) {
+            break;
+        }
+        sent += pkt->size;
+        send_queue_take(state, conn, prev, idx);
+        idx = next;
+    }
+    return sent;
+}
+
+static void p2p_schedule_send(P2PState* state) {
+    if (state->backlog_first == P2P_NO_SLOT) return;
+
+    // Connections that can transmit with a backlog, in slot order starting where
+    // the last tick's round stopped.
+    int active[MAX_CONNECTIONS];
+    bool blocked[MAX_CONNECTIONS];
+    int n = 0;
+    for (int k = 0; k < MAX_CONNECTIONS; k++) {
+        int slot = (state->fair_cursor + k) % MAX_CONNECTIONS;
+        PeerConnection* conn = &state->connections[slot];
+        if (!conn->valid || !conn->backlogged || !can_transmit(conn)) continue;
+        blocked[n] = false;
+        active[n++] = slot;
+    }
+    if (n == 0) return;
+
+    int64_t budget = state->fair_budget;
+    for (int i = 0; i < n; i++) {
+        budget -= p2p_send_priority(state, &state->connections[active[i]]);
+    }
+
+    // Each round tops every connection up by one quantum and lets it send
+    // queued packets while they fit its deficit. A connection whose queue
+    // empties forfeits what is left; one that stops for the window or the
+    // pacer sits out the remaining rounds of this tick.
+    bool progress = true;
+    while (budget > 0 && progress) {
+        progress = false;
+        for (int i = 0; i < n && budget > 0; i++) {
+            PeerConnection* conn = &state->connections[active[i]];
+            if (blocked[i] || !conn->backlogged) continue;
+
+            int prev = P2P_NO_SLOT;
+            int idx = next_bulk_packet(state, conn->send_first, &prev);
+            if (idx == P2P_NO_SLOT) {
+                conn->drr_deficit = 0;
+                continue;
+            }
+
+            conn->drr_deficit += P2P_FAIR_QUANTUM;
+            while (idx != P2P_NO_SLOT && budget > 0) {
+                PendingPacket* pkt = &state->send_queue[idx];
+                if ((int32_t)pkt->size > conn->drr_deficit) break;
+                int next = pkt->next;
+                if (!p2p_send_data(state, conn, pkt->channel, pkt->reliable, pkt->ordered,
+                                   pkt->data, pkt->size)) {
+                    blocked[i] = true;
+                    conn->drr_deficit = 0;
+                    break;
+                }
+                conn->drr_deficit -= (int32_t)pkt->size;
+                budget -= pkt->size;
+                send_queue_take(state, conn, prev, idx);
+                idx = next_bulk_packet(state, next, &prev);
+                progress = true;
+            }
+            if (idx == P2P_NO_SLOT) conn->drr_deficit = 0;
+            state->fair_cursor = (active[i] + 1) % MAX_CONNECTIONS;
+        }
+    }
+}
+
+// (Re)transmit every reliable packet on the connection whose timer is due.
+// Retransmissions are paced like new DATA; whatever the pacer holds back
+// stays due and goes out on a later tick.
+static void p2p_send_due(P2PState* state, PeerConnection* conn, uint64_t now) {
+    int cursor = 0;
+    ReliableSendSlot* slot;
+    uint64_t now_us = get_time_us();
+    while (p2p_pace_allow(state, conn, now_us) &&
+           (slot = p2p_rel_next_due(conn->rel, now, &cursor)) != NULL) {
+        p2p_send_reliable_slot(state, conn, slot, now);
+        p2p_pace_charge(state, conn, slot->size);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Handshake. Each connection runs its own timers: a REQUESTING connection
+// re-sends CONNECT with jittered exponential backoff until the peer answers
+// or the connect timeout passes, and a CLOSING one repeats CLOSE a few times
+// before its slot is released.
+// ----------------------------------------------------------------------------
+
+// Helper: Delay before the next CONNECT/CLOSE, given the attempts so far
+static uint32_t handshake_backoff(P2PState* state, uint32_t attempts) {
+    uint32_t ms = P2P_HANDSHAKE_RTO_INITIAL_MS;
+    while (attempts-- > 1 && ms < P2P_HANDSHAKE_RTO_MAX_MS) ms *= 2;
+    if (ms > P2P_HANDSHAKE_RTO_MAX_MS) ms = P2P_HANDSHAKE_RTO_MAX_MS;
+
+    // Jitter keeps connections opened in the same tick from re-sending in
+    // lockstep.
+    uint32_t x = state->handshake_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state->handshake_rng = x;
+    return ms - ms / 4 + x % (ms / 2 + 1);
+}
+
+// Helper: Move reliable packets queued for `conn` into its send window,
+// oldest first while the window has room, so the CONNECT can carry them.
+static void p2p_adopt_queued(P2PState* state, PeerConnection* conn, uint64_t now) {
+    ReliableState* rs = NULL;
+    int prev = P2P_NO_SLOT;
+    int idx = conn->send_first;
+
+    while (idx != P2P_NO_SLOT) {
+        PendingPacket* pkt = &state->send_queue[idx];
+        int next = pkt->next;
+        if (!pkt->reliable) {
+            prev = idx;
+            idx = next;
+            continue;
+        }
+
+        if (!rs) rs = connection_rel(conn);
+        if (!rs || !p2p_rel_track(rs, pkt->channel, pkt->ordered, pkt->data, pkt->size, now)) {
+            break;
+        }
+        conn->packets_sent++;
+        conn->bytes_sent += pkt->size;
+        send_queue_take(state, conn, prev, idx);
+        idx = next;
+    }
+}
+
+// Send (or re-send) CONNECT and schedule the next attempt. Reliable packets
+// queued for the peer ride in the payload as DATA records, so a peer that
+// auto-accepts delivers them with the handshake instead of one round trip
+// later. They stay in the send window until ACKed: if the peer leaves the
+// request to the app, they are retransmitted once it accepts.
+static void p2p_send_connect(P2PState* state, PeerConnection* conn, uint64_t now) {
+    uint8_t payload[P2P_CONNECT_PAYLOAD_MAX + P2P_OFFER_SIZE];
+    uint32_t len = 0;
+    uint32_t records = 0;
+
+    p2p_adopt_queued(state, conn, now);
+    if (conn->rel) {
+        int cursor = 0;
+        ReliableSendSlot* slot;
+        while ((slot = p2p_rel_next_due(conn->rel, UINT64_MAX, &cursor)) != NULL) {
+            uint32_t need = 6 + (slot->ordered ? 2 : 0) + slot->size;
+            if (len + need > P2P_CONNECT_PAYLOAD_MAX) break;
+            if (slot->transmissions == 0) slot->first_sent_at = now;
+            len += p2p_put_record(payload + len, slot->channel, true, slot->ordered, slot->compressed,
+                                  slot->sequence, slot->order_sequence, slot->data, slot->size);
+            p2p_rel_mark_sent(conn->rel, slot, now);
+            records++;
+        }
+    }
+    len += p2p_put_offer(state, payload + len);
+    p2p_send_msg(state, conn, MSG_CONNECT, 0, payload, len);
+
+    conn->handshake_sent_at = now;
+    conn->handshake_attempts++;
+    if (conn->handshake_attempts == 1 && state->connect_timeout_ms > 0) {
+        conn->handshake_deadline = now + state->connect_timeout_ms;
+    }
+    conn->handshake_next_at = now + handshake_backoff(state, conn->handshake_attempts);
+    EOS_LOG_DEBUG("P2P: sent CONNECT #%u to %s (%s, %u DATA record(s))",
+                  (unsigned)conn->handshake_attempts, conn->peer_id_string,
+                  conn->peer_address, (unsigned)records);
+}
+
+// Helper: A pre-warmed path that failed or went silent. Our own address book
+// entry goes back to idle and keeps the address; one a peer's pre-warm
+// created on our side is released.
+static void p2p_transport_down(P2PState* state, PeerConnection* conn) {
+    if (!conn->address_book) {
+        release_connection(state, conn);
+        return;
+    }
+    conn->state = CONN_STATE_NONE;
+    conn->interrupted = false;
+    conn->handshake_attempts = 0;
+    conn->handshake_deadline = 0;
+    conn->handshake_next_at = 0;
+}
+
+// Helper: Stop trying to reach a peer that never answered our CONNECT
+static void p2p_connect_timed_out(P2PState* state, PeerConnection* conn) {
+    EOS_LOG_WARN("P2P: no answer from %s (%s) on '%s' after %u CONNECT(s) - giving up",
+                 conn->peer_id_string, conn->peer_address, conn->socket_id.SocketName,
+                 (unsigned)conn->handshake_attempts);
+    if (is_transport_connection(conn)) {
+        p2p_transport_down(state, conn);
+        return;
+    }
+    p2p_fire_conn_closed(state, conn, EOS_CCR_TimedOut);
+    release_connection(state, conn);
+}
+
+// Close a connection from our side. A peer that knows about the connection
+// is sent CLOSE, and the slot lingers in CLOSING so p2p_tick can repeat it;
+// anything else is released straight away.
+static void p2p_close_connection(P2PState* state, PeerConnection* conn) {
+    if (conn->state == CONN_STATE_CLOSING) return;
+
+    bool peer_knows = conn->state == CONN_STATE_ESTABLISHED ||
+                      conn->state == CONN_STATE_PENDING ||
+                      (conn->state == CONN_STATE_REQUESTING && conn->handshake_attempts > 0);
+    if (!peer_knows || conn->addr.port == 0 || !state->sock) {
+        release_connection(state, conn);
+        return;
+    }
+
+    uint64_t now = get_time_ms();
+    p2p_send_msg(state, conn, MSG_CLOSE, 0, NULL, 0);
+    conn->state = CONN_STATE_CLOSING;
+    conn->handshake_attempts = 1;
+    conn->handshake_deadline = 0;
+    conn->handshake_next_at = now + handshake_backoff(state, conn->handshake_attempts);
+}
+
+// ----------------------------------------------------------------------------
+// Liveness. An established connection that has heard nothing from its peer
+// for keepalive_ms sends PING; the PONG gives an RTT sample, and a PING still
+// unanswered when the next one is due counts as lost. Silence past
+// interrupt_ms raises the interrupted notification, past idle_timeout_ms the
+// connection is closed as timed out.
+// ----------------------------------------------------------------------------
+
+// Helper: Fold an RTT sample into the connection's estimate (RFC 6298 gains)
+static void conn_rtt_sample(PeerConnection* conn, uint32_t sample_ms) {
+    if (conn->srtt_ms == 0) {
+        conn->srtt_ms = sample_ms;
+        conn->rttvar_ms = sample_ms / 2;
+    } else {
+        uint32_t delta = (conn->srtt_ms > sample_ms) ? conn->srtt_ms - sample_ms
+                                                     : sample_ms - conn->srtt_ms;
+        conn->rttvar_ms = (3 * conn->rttvar_ms + delta) / 4;
+        conn->srtt_ms = (7 * conn->srtt_ms + sample_ms) / 8;
+    }
+    if (conn->srtt_ms == 0) conn->srtt_ms = 1;  // 0 means "no sample"
+}
+
+// Helper: Fold one PING outcome into the loss average (1/8 weight)
+static void conn_loss_sample(PeerConnection* conn, bool lost) {
+    conn->loss_permille = (7 * conn->loss_permille + (lost ? 1000 : 0)) / 8;
+}
+
+// Send a keepalive PING. Its payload is a sequence number the PONG echoes.
+static void p2p_send_ping(P2PState* state, PeerConnection* conn, uint64_t now) {
+    if (conn->ping_outstanding) conn_loss_sample(conn, true);
+
+    uint8_t payload[2];
+    conn->ping_sequence++;
+    payload[0] = (uint8_t)(conn->ping_sequence >> 8);
+    payload[1] = (uint8_t)conn->ping_sequence;
+    conn->ping_sent_at = now;
+    conn->ping_outstanding = true;
+    p2p_send_msg(state, conn, MSG_PING, 0, payload, sizeof(payload));
+}
+
+// Helper: Take a PONG. Only the answer to the latest PING is a sample.
+static void p2p_recv_pong(PeerConnection* conn, const P2PReceivedPacket* rp) {
+    if (!conn->ping_outstanding || !rp->data || rp->data_len < 2) return;
+    uint16_t seq = (uint16_t)((rp->data[0] << 8) | rp->data[1]);
+    if (seq != conn->ping_sequence) return;
+
+    conn->ping_outstanding = false;
+    conn_loss_sample(conn, false);
+    if (rp->received_at >= conn->ping_sent_at) {
+        conn_rtt_sample(conn, (uint32_t)(rp->received_at - conn->ping_sent_at));
+    }
+}
+
+// Check one established connection's liveness (it may be released).
+static void p2p_check_liveness(P2PState* state, PeerConnection* conn, uint64_t now) {
+    uint64_t silent = now > conn->last_activity ? now - conn->last_activity : 0;
+
+    if (state->idle_timeout_ms > 0 && silent >= state->idle_timeout_ms) {
+        EOS_LOG_WARN("P2P: nothing from %s on '%s' for %llu ms - closing (timed out)",
+                     conn->peer_id_string, conn->socket_id.SocketName, (unsigned long long)silent);
+        if (is_transport_connection(conn)) {
+            p2p_transport_down(state, conn);
+            return;
+        }
+        drop_queued_packets(state, conn);
+        p2p_fire_conn_closed(state, conn, EOS_CCR_TimedOut);
+        release_connection(state, conn);
+        return;
+    }
+
+    if (state->interrupt_ms > 0 && silent >= state->interrupt_ms && !conn->interrupted) {
+        conn->interrupted = true;
+        EOS_LOG_WARN("P2P: nothing from %s on '%s' for %llu ms - interrupted",
+                     conn->peer_id_string, conn->socket_id.SocketName, (unsigned long long)silent);
+        p2p_fire_conn_interrupted(state, conn);
+    }
+
+    if (state->keepalive_ms > 0 && silent >= state->keepalive_ms &&
+        now - conn->ping_sent_at >= state->keepalive_ms) {
+        p2p_send_ping(state, conn, now);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Session / lobby groups (EOSLAN_P2P_SendPacketToGroup, multicast fan-out)
+// ----------------------------------------------------------------------------
+
+// FNV-1a of the group id: names the group on the wire and picks its
+// multicast address.
+static uint32_t group_hash(const char* id) {
+    uint32_t h = 2166136261u;
+    for (; *id; id++) {
+        h ^= (uint8_t)*id;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static P2PGroup* find_group(P2PState* state, const char* id) {
+    for (int i = 0; i < P2P_MAX_GROUPS; i++) {
+        P2PGroup* group = &state->groups[i];
+        if (group->valid && strcmp(group->id, id) == 0) return group;
+    }
+    return NULL;
+}
+
+static P2PGroup* find_group_by_hash(P2PState* state, uint32_t hash) {
+    for (int i = 0; i < P2P_MAX_GROUPS; i++) {
+        P2PGroup* group = &state->groups[i];
+        if (group->valid && group->hash == hash) return group;
+    }
+    return NULL;
+}
+
+static uint8_t group_bit(P2PState* state, const P2PGroup* group) {
+    return (uint8_t)(1u << (group - state->groups));
+}
+
+static void put_group_hash(uint8_t* p, uint32_t hash) {
+    p[0] = (uint8_t)(hash >> 24);
+    p[1] = (uint8_t)(hash >> 16);
+    p[2] = (uint8_t)(hash >> 8);
+    p[3] = (uint8_t)hash;
+}
+
+// Send a MSG_GROUP control message to one peer: group hash(4) kind(1).
+static void p2p_send_group_msg(P2PState* state, PeerConnection* conn,
+                               const P2PGroup* group, uint8_t kind) {
+    uint8_t payload[5];
+    put_group_hash(payload, group->hash);
+    payload[4] = kind;
+    p2p_send_msg(state, conn, MSG_GROUP, 0, payload, sizeof(payload));
+}
+
+// Send a full-header packet to a group's multicast address. The group hash
+// leads the payload so members of other groups on the port can drop it.
+static void p2p_send_to_group_address(P2PState* state, const P2PGroup* group, uint8_t msg_type,
+                                      const char* socket_name, uint8_t channel,
+                                      const uint8_t* data, uint32_t size) {
+    const char* local = p2p_local_hex(state);
+    if (!local) return;
+
+    uint8_t buf[4 + EOS_P2P_MAX_PACKET_SIZE];
+    put_group_hash(buf, group->hash);
+    if (size > 0) memcpy(buf + 4, data, size);
+
+    P2PSendPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.target = group->addr;
+    pkt.sender_id = local;
+    pkt.socket_name = socket_name;
+    pkt.channel = channel;
+    pkt.message_type = msg_type;
+    pkt.data = buf;
+    pkt.data_len = 4 + size;
+    lan_p2p_send(state->sock, &pkt);
+}
+
+// Handle MSG_MCAST and MSG_GROUP, which are matched to the sender's
+// connections by its id rather than taking the per-connection path (a
+// multicast datagram's source is not a connection's address to learn).
+static void p2p_recv_group(P2PState* state, const P2PReceivedPacket* rp) {
+    if (!rp->data || rp->data_len < 4) return;
+    const char* local = p2p_local_hex(state);
+    if (local && strcmp(rp->sender_id, local) == 0) return;  // our own, looped back
+
+    uint32_t hash = ((uint32_t)rp->data[0] << 24) | ((uint32_t)rp->data[1] << 16) |
+                    ((uint32_t)rp->data[2] << 8) | rp->data[3];
+    P2PGroup* group = find_group_by_hash(state, hash);
+    if (!group) return;
+    uint8_t bit = group_bit(state, group);
+
+    if (rp->message_type == MSG_MCAST) {
+        EOS_P2P_SocketId sock_id;
+        memset(&sock_id, 0, sizeof(sock_id));
+        sock_id.ApiVersion = EOS_P2P_SOCKETID_API_LATEST;
+        strncpy(sock_id.SocketName, rp->socket_name, EOS_P2P_SOCKETID_SOCKETNAME_SIZE - 1);
+
+        PeerConnection* conn = find_connection_by_hex(state, rp->sender_id, &sock_id);
+        if (!conn || conn->state != CONN_STATE_ESTABLISHED || !(conn->group_accepted & bit)) return;
+        conn->last_activity = rp->received_at;
+        p2p_deliver_data(state, conn, &conn->socket_id, rp->channel, rp->data + 4, rp->data_len - 4,
+                         rp->received_us);
+        return;
+    }
+
+    if (rp->data_len < 5) return;
+    PeerConnection* reply = NULL;
+    for (PeerConnection* c = find_peer_connections(state, rp->sender_id); c;
+         c = next_peer_connection(state, c)) {
+        if (c->state == CONN_STATE_ESTABLISHED) {
+            reply = c;
+            break;
+        }
+    }
+    if (!reply) return;  // not connected (yet); the next probe tries again
+
+    switch (rp->data[4]) {
+        case GROUP_PROBE:
+            // Answered until the prober confirms, so a lost CONFIRM is
+            // repaired by the next probe.
+            if (group->joined && !(reply->group_accepted & bit)) {
+                p2p_send_group_msg(state, reply, group, GROUP_HEARD);
+            }
+            break;
+        case GROUP_HEARD:
+            if (!group->joined) break;
+            if (!(reply->group_confirmed & bit)) {
+                EOS_LOG_INFO("P2P: %s receives multicast for group %s", rp->sender_id, group->id);
+            }
+            for (PeerConnection* c = reply; c; c = next_peer_connection(state, c)) {
+                c->group_confirmed |= bit;
+            }
+            p2p_send_group_msg(state, reply, group, GROUP_CONFIRM);
+            break;
+        case GROUP_CONFIRM:
+            for (PeerConnection* c = reply; c; c = next_peer_connection(state, c)) {
+                c->group_accepted |= bit;
+            }
+            break;
+        case GROUP_LEFT:
+            if (reply->group_member & bit) {
+                EOS_LOG_DEBUG("P2P: %s left group %s", rp->sender_id, group->id);
+            }
+            for (PeerConnection* c = reply; c; c = next_peer_connection(state, c)) {
+                c->group_confirmed &= (uint8_t)~bit;
+                c->group_member &= (uint8_t)~bit;
+            }
+            break;
+        case GROUP_JOINED:
+        case GROUP_MEMBER:
+            if (!(reply->group_member & bit)) {
+                EOS_LOG_DEBUG("P2P: %s is a member of group %s", rp->sender_id, group->id);
+            }
+            for (PeerConnection* c = reply; c; c = next_peer_connection(state, c)) {
+                c->group_member |= bit;
+            }
+            // Answer every JOINED, so a peer that lost our answer (or
+            // restarted) learns we are in the group from its next one.
+            if (rp->data[4] == GROUP_JOINED) p2p_send_group_msg(state, reply, group, GROUP_MEMBER);
+            break;
+        default:
+            break;
+    }
+}
+
+// Parse a comma-separated list of channel numbers into a per-channel flag
+// table (entries that are not channel numbers are skipped).
+static void parse_channel_list(const char* list, bool* out) {
+    while (*list) {
+        char* end;
+        long ch = strtol(list, &end, 10);
+        if (end == list) {
+            list++;
+            continue;
+        }
+        if (ch >= 0 && ch < P2P_CHANNELS) out[ch] = true;
+        list = end;
+    }
+}
+
 // Create P2P state
 P2PState* p2p_create(PlatformState* platform) {
     if (!platform) {
@@ -398,6 +1904,14 @@ P2PState* p2p_create(PlatformState* platform) {
     state->platform = platform;
     state->auto_accept_all = true;  // Default: auto-accept all connections
     state->next_notif_id = 1;
+    p2p_pool_init(&state->pool);
+    recv_queue_reset(state);
+    send_queue_reset(state);
+    conn_index_reset(state);
+    // Seed connection tokens so a restarted instance doesn't reuse the
+    // tokens its previous run handed out.
+    state->token_generation = (uint32_t)get_time_ms() ^ (uint32_t)(uintptr_t)state;
+    state->handshake_rng = state->token_generation | 1;
     state->nat_type = EOS_NAT_Open;  // Always Open for LAN
     state->nat_queried = true;
     state->relay_control = EOS_RC_AllowRelays;
@@ -418,6 +1932,161 @@ P2PState* p2p_create(PlatformState* platform) {
     state->incoming_queue_max_bytes = DEFAULT_INCOMING_QUEUE_MAX;
     state->outgoing_queue_max_bytes = DEFAULT_OUTGOING_QUEUE_MAX;
 
+    // EOSLAN_P2P_PACE_RATE: cap each connection's DATA at this many bytes
+    // per second so a burst cannot overrun the peer's socket buffer between
+    // its ticks; EOSLAN_P2P_PACE_BURST sets the bucket size (default
+    // P2P_PACE_BURST). Held-back packets wait in the outgoing queue.
+    {
+        const char* env = getenv("EOSLAN_P2P_PACE_RATE");
+        if (env && *env && atoi(env) > 0) state->pace_rate = (uint32_t)atoi(env);
+        state->pace_burst = P2P_PACE_BURST;
+        env = getenv("EOSLAN_P2P_PACE_BURST");
+        if (env && *env && atoi(env) > 0) state->pace_burst = (uint32_t)atoi(env);
+        if (state->pace_rate) {
+            EOS_LOG_INFO("P2P: pacing connections at %u bytes/s (burst %u bytes)",
+                         (unsigned)state->pace_rate, (unsigned)state->pace_burst);
+        }
+    }
+
+    // EOSLAN_P2P_FAIR=1: send queued DATA by deficit round robin across
+    // connections, at most EOSLAN_P2P_FAIR_BUDGET bytes per tick (default
+    // P2P_FAIR_BUDGET). EOSLAN_P2P_PRIORITY_CHANNELS lists the channels sent
+    // ahead of everything else (comma-separated, default "0").
+    {
+        const char* env = getenv("EOSLAN_P2P_FAIR");
+        state->fair = env && atoi(env) != 0;
+        state->fair_budget = P2P_FAIR_BUDGET;
+        env = getenv("EOSLAN_P2P_FAIR_BUDGET");
+        if (env && *env && atoi(env) >= P2P_FAIR_QUANTUM) state->fair_budget = (uint32_t)atoi(env);
+
+        env = getenv("EOSLAN_P2P_PRIORITY_CHANNELS");
+        parse_channel_list(env ? env : "0", state->priority_channel);
+        if (state->fair) {
+            EOS_LOG_INFO("P2P: fair scheduling across connections (%u bytes per tick)",
+                         (unsigned)state->fair_budget);
+        }
+    }
+
+    // EOSLAN_P2P_FEC_CHANNELS: protect unreliable DATA on these channels
+    // (comma-separated) with one XOR parity packet per EOSLAN_P2P_FEC_K
+    // packets (2..P2P_FEC_MAX_K, default P2P_FEC_K), so a receiver rebuilds a
+    // lost packet without a round trip. EOSLAN_P2P_FEC_FLUSH_MS closes a
+    // group early when traffic is sparse (default P2P_FEC_FLUSH_MS).
+    {
+        const char* env = getenv("EOSLAN_P2P_FEC_CHANNELS");
+        if (env) parse_channel_list(env, state->fec_channel);
+        for (int ch = 0; ch < P2P_CHANNELS; ch++) {
+            if (state->fec_channel[ch]) state->fec = true;
+        }
+        state->fec_k = P2P_FEC_K;
+        env = getenv("EOSLAN_P2P_FEC_K");
+        if (env && *env) {
+            int v = atoi(env);
+            if (v >= 2 && v <= P2P_FEC_MAX_K) state->fec_k = (uint32_t)v;
+        }
+        state->fec_flush_ms = P2P_FEC_FLUSH_MS;
+        env = getenv("EOSLAN_P2P_FEC_FLUSH_MS");
+        if (env && *env && atoi(env) >= 0) state->fec_flush_ms = (uint32_t)atoi(env);
+        if (state->fec) {
+            EOS_LOG_INFO("P2P: FEC on %s (one parity per %u packets, flush %u ms)",
+                         getenv("EOSLAN_P2P_FEC_CHANNELS"), (unsigned)state->fec_k,
+                         (unsigned)state->fec_flush_ms);
+        }
+    }
+
+    // EOSLAN_P2P_COMPRESS_CHANNELS: compress DATA on these channels
+    // (comma-separated) for peers whose CONNECT/ACCEPT offer names the same
+    // dictionary. EOSLAN_P2P_COMPRESS_DICT loads that dictionary from a file
+    // (the last 32 KB count); EOSLAN_P2P_COMPRESS_TRAIN samples the traffic
+    // sent on those channels and writes it out as a dictionary at shutdown.
+    {
+        const char* channels = getenv("EOSLAN_P2P_COMPRESS_CHANNELS");
+        if (channels) parse_channel_list(channels, state->compress_channel);
+        const char* env = getenv("EOSLAN_P2P_COMPRESS_DICT");
+        if (env && *env) state->compressor = p2p_compress_load(env);
+        env = getenv("EOSLAN_P2P_COMPRESS_TRAIN");
+        if (env && *env) {
+            snprintf(state->compress_train_path, sizeof(state->compress_train_path), "%s", env);
+        }
+        if (channels && *channels) {
+            EOS_LOG_INFO("P2P: compressing %s (dictionary %08x)%s%s", channels,
+                         state->compressor ? (unsigned)state->compressor->dict_id : 0u,
+                         state->compress_train_path[0] ? ", training to " : "",
+                         state->compress_train_path);
+        }
+    }
+
+    // EOSLAN_P2P_PREWARM=1: handshake with a session/lobby host as soon as
+    // we join, so the path is up before the game sends its first packet.
+    {
+        const char* env = getenv("EOSLAN_P2P_PREWARM");
+        state->prewarm = env && atoi(env) != 0;
+    }
+
+    // EOSLAN_P2P_KEEPALIVE_MS / _INTERRUPT_MS / _IDLE_TIMEOUT_MS: silence
+    // on an established connection before it is PINGed, reported
+    // interrupted and closed as timed out (0 disables each).
+    state->keepalive_ms = P2P_KEEPALIVE_MS;
+    state->interrupt_ms = P2P_INTERRUPT_MS;
+    state->idle_timeout_ms = P2P_IDLE_TIMEOUT_MS;
+    {
+        const char* env = getenv("EOSLAN_P2P_KEEPALIVE_MS");
+        if (env && *env && atoi(env) >= 0) state->keepalive_ms = (uint32_t)atoi(env);
+        env = getenv("EOSLAN_P2P_INTERRUPT_MS");
+        if (env && *env && atoi(env) >= 0) state->interrupt_ms = (uint32_t)atoi(env);
+        env = getenv("EOSLAN_P2P_IDLE_TIMEOUT_MS");
+        if (env && *env && atoi(env) >= 0) state->idle_timeout_ms = (uint32_t)atoi(env);
+    }
+
+    // EOSLAN_CONNECT_TIMEOUT_MS: how long an unanswered CONNECT is retried
+    // before the connection is closed as timed out (0 = retry forever).
+    state->connect_timeout_ms = P2P_CONNECT_TIMEOUT_MS;
+    {
+        const char* env = getenv("EOSLAN_CONNECT_TIMEOUT_MS");
+        if (env && *env) {
+            int v = atoi(env);
+            if (v >= 0) state->connect_timeout_ms = (uint32_t)v;
+        }
+    }
+
+    // EOSLAN_COALESCE=1: gather small DATA packets per peer into one datagram
+    // per tick. EOSLAN_COALESCE_MTU sets the frame budget in bytes (default:
+    // one EOS max-size packet), EOSLAN_COALESCE_US sends a frame early once
+    // its first packet has waited that long.
+    {
+        const char* env = getenv("EOSLAN_COALESCE");
+        state->coalesce = env && atoi(env) != 0;
+        state->coalesce_budget = EOS_P2P_MAX_PACKET_SIZE;
+        env = getenv("EOSLAN_COALESCE_MTU");
+        if (env && *env) {
+            int v = atoi(env);
+            if (v >= 64 && v <= P2P_COALESCE_FRAME_MAX) state->coalesce_budget = (uint32_t)v;
+        }
+        env = getenv("EOSLAN_COALESCE_US");
+        if (env && *env) {
+            int v = atoi(env);
+            if (v > 0) state->coalesce_deadline_us = (uint32_t)v;
+        }
+        if (state->coalesce) {
+            EOS_LOG_INFO("P2P: coalescing small packets (frame %u bytes, deadline %u us)",
+                         (unsigned)state->coalesce_budget, (unsigned)state->coalesce_deadline_us);
+        }
+    }
+
+    // EOSLAN_P2P_MULTICAST=1: join a multicast group for every session and
+    // lobby we are in, on EOSLAN_P2P_MULTICAST_PORT (default P2P_MCAST_PORT),
+    // and send EOSLAN_P2P_SendPacketToGroup's unreliable packets to it once.
+    {
+        const char* env = getenv("EOSLAN_P2P_MULTICAST");
+        state->multicast = env && atoi(env) != 0;
+        state->mcast_port = P2P_MCAST_PORT;
+        env = getenv("EOSLAN_P2P_MULTICAST_PORT");
+        if (env && *env) {
+            int v = atoi(env);
+            if (v > 0 && v < 65536) state->mcast_port = (uint16_t)v;
+        }
+    }
+
     // Bring up the LAN UDP transport. lan_p2p falls back to the next free port
     // when base_port is taken, so the host binds base_port and a second local
     // instance binds base_port+1. A failure here is non-fatal: the rest of the
@@ -429,8 +2098,42 @@ P2PState* p2p_create(PlatformState* platform) {
         EOS_LOG_INFO("P2P: LAN transport bound on %s:%u",
                      lan_p2p_get_local_ip(state->sock),
                      (unsigned)lan_p2p_get_port(state->sock));
+
+        // Before the I/O thread starts, which then reads this socket too.
+        if (state->multicast) {
+            if (lan_p2p_open_multicast(state->sock, state->mcast_port)) {
+                EOS_LOG_INFO("P2P: session multicast on port %u", (unsigned)state->mcast_port);
+            } else {
+                EOS_LOG_ERROR("P2P: cannot open multicast port %u - group sends use unicast",
+                              (unsigned)state->mcast_port);
+                state->multicast = false;
+            }
+        }
+
+        // EOSLAN_IO_URING=1 (Linux): move socket I/O onto io_uring - received
+        // datagrams are reaped from a completion queue without a syscall and
+        // each flush is one submission. Falls back to recvmmsg/sendmmsg.
+        const char* env = getenv("EOSLAN_IO_URING");
+        if (env && atoi(env) != 0) {
+            if (lan_p2p_enable_uring(state->sock)) {
+                EOS_LOG_INFO("P2P: io_uring transport enabled");
+            } else {
+                EOS_LOG_WARN("P2P: io_uring unavailable - using recvmmsg/sendmmsg");
+            }
+        }
+
+        // EOSLAN_IO_THREAD=1: read the socket on a dedicated thread so packets
+        // are picked up (and timestamped) as they arrive rather than once per
+        // game tick. p2p_tick still does all state changes and callbacks.
+        env = getenv("EOSLAN_IO_THREAD");
+        if (env && atoi(env) != 0) {
+            if (lan_p2p_start_io_thread(state->sock)) {
+                EOS_LOG_INFO("P2P: receive I/O thread started");
+            } else {
+                EOS_LOG_ERROR("P2P: failed to start receive I/O thread - receiving on tick");
+            }
+        }
     }
-    state->last_connect_send = 0;
 
     EOS_LOG_INFO("P2P: Created P2P state");
     return state;
@@ -441,10 +2144,20 @@ void p2p_destroy(P2PState* state) {
     if (!state || state->magic != P2P_MAGIC) return;
 
     EOS_LOG_INFO("P2P: Destroying P2P state");
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        release_connection(state, &state->connections[i]);
+    }
     if (state->sock) {
         lan_p2p_destroy(state->sock);
         state->sock = NULL;
     }
+    p2p_pool_free(&state->pool, state->recv_block, P2P_POOL_DATAGRAM);
+    state->recv_block = NULL;
+    p2p_pool_destroy(&state->pool);
+    if (state->compress_train_path[0]) {
+        p2p_compress_write_dictionary(state->compressor, state->compress_train_path);
+    }
+    p2p_compress_destroy(state->compressor);
     state->magic = 0;
     free(state);
 }
@@ -464,47 +2177,134 @@ const char* p2p_get_listen_ip(P2PState* state) {
 void p2p_register_peer_address(P2PState* state, EOS_ProductUserId peer, const char* address) {
     if (!state || state->magic != P2P_MAGIC || !peer || !address) return;
 
-    // Find existing connection or create placeholder
-    bool found = false;
-    for (int i = 0; i < MAX_CONNECTIONS; i++) {
-        PeerConnection* conn = &state->connections[i];
-        if (!conn->valid) continue;
-        if (!product_user_id_equal(conn->peer_id, peer)) continue;
+    // Update every connection to this peer, or create a placeholder
+    char hex[33];
+    product_user_id_to_string(peer, hex, sizeof(hex));
+    PeerConnection* conn = find_peer_connections(state, hex);
+    if (conn) {
+        for (; conn; conn = next_peer_connection(state, conn)) {
+            set_peer_address(conn, address);
+            EOS_LOG_DEBUG("P2P: Updated peer address for %s: %s", conn->peer_id_string, address);
+        }
+        return;
+    }
 
-        // Update address
-        strncpy(conn->peer_address, address, sizeof(conn->peer_address) - 1);
-        conn->peer_address[sizeof(conn->peer_address) - 1] = '\0';
-        found = true;
-        EOS_LOG_DEBUG("P2P: Updated peer address for %s: %s", conn->peer_id_string, address);
+    // Placeholder connection (no socket yet)
+    EOS_P2P_SocketId no_socket;
+    memset(&no_socket, 0, sizeof(no_socket));
+    conn = create_connection(state, peer, hex, &no_socket);
+    if (conn) {
+        set_peer_address(conn, address);
+        conn->address_book = true;
+        EOS_LOG_DEBUG("P2P: Registered new peer address for %s: %s", conn->peer_id_string, address);
     }
+}
 
-    if (!found) {
-        // Create placeholder connection (no socket yet)
-        for (int i = 0; i < MAX_CONNECTIONS; i++) {
-            PeerConnection* conn = &state->connections[i];
-            if (conn->valid) continue;
+// Pre-warm the path to a registered peer: its address book entry runs the
+// CONNECT/ACCEPT handshake on the usual timers. The peer answers without
+// raising a connection request, so what the game sees is unchanged; the
+// socket, shared-memory channel and route to the peer are just already in
+// use, and the measured RTT seeds the retransmission timeout of the game's
+// own connections to it.
+void p2p_prewarm_peer(P2PState* state, EOS_ProductUserId peer) {
+    if (!state || state->magic != P2P_MAGIC || !peer || !state->prewarm) return;
+
+    char hex[33];
+    product_user_id_to_string(peer, hex, sizeof(hex));
+    EOS_P2P_SocketId no_socket;
+    memset(&no_socket, 0, sizeof(no_socket));
+    PeerConnection* conn = find_connection_by_hex(state, hex, &no_socket);
+    if (!conn) {
+        const char* addr = p2p_get_peer_address(state, peer);
+        if (!addr) return;
+        conn = create_connection(state, peer, hex, &no_socket);
+        if (!conn) return;
+        set_peer_address(conn, addr);
+    }
+    conn->address_book = true;
+    if (conn->state != CONN_STATE_NONE || conn->addr.port == 0) return;
+
+    conn->state = CONN_STATE_REQUESTING;
+    conn->handshake_attempts = 0;
+    conn->handshake_next_at = 0;
+    conn->handshake_deadline = 0;
+    EOS_LOG_INFO("P2P: pre-warming path to %s (%s)", conn->peer_id_string, conn->peer_address);
+}
 
-            conn->valid = true;
-            conn->peer_id = peer;
-            product_user_id_to_string(peer, conn->peer_id_string, sizeof(conn->peer_id_string));
-            strncpy(conn->peer_address, address, sizeof(conn->peer_address) - 1);
-            conn->peer_address[sizeof(conn->peer_address) - 1] = '\0';
-            conn->state = CONN_STATE_NONE;
-            state->connection_count++;
-            EOS_LOG_DEBUG("P2P: Registered new peer address for %s: %s", conn->peer_id_string, address);
+// Start tracking a session or lobby the local user is in. With multicast
+// on, its group address is 239.255.x.y (organization-local scope) with x.y
+// taken from the id's hash, so every member derives the same one.
+void p2p_group_join(P2PState* state, const char* group_id) {
+    if (!state || state->magic != P2P_MAGIC || !group_id || !group_id[0]) return;
+    if (find_group(state, group_id)) return;
+
+    P2PGroup* group = NULL;
+    for (int i = 0; i < P2P_MAX_GROUPS; i++) {
+        if (!state->groups[i].valid) {
+            group = &state->groups[i];
             break;
         }
     }
+    if (!group) {
+        EOS_LOG_WARN("P2P: too many groups, not tracking %s", group_id);
+        return;
+    }
+
+    memset(group, 0, sizeof(*group));
+    strncpy(group->id, group_id, sizeof(group->id) - 1);
+    group->hash = group_hash(group->id);
+    uint8_t host = (uint8_t)group->hash;
+    if (host == 0 || host == 255) host ^= 0x80;
+    char addr[64];
+    snprintf(addr, sizeof(addr), "239.255.%u.%u:%u", (unsigned)((group->hash >> 8) & 0xff),
+             (unsigned)host, (unsigned)state->mcast_port);
+    lan_p2p_resolve(addr, &group->addr);
+    group->valid = true;
+
+    if (state->multicast) {
+        group->joined = lan_p2p_join_group(state->sock, &group->addr);
+        if (group->joined) {
+            EOS_LOG_INFO("P2P: joined multicast group %s for %s", addr, group_id);
+        } else {
+            EOS_LOG_WARN("P2P: cannot join multicast group %s for %s - its members get unicast",
+                         addr, group_id);
+        }
+    }
 }
 
-// Get peer address
-const char* p2p_get_peer_address(P2PState* state, EOS_ProductUserId peer) {
-    if (!state || state->magic != P2P_MAGIC || !peer) return NULL;
+// Stop tracking a group. Peers taking our multicast for it are told, so they
+// stop expecting it; peers we multicast to are simply no longer members.
+void p2p_group_leave(P2PState* state, const char* group_id) {
+    if (!state || state->magic != P2P_MAGIC || !group_id) return;
+    P2PGroup* group = find_group(state, group_id);
+    if (!group) return;
 
+    uint8_t bit = group_bit(state, group);
     for (int i = 0; i < MAX_CONNECTIONS; i++) {
         PeerConnection* conn = &state->connections[i];
         if (!conn->valid) continue;
-        if (!product_user_id_equal(conn->peer_id, peer)) continue;
+        if (((conn->group_accepted | conn->group_member) & bit) &&
+            conn->state == CONN_STATE_ESTABLISHED) {
+            p2p_send_group_msg(state, conn, group, GROUP_LEFT);
+        }
+        conn->group_accepted &= (uint8_t)~bit;
+        conn->group_confirmed &= (uint8_t)~bit;
+        conn->group_member &= (uint8_t)~bit;
+        conn->group_announced &= (uint8_t)~bit;
+    }
+    if (group->joined) lan_p2p_leave_group(state->sock, &group->addr);
+    EOS_LOG_DEBUG("P2P: left group %s", group->id);
+    memset(group, 0, sizeof(*group));
+}
+
+// Get peer address
+const char* p2p_get_peer_address(P2PState* state, EOS_ProductUserId peer) {
+    if (!state || state->magic != P2P_MAGIC || !peer) return NULL;
+
+    char hex[33];
+    product_user_id_to_string(peer, hex, sizeof(hex));
+    for (PeerConnection* conn = find_peer_connections(state, hex); conn;
+         conn = next_peer_connection(state, conn)) {
         if (conn->peer_address[0] != '\0') {
             return conn->peer_address;
         }
@@ -513,6 +2313,155 @@ const char* p2p_get_peer_address(P2PState* state, EOS_ProductUserId peer) {
     return NULL;
 }
 
+// Release held ordered packets that are now next in line on their channel.
+static void p2p_drain_held(P2PState* state, PeerConnection* conn) {
+    ReliableState* rs = conn->rel;
+    if (!rs) return;
+    ReliableHeldSlot* slot;
+    while ((slot = p2p_rel_next_ready(rs)) != NULL) {
+        if (!p2p_deliver_data(state, conn, &conn->socket_id, slot->channel, slot->data, slot->size,
+                              slot->arrival_us)) {
+            break;  // receive queue full - retry next tick
+        }
+        p2p_rel_release_held(rs, slot);
+    }
+}
+
+// Run a reliable DATA packet through the connection's receive window:
+// deliver it, hold it for ordering, or drop a duplicate (re-ACKing it).
+static void p2p_recv_reliable(P2PState* state, PeerConnection* conn, const EOS_P2P_SocketId* sock_id,
+                              const P2PReceivedPacket* rp) {
+    ReliableState* rs = connection_rel(conn);
+    if (!rs) return;
+
+    uint16_t seq = (uint16_t)rp->sequence;
+    switch (p2p_rel_classify(rs, seq, rp->ordered, rp->channel, rp->order_sequence)) {
+        case REL_RECV_DELIVER:
+            if (p2p_deliver_data(state, conn, sock_id, rp->channel, rp->data, rp->data_len,
+                                 rp->received_us)) {
+                p2p_rel_mark_received(rs, seq, rp->ordered, rp->channel, rp->order_sequence);
+                p2p_drain_held(state, conn);
+            }
+            break;
+        case REL_RECV_HOLD:
+            p2p_rel_hold(rs, seq, rp->channel, rp->order_sequence, rp->data, rp->data_len,
+                         rp->received_us);
+            break;
+        case REL_RECV_DUPLICATE:
+            break;
+        case REL_RECV_REJECT:
+            EOS_LOG_DEBUG("P2P: reliable seq %u from %s outside receive window",
+                          (unsigned)seq, conn->peer_id_string);
+            break;
+    }
+}
+
+// Handle one DATA message (a standalone datagram or a bundle record).
+static void p2p_recv_data(P2PState* state, PeerConnection* conn, const EOS_P2P_SocketId* sock_id,
+                          const P2PReceivedPacket* rp, uint64_t now) {
+    uint8_t unpacked[EOS_P2P_MAX_PACKET_SIZE];
+    P2PReceivedPacket plain;
+    if (rp->compressed) {
+        P2PCompressor* c = p2p_compressor(state);
+        uint64_t start = get_time_us();
+        int n = c ? p2p_decompress(c, rp->data, rp->data_len, unpacked, sizeof(unpacked)) : -1;
+        conn->decompress_us += get_time_us() - start;
+        if (n < 0) {
+            EOS_LOG_WARN("P2P: dropping undecodable compressed packet from %s (ch %u, %u bytes)",
+                         conn->peer_id_string, (unsigned)rp->channel, rp->data_len);
+            return;
+        }
+        conn->packets_decompressed++;
+        plain = *rp;
+        plain.compressed = false;
+        plain.data = unpacked;
+        plain.data_len = (uint32_t)n;
+        rp = &plain;
+    }
+
+    // Receiving DATA implies the peer considers us connected; make
+    // sure our side is established too (auto-accept path). A connection the
+    // app has neither requested nor accepted drops it, as it drops DATA
+    // carried on a CONNECT: a fast-start peer sends DATA ahead of the ACCEPT
+    // and retransmits what was reliable once the app accepts.
+    if (conn->state != CONN_STATE_ESTABLISHED && !is_socket_auto_accepted(state, sock_id)) {
+        if (conn->state != CONN_STATE_REQUESTING) return;
+    } else if (conn->state != CONN_STATE_ESTABLISHED) {
+        conn->state = CONN_STATE_ESTABLISHED;
+        conn->established_at = now;
+        p2p_send_accept(state, conn);
+        EOS_LOG_INFO("P2P: first DATA from %s on '%s' -> ESTABLISHED (auto-accept)",
+                     rp->sender_id, sock_id->SocketName);
+        p2p_fire_conn_established(state, conn, EOS_CET_NewConnection);
+    }
+
+    if (rp->reliable) {
+        p2p_recv_reliable(state, conn, sock_id, rp);
+    } else {
+        p2p_deliver_data(state, conn, sock_id, rp->channel, rp->data, rp->data_len, rp->received_us);
+    }
+}
+
+// Split a MSG_BUNDLE (or a CONNECT payload) back into its DATA records
+// (layout in p2p_put_record).
+// Record payloads are handed on in place; a truncated record ends the walk.
+static void p2p_recv_bundle(P2PState* state, PeerConnection* conn, const EOS_P2P_SocketId* sock_id,
+                            const P2PReceivedPacket* rp, uint64_t now) {
+    const uint8_t* p = rp->data;
+    const uint8_t* end = rp->data ? rp->data + rp->data_len : NULL;
+
+    while (p && end - p >= 4) {
+        P2PReceivedPacket rec = *rp;
+        rec.message_type = MSG_DATA;
+        rec.channel = p[0];
+        rec.reliable = (p[1] & P2P_FLAG_RELIABLE) != 0;
+        rec.ordered = (p[1] & P2P_FLAG_ORDERED) != 0;
+        rec.compressed = (p[1] & P2P_FLAG_COMPRESSED) != 0;
+        p += 2;
+
+        long need = 2 + (rec.reliable ? 2 : 0) + (rec.ordered ? 2 : 0);
+        if (end - p < need) break;
+        rec.sequence = 0;
+        rec.order_sequence = 0;
+        if (rec.reliable) { rec.sequence = (uint32_t)((p[0] << 8) | p[1]); p += 2; }
+        if (rec.ordered) { rec.order_sequence = (uint16_t)((p[0] << 8) | p[1]); p += 2; }
+        rec.data_len = (uint32_t)((p[0] << 8) | p[1]);
+        p += 2;
+        if ((uint32_t)(end - p) < rec.data_len) break;
+        rec.data = (uint8_t*)p;
+        p += rec.data_len;
+
+        p2p_recv_data(state, conn, sock_id, &rec, now);
+    }
+}
+
+// Handle a MSG_FEC: its DATA is taken like any unreliable packet, then the
+// packet it let the FEC state rebuild, if any.
+static void p2p_recv_fec(P2PState* state, PeerConnection* conn, const EOS_P2P_SocketId* sock_id,
+                         const P2PReceivedPacket* rp, uint64_t now) {
+    FecState* fs = connection_fec(conn);
+    if (!fs) return;
+
+    FecPacket data, rebuilt;
+    p2p_fec_receive(fs, rp->channel, rp->data, rp->data_len, &data, &rebuilt);
+    if (data.valid) {
+        P2PReceivedPacket rec = *rp;
+        rec.message_type = MSG_DATA;
+        rec.reliable = false;
+        rec.ordered = false;
+        rec.compressed = false;
+        rec.data = (uint8_t*)data.data;
+        rec.data_len = data.len;
+        p2p_recv_data(state, conn, sock_id, &rec, now);
+    }
+    if (rebuilt.valid && conn->state == CONN_STATE_ESTABLISHED) {
+        EOS_LOG_DEBUG("P2P: rebuilt lost %u-byte packet from %s (ch %u)",
+                      rebuilt.len, conn->peer_id_string, (unsigned)rebuilt.channel);
+        p2p_deliver_data(state, conn, sock_id, rebuilt.channel, rebuilt.data, rebuilt.len,
+                         rp->received_us);
+    }
+}
+
 // Tick function (process network, timeouts, etc.)
 void p2p_tick(P2PState* state) {
     if (!state || state->magic != P2P_MAGIC) return;
@@ -523,55 +2472,164 @@ void p2p_tick(P2PState* state) {
     // ------------------------------------------------------------------
     // (a) RECEIVE: drain everything the socket has this tick.
     // ------------------------------------------------------------------
+    // Datagrams are received into a datagram-sized pool block and parsed in
+    // place. A large DATA payload keeps the block (queue_received_packet), so
+    // it is not copied again before the application reads it; smaller ones,
+    // and payloads the I/O thread received into its ring, are copied into a
+    // block sized to fit.
     P2PReceivedPacket rp;
-    while (lan_p2p_recv(state->sock, &rp)) {
-        // Build the socket id from the wire socket name.
+    for (;;) {
+        if (!state->recv_block) state->recv_block = p2p_pool_alloc(&state->pool, P2P_POOL_DATAGRAM);
+        if (!lan_p2p_recv(state->sock, &rp, state->recv_block,
+                          state->recv_block ? P2P_POOL_DATAGRAM : 0)) {
+            break;
+        }
+
+        if (!rp.compact && (rp.message_type == MSG_MCAST || rp.message_type == MSG_GROUP)) {
+            p2p_recv_group(state, &rp);
+            continue;
+        }
+
         EOS_P2P_SocketId sock_id;
-        memset(&sock_id, 0, sizeof(sock_id));
-        sock_id.ApiVersion = EOS_P2P_SOCKETID_API_LATEST;
-        strncpy(sock_id.SocketName, rp.socket_name, EOS_P2P_SOCKETID_SOCKETNAME_SIZE - 1);
-        sock_id.SocketName[EOS_P2P_SOCKETID_SOCKETNAME_SIZE - 1] = '\0';
+        PeerConnection* conn = NULL;
 
-        // Find the connection by the peer's hex id (pointer identity is not
-        // stable across FromString calls). Create one on first contact.
-        PeerConnection* conn = find_connection_by_hex(state, rp.sender_id, &sock_id);
-        if (!conn) {
-            EOS_ProductUserId peer = EOS_ProductUserId_FromString(rp.sender_id);
-            if (!peer) {
-                EOS_LOG_WARN("P2P: dropping packet with invalid sender id '%s'", rp.sender_id);
+        if (rp.compact) {
+            // Compact DATA/ACK: the token we handed out names the connection.
+            conn = find_connection_by_token(state, rp.token);
+            if (!conn) {
+                char from[64];
+                lan_p2p_format_address(&rp.sender_addr, from, sizeof(from));
+                EOS_LOG_DEBUG("P2P: dropping compact packet with stale token %08x from %s",
+                              (unsigned)rp.token, from);
                 continue;
             }
-            conn = create_connection(state, peer, &sock_id);
+            copy_socket_id(&sock_id, &conn->socket_id);
+            strncpy(rp.sender_id, conn->peer_id_string, sizeof(rp.sender_id) - 1);
+            rp.sender_id[sizeof(rp.sender_id) - 1] = '\0';
+        } else {
+            // Build the socket id from the wire socket name.
+            memset(&sock_id, 0, sizeof(sock_id));
+            sock_id.ApiVersion = EOS_P2P_SOCKETID_API_LATEST;
+            strncpy(sock_id.SocketName, rp.socket_name, EOS_P2P_SOCKETID_SOCKETNAME_SIZE - 1);
+            sock_id.SocketName[EOS_P2P_SOCKETID_SOCKETNAME_SIZE - 1] = '\0';
+
+            // Find the connection by the peer's hex id (pointer identity is not
+            // stable across FromString calls). Create one on first contact.
+            conn = find_connection_by_hex(state, rp.sender_id, &sock_id);
+            if (!conn && (rp.message_type == MSG_CLOSE || rp.message_type == MSG_PING ||
+                          rp.message_type == MSG_PONG)) {
+                continue;  // nothing to close or keep alive (e.g. a repeated CLOSE)
+            }
             if (!conn) {
-                EOS_LOG_ERROR("P2P: connection table full, dropping packet from %s", rp.sender_id);
+                EOS_ProductUserId peer = EOS_ProductUserId_FromString(rp.sender_id);
+                if (!peer) {
+                    EOS_LOG_WARN("P2P: dropping packet with invalid sender id '%s'", rp.sender_id);
+                    continue;
+                }
+                // Key the connection on the wire hex id (not the "%p" pointer form).
+                conn = create_connection(state, peer, rp.sender_id, &sock_id);
+                if (!conn) {
+                    EOS_LOG_ERROR("P2P: connection table full, dropping packet from %s", rp.sender_id);
+                    continue;
+                }
+            }
+
+            // A new token on CONNECT means the peer restarted: its reliable
+            // stream starts over, so ours must too.
+            if (rp.message_type == MSG_CONNECT && conn->remote_token != 0 &&
+                rp.token != conn->remote_token) {
+                EOS_LOG_INFO("P2P: %s on '%s' reconnected with a new token - resetting stream",
+                             rp.sender_id, sock_id.SocketName);
+                p2p_rel_reset(conn->rel);
+            }
+            if (rp.token != 0) conn->remote_token = rp.token;
+        }
+
+        // A connection we are closing only listens for the peer's CLOSE, or
+        // a CONNECT that starts it over from scratch.
+        if (conn->state == CONN_STATE_CLOSING) {
+            if (rp.message_type == MSG_CLOSE) {
+                release_connection(state, conn);
                 continue;
             }
-            // Key the connection on the wire hex id (not the "%p" pointer form).
-            strncpy(conn->peer_id_string, rp.sender_id, sizeof(conn->peer_id_string) - 1);
-            conn->peer_id_string[sizeof(conn->peer_id_string) - 1] = '\0';
+            if (rp.message_type != MSG_CONNECT) continue;
+            p2p_rel_reset(conn->rel);
+            conn->state = CONN_STATE_NONE;
+            conn->handshake_attempts = 0;
+            conn->handshake_next_at = 0;
+        }
+
+        // Learn / refresh the peer's source address and liveness. The
+        // string form is only rebuilt when the address actually changes.
+        // Same-host datagrams from the shared-memory inbox are reported as
+        // loopback; they don't replace the peer's known address on that port.
+        bool same_host = lan_p2p_is_loopback(&rp.sender_addr) &&
+                         rp.sender_addr.port == conn->addr.port;
+        if (!same_host &&
+            (conn->addr.ip != rp.sender_addr.ip || conn->addr.port != rp.sender_addr.port)) {
+            conn->addr = rp.sender_addr;
+            lan_p2p_format_address(&conn->addr, conn->peer_address, sizeof(conn->peer_address));
+        }
+        conn->last_activity = rp.received_at;
+        if (conn->interrupted) {
+            conn->interrupted = false;
+            EOS_LOG_INFO("P2P: %s on '%s' is back after an interruption",
+                         conn->peer_id_string, conn->socket_id.SocketName);
+            p2p_fire_conn_established(state, conn, EOS_CET_Reconnection);
         }
 
-        // Learn / refresh the peer's source address and liveness.
-        strncpy(conn->peer_address, rp.sender_addr, sizeof(conn->peer_address) - 1);
-        conn->peer_address[sizeof(conn->peer_address) - 1] = '\0';
-        conn->last_activity = now;
+        // Any message may carry an ACK for our reliable stream. Use the
+        // arrival time so RTT samples don't include time spent waiting for
+        // the tick.
+        if (rp.has_ack && conn->rel) {
+            p2p_rel_on_ack(conn->rel, rp.ack, rp.ack_bits, rp.received_at);
+        }
+
+        if (rp.message_type == MSG_CONNECT || rp.message_type == MSG_ACCEPT) {
+            p2p_recv_offer(state, conn, &rp);
+        }
 
         switch (rp.message_type) {
             case MSG_CONNECT: {
                 if (conn->state == CONN_STATE_ESTABLISHED) {
-                    // Retransmitted CONNECT - just re-ACK, don't re-fire.
-                    p2p_send_msg(state, conn, MSG_ACCEPT, 0, NULL, 0);
+                    // Retransmitted CONNECT - take any DATA it carries that we
+                    // missed and re-ACCEPT (with the ACK), don't re-fire.
+                    p2p_recv_bundle(state, conn, &sock_id, &rp, now);
+                    p2p_send_accept(state, conn);
                     break;
                 }
+                if (conn->state == CONN_STATE_PENDING) {
+                    break;  // retransmitted while the app decides - already reported
+                }
+                if (is_transport_connection(conn)) {
+                    // Pre-warm from a peer that joined us: answer it, nothing
+                    // for the game to accept.
+                    conn->state = CONN_STATE_ESTABLISHED;
+                    conn->established_at = now;
+                    p2p_send_accept(state, conn);
+                    EOS_LOG_DEBUG("P2P: pre-warm CONNECT from %s answered", rp.sender_id);
+                    break;
+                }
+                // A fresh CONNECT means the peer (re)started its stream. Our
+                // own REQUESTING window is new as well and may already hold
+                // packets adopted for our CONNECT, so it is left alone.
+                if (conn->state != CONN_STATE_REQUESTING) {
+                    p2p_rel_reset(conn->rel);
+                }
                 if (is_socket_auto_accepted(state, &sock_id)) {
                     conn->state = CONN_STATE_ESTABLISHED;
                     conn->established_at = now;
-                    p2p_send_msg(state, conn, MSG_ACCEPT, 0, NULL, 0);
+                    // DATA carried on the CONNECT is taken before the ACCEPT
+                    // goes out, so the ACCEPT acknowledges it.
+                    p2p_recv_bundle(state, conn, &sock_id, &rp, now);
+                    p2p_send_accept(state, conn);
                     EOS_LOG_INFO("P2P: CONNECT from %s on '%s' auto-accepted -> sent ACCEPT, ESTABLISHED",
                                  rp.sender_id, sock_id.SocketName);
                     p2p_fire_conn_request(state, conn);
-                    p2p_fire_conn_established(state, conn);
+                    p2p_fire_conn_established(state, conn, EOS_CET_NewConnection);
                 } else {
+                    // Any DATA it carries is dropped; the peer retransmits it
+                    // once the app accepts.
                     conn->state = CONN_STATE_PENDING;
                     EOS_LOG_INFO("P2P: CONNECT from %s on '%s' pending app accept",
                                  rp.sender_id, sock_id.SocketName);
@@ -581,55 +2639,70 @@ void p2p_tick(P2PState* state) {
             }
 
             case MSG_ACCEPT: {
+                if (is_transport_connection(conn)) {
+                    if (conn->state != CONN_STATE_REQUESTING) break;
+                    conn->state = CONN_STATE_ESTABLISHED;
+                    conn->established_at = now;
+                    // Only an unrepeated CONNECT gives an unambiguous sample.
+                    if (conn->handshake_attempts == 1 && rp.received_at >= conn->handshake_sent_at) {
+                        conn->rtt_hint_ms = (uint32_t)(rp.received_at - conn->handshake_sent_at);
+                        if (conn->rtt_hint_ms == 0) conn->rtt_hint_ms = 1;
+                    }
+                    EOS_LOG_INFO("P2P: pre-warmed path to %s (%s), handshake RTT %u ms",
+                                 rp.sender_id, conn->peer_address, (unsigned)conn->rtt_hint_ms);
+                    break;
+                }
                 if (conn->state != CONN_STATE_ESTABLISHED) {
                     conn->state = CONN_STATE_ESTABLISHED;
                     conn->established_at = now;
+                    if (conn->handshake_attempts == 1 && rp.received_at >= conn->handshake_sent_at) {
+                        conn_rtt_sample(conn, (uint32_t)(rp.received_at - conn->handshake_sent_at));
+                    }
                     EOS_LOG_INFO("P2P: ACCEPT from %s on '%s' -> ESTABLISHED",
                                  rp.sender_id, sock_id.SocketName);
-                    p2p_fire_conn_established(state, conn);
-                    // Drain anything we queued for this peer while connecting.
-                    p2p_flush_send_queue(state);
+                    p2p_fire_conn_established(state, conn, EOS_CET_NewConnection);
+                    // Send what was adopted for the CONNECT and not ACKed by
+                    // this ACCEPT (it did not fit, or a pending peer dropped
+                    // it) at once, then anything else queued while connecting.
+                    if (conn->rel) {
+                        p2p_rel_expedite(conn->rel, now);
+                        p2p_send_due(state, conn, now);
+                    }
+                    if (!state->fair) p2p_flush_connection_queue(state, conn);
                 }
                 break;
             }
 
-            case MSG_DATA: {
-                // Receiving DATA implies the peer considers us connected; make
-                // sure our side is established too (auto-accept path).
-                if (conn->state != CONN_STATE_ESTABLISHED &&
-                    is_socket_auto_accepted(state, &sock_id)) {
-                    conn->state = CONN_STATE_ESTABLISHED;
-                    conn->established_at = now;
-                    p2p_send_msg(state, conn, MSG_ACCEPT, 0, NULL, 0);
-                    EOS_LOG_INFO("P2P: first DATA from %s on '%s' -> ESTABLISHED (auto-accept)",
-                                 rp.sender_id, sock_id.SocketName);
-                    p2p_fire_conn_established(state, conn);
-                }
+            case MSG_DATA:
+                p2p_recv_data(state, conn, &sock_id, &rp, now);
+                break;
 
-                ReceivedPacket out;
-                memset(&out, 0, sizeof(out));
-                out.valid = true;
-                out.sender = conn->peer_id;
-                strncpy(out.sender_id_string, rp.sender_id, sizeof(out.sender_id_string) - 1);
-                copy_socket_id(&out.socket_id, &sock_id);
-                out.channel = rp.channel;
-                out.size = (rp.data_len > MAX_PACKET_SIZE) ? MAX_PACKET_SIZE : rp.data_len;
-                if (rp.data && out.size > 0) {
-                    memcpy(out.data, rp.data, out.size);
-                }
-                queue_received_packet(state, &out);
-                EOS_LOG_DEBUG("P2P: recv DATA %u bytes from %s (ch %u)",
-                              out.size, rp.sender_id, (unsigned)rp.channel);
+            case MSG_BUNDLE:
+                p2p_recv_bundle(state, conn, &sock_id, &rp, now);
+                break;
+
+            case MSG_FEC:
+                p2p_recv_fec(state, conn, &sock_id, &rp, now);
+                break;
+
+            case MSG_ACK:
+                // Header-only; the ACK fields were consumed above.
+                break;
+
+            case MSG_PING:
+                p2p_send_msg(state, conn, MSG_PONG, 0, rp.data, rp.data_len <= 8 ? rp.data_len : 8);
+                break;
+
+            case MSG_PONG:
+                p2p_recv_pong(conn, &rp);
                 break;
-            }
 
             case MSG_CLOSE: {
                 if (conn->state != CONN_STATE_CLOSED && conn->valid) {
                     conn->state = CONN_STATE_CLOSED;
                     EOS_LOG_INFO("P2P: CLOSE from %s on '%s'", rp.sender_id, sock_id.SocketName);
                     p2p_fire_conn_closed(state, conn, EOS_CCR_ClosedByPeer);
-                    conn->valid = false;
-                    if (state->connection_count > 0) state->connection_count--;
+                    release_connection(state, conn);
                 }
                 break;
             }
@@ -641,24 +2714,229 @@ void p2p_tick(P2PState* state) {
         }
     }
 
-    // ------------------------------------------------------------------
-    // (b) SEND: (re)send CONNECT for connections still waiting for ACCEPT.
-    // ------------------------------------------------------------------
+    // ------------------------------------------------------------------
+    // (b) HANDSHAKE: (re)send CONNECT for connections still waiting for
+    // ACCEPT, and CLOSE for connections being closed, each on its own timer.
+    // ------------------------------------------------------------------
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        PeerConnection* conn = &state->connections[i];
+        if (!conn->valid) continue;
+
+        if (conn->state == CONN_STATE_REQUESTING) {
+            if (conn->addr.port == 0) continue;  // no target yet
+            if (conn->handshake_deadline != 0 && now >= conn->handshake_deadline) {
+                p2p_connect_timed_out(state, conn);
+                continue;
+            }
+            if (now < conn->handshake_next_at) continue;
+            p2p_send_connect(state, conn, now);
+        } else if (conn->state == CONN_STATE_CLOSING) {
+            if (now < conn->handshake_next_at) continue;
+            if (conn->handshake_attempts >= P2P_CLOSE_SENDS) {
+                release_connection(state, conn);
+                continue;
+            }
+            p2p_send_msg(state, conn, MSG_CLOSE, 0, NULL, 0);
+            conn->handshake_attempts++;
+            conn->handshake_next_at = now + handshake_backoff(state, conn->handshake_attempts);
+        }
+    }
+
+    // (c) Flush queued DATA for any connection that is now established
+    // (through the fair scheduler when it is on).
+    if (state->fair) {
+        p2p_schedule_send(state);
+    } else {
+        p2p_flush_send_queue(state);
+    }
+
+    // ------------------------------------------------------------------
+    // (d) RELIABILITY: retransmit timed-out packets, release held ordered
+    // packets the app queue had no room for, and ACK anything still owed
+    // (piggybacking in (a)-(c) clears ack_pending when there was traffic).
+    // ------------------------------------------------------------------
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        PeerConnection* conn = &state->connections[i];
+        if (!conn->valid || !conn->rel) continue;
+        if (conn->state != CONN_STATE_ESTABLISHED) continue;
+
+        p2p_send_due(state, conn, now);
+        p2p_drain_held(state, conn);
+
+        // A coalesced frame going out now carries the ACK itself.
+        p2p_flush_frame(state, conn);
+        if (conn->rel->ack_pending) {
+            p2p_send_msg(state, conn, MSG_ACK, 0, NULL, 0);
+        }
+    }
+
+    // (e) LIVENESS: keepalive PINGs, interrupted/timed-out connections.
+    // Pre-warmed paths are kept alive too, so a dead peer's stops enabling
+    // fast start (p2p_open_connection) and is let go.
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        PeerConnection* conn = &state->connections[i];
+        if (!conn->valid || conn->state != CONN_STATE_ESTABLISHED) continue;
+        p2p_check_liveness(state, conn, now);
+    }
+
+    // (f) GROUPS: tell newly established peers which groups we are in (and
+    // repeat it to those not known as members yet, in case it was lost), and
+    // probe the multicast groups, so members that hear us confirm it
+    // (p2p_recv_group).
+    for (int i = 0; i < P2P_MAX_GROUPS; i++) {
+        P2PGroup* group = &state->groups[i];
+        if (!group->valid) continue;
+        uint8_t bit = group_bit(state, group);
+        bool repeat = now >= group->announce_at;
+        if (repeat) group->announce_at = now + P2P_GROUP_PROBE_MS;
+        for (int c = 0; c < MAX_CONNECTIONS; c++) {
+            PeerConnection* conn = &state->connections[c];
+            if (!conn->valid || conn->state != CONN_STATE_ESTABLISHED) continue;
+            if (is_transport_connection(conn)) continue;
+            bool due = !(conn->group_announced & bit) || (repeat && !(conn->group_member & bit));
+            if (!due) continue;
+            p2p_send_group_msg(state, conn, group, GROUP_JOINED);
+            conn->group_announced |= bit;
+        }
+
+        if (!group->joined || now < group->probe_at) continue;
+        uint8_t kind = GROUP_PROBE;
+        p2p_send_to_group_address(state, group, MSG_GROUP, "", 0, &kind, 1);
+        group->probe_at = now + P2P_GROUP_PROBE_MS;
+    }
+
+    // (g) Close FEC groups that have waited fec_flush_ms for their parity
+    // and send the remaining coalesced frames, then write out everything
+    // sent this tick and since the last one (a single sendmmsg per P2P_BATCH
+    // datagrams where batching is available).
     for (int i = 0; i < MAX_CONNECTIONS; i++) {
         PeerConnection* conn = &state->connections[i];
         if (!conn->valid) continue;
-        if (conn->state != CONN_STATE_REQUESTING) continue;
-        if (conn->peer_address[0] == '\0') continue;  // no target yet
+        if (conn->fec && conn->fec->send_count > 0 &&
+            now - conn->fec->send_started >= state->fec_flush_ms) {
+            p2p_send_fec_parity(state, conn);
+        }
+        p2p_flush_frame(state, conn);
+    }
+    lan_p2p_flush(state->sock);
+}
+
+// Open a connection for the first packet sent to a peer on a socket. It
+// starts REQUESTING and the next p2p_tick sends the first CONNECT, carrying
+// whatever has been queued for the peer by then, and re-sends it on the
+// connection's own backoff timer.
+// If the peer's transport connection is already established (pre-warmed by
+// p2p_prewarm_peer), the peer is known to be there and answering: the CONNECT
+// goes out now and DATA follows at once without waiting for the ACCEPT
+// (can_transmit). The peer auto-accepts on whichever arrives first.
+static PeerConnection* p2p_open_connection(P2PState* state, EOS_ProductUserId remote_user_id,
+                                           const EOS_P2P_SocketId* socket_id) {
+    // Keyed on the peer's real 32-char hex id (matches what arrives on
+    // the wire), not the internal "%p" dedup form.
+    PeerConnection* conn = create_connection(state, remote_user_id, NULL, socket_id);
+    if (!conn) return NULL;
+
+    // Try to get peer address (registered from the lobby/session host_address)
+    const char* addr = p2p_get_peer_address(state, remote_user_id);
+    if (addr) {
+        set_peer_address(conn, addr);
+    }
+    conn->state = CONN_STATE_REQUESTING;
+
+    for (PeerConnection* c = find_peer_connections(state, conn->peer_id_string); c;
+         c = next_peer_connection(state, c)) {
+        if (c != conn && is_transport_connection(c) && c->state == CONN_STATE_ESTABLISHED &&
+            !c->interrupted) {
+            conn->fast_start = (conn->addr.port != 0);
+            break;
+        }
+    }
+    if (conn->fast_start) {
+        p2p_send_connect(state, conn, get_time_ms());
+        EOS_LOG_INFO("P2P_SendPacket: fast-starting connection to pre-warmed %s (%s)",
+                     conn->peer_id_string, conn->peer_address);
+    } else {
+        EOS_LOG_INFO("P2P_SendPacket: initiating connection to %s (%s)",
+                     conn->peer_id_string,
+                     conn->peer_address[0] ? conn->peer_address : "addr pending");
+    }
+    return conn;
+}
+
+// Send or queue one validated packet. *conn_io is the connection to use when
+// the caller already knows it (NULL to look it up) and is set to the one the
+// packet went to, or NULL if none was created.
+static EOS_EResult p2p_send_packet(P2PState* state, const EOS_P2P_SendPacketOptions* Options,
+                                   PeerConnection** conn_io) {
+    // Look up or create connection. Sending on a connection we are still
+    // closing starts a new one.
+    PeerConnection* conn = *conn_io;
+    if (!conn) conn = find_connection(state, Options->RemoteUserId, Options->SocketId);
+    if (conn && conn->state == CONN_STATE_CLOSING) {
+        release_connection(state, conn);
+        conn = NULL;
+    }
+    *conn_io = conn;
+
+    bool reliable = (Options->Reliability != EOS_PR_UnreliableUnordered);
+    bool ordered = (Options->Reliability == EOS_PR_ReliableOrdered);
+
+    // Create the connection on the first send, unless the caller only sends
+    // on connections that are already open.
+    if (!conn) {
+        if (Options->bDisableAutoAcceptConnection) {
+            EOS_LOG_WARN("P2P_SendPacket: No connection and auto-accept disabled");
+            return EOS_NoConnection;
+        }
+        conn = p2p_open_connection(state, Options->RemoteUserId, Options->SocketId);
+        if (!conn) {
+            EOS_LOG_ERROR("P2P_SendPacket: Failed to create connection (limit exceeded)");
+            return EOS_LimitExceeded;
+        }
+        *conn_io = conn;
+    }
+
+    // Connection established (or fast-starting) - transmit immediately over
+    // the LAN socket. Reliable packets only bypass the send queue when
+    // nothing older is waiting in it, so queued packets keep their order.
+    // The fair scheduler sends everything from the queue on the next tick.
+    bool established = can_transmit(conn);
+    if (established && !state->fair &&
+        (!reliable || conn->send_count == 0) &&
+        p2p_send_data(state, conn, Options->Channel, reliable, ordered,
+                      (const uint8_t*)Options->Data, Options->DataLengthBytes)) {
+        EOS_LOG_DEBUG("P2P_SendPacket: sent %u bytes to established connection (ch %u)",
+                      Options->DataLengthBytes, (unsigned)Options->Channel);
+        return EOS_Success;
+    }
+
+    // Established but the reliable window is full (or older packets are
+    // queued ahead of this one): it must wait its turn in the send queue.
+    // A connection still handshaking only queues when the caller allows it.
+    if (!established && Options->bDisableAutoAcceptConnection) {
+        EOS_LOG_WARN("P2P_SendPacket: No connection and auto-accept disabled");
+        return EOS_NoConnection;
+    }
 
-        if ((now - state->last_connect_send) >= P2P_CONNECT_RESEND_MS) {
-            p2p_send_msg(state, conn, MSG_CONNECT, 0, NULL, 0);
-            state->last_connect_send = now;
-            EOS_LOG_DEBUG("P2P: sent CONNECT to %s (%s)", conn->peer_id_string, conn->peer_address);
+    // Queue packet if allowed
+    if (Options->bAllowDelayedDelivery || established) {
+        PendingPacket packet = {0};
+        packet.channel = Options->Channel;
+        packet.size = Options->DataLengthBytes;
+        packet.reliable = reliable;
+        packet.ordered = ordered;
+
+        if (queue_pending_packet(state, conn, &packet, Options->Data)) {
+            EOS_LOG_DEBUG("P2P_SendPacket: Queued packet for delayed delivery");
+            return EOS_Success;
+        } else {
+            EOS_LOG_ERROR("P2P_SendPacket: Failed to queue packet");
+            return EOS_LimitExceeded;
         }
     }
 
-    // (c) Flush queued DATA for any connection that is now established.
-    p2p_flush_send_queue(state);
+    EOS_LOG_WARN("P2P_SendPacket: No connection and delayed delivery not allowed");
+    return EOS_NoConnection;
 }
 
 //
@@ -702,85 +2980,8 @@ EOS_EResult EOS_P2P_SendPacket(
         return EOS_LimitExceeded;
     }
 
-    // Look up or create connection
-    PeerConnection* conn = find_connection(state, Options->RemoteUserId, Options->SocketId);
-
-    if (conn && conn->state == CONN_STATE_ESTABLISHED) {
-        // Connection established - transmit immediately over the LAN socket.
-        p2p_send_msg(state, conn, MSG_DATA, Options->Channel,
-                     (const uint8_t*)Options->Data, Options->DataLengthBytes);
-        EOS_LOG_DEBUG("P2P_SendPacket: sent %u bytes to established connection (ch %u)",
-                      Options->DataLengthBytes, (unsigned)Options->Channel);
-        return EOS_Success;
-    }
-
-    // No established connection
-    if (Options->bDisableAutoAcceptConnection) {
-        EOS_LOG_WARN("P2P_SendPacket: No connection and auto-accept disabled");
-        return EOS_NoConnection;
-    }
-
-    // Create connection if needed
-    if (!conn) {
-        conn = create_connection(state, Options->RemoteUserId, Options->SocketId);
-        if (!conn) {
-            EOS_LOG_ERROR("P2P_SendPacket: Failed to create connection (limit exceeded)");
-            return EOS_LimitExceeded;
-        }
-
-        // Key the connection on the peer's real 32-char hex id (matches what
-        // arrives on the wire), not the internal "%p" dedup form.
-        {
-            char hex[33];
-            int32_t hlen = (int32_t)sizeof(hex);
-            if (EOS_ProductUserId_ToString(Options->RemoteUserId, hex, &hlen) == EOS_Success) {
-                strncpy(conn->peer_id_string, hex, sizeof(conn->peer_id_string) - 1);
-                conn->peer_id_string[sizeof(conn->peer_id_string) - 1] = '\0';
-            }
-        }
-
-        // Try to get peer address (registered from the lobby/session host_address)
-        const char* addr = p2p_get_peer_address(state, Options->RemoteUserId);
-        if (addr) {
-            strncpy(conn->peer_address, addr, sizeof(conn->peer_address) - 1);
-            conn->peer_address[sizeof(conn->peer_address) - 1] = '\0';
-        }
-
-        // Move to REQUESTING; p2p_tick sends (and re-sends) the CONNECT message.
-        conn->state = CONN_STATE_REQUESTING;
-        state->last_connect_send = 0;  // let tick fire the first CONNECT immediately
-        EOS_LOG_INFO("P2P_SendPacket: initiating connection to %s (%s)",
-                     conn->peer_id_string,
-                     conn->peer_address[0] ? conn->peer_address : "addr pending");
-    }
-
-    // Queue packet if allowed
-    if (Options->bAllowDelayedDelivery) {
-        PendingPacket packet = {0};
-        packet.valid = true;
-        packet.target = Options->RemoteUserId;
-        product_user_id_to_string(Options->RemoteUserId, packet.target_id_string, sizeof(packet.target_id_string));
-        copy_socket_id(&packet.socket_id, Options->SocketId);
-        packet.channel = Options->Channel;
-        packet.size = Options->DataLengthBytes;
-        packet.reliable = (Options->Reliability != EOS_PR_UnreliableUnordered);
-        packet.allow_delayed = true;
-
-        if (Options->DataLengthBytes > 0) {
-            memcpy(packet.data, Options->Data, Options->DataLengthBytes);
-        }
-
-        if (queue_pending_packet(state, &packet)) {
-            EOS_LOG_DEBUG("P2P_SendPacket: Queued packet for delayed delivery");
-            return EOS_Success;
-        } else {
-            EOS_LOG_ERROR("P2P_SendPacket: Failed to queue packet");
-            return EOS_LimitExceeded;
-        }
-    }
-
-    EOS_LOG_WARN("P2P_SendPacket: No connection and delayed delivery not allowed");
-    return EOS_NoConnection;
+    PeerConnection* conn = NULL;
+    return p2p_send_packet(state, Options, &conn);
 }
 
 EOS_EResult EOS_P2P_GetNextReceivedPacketSize(
@@ -806,26 +3007,12 @@ EOS_EResult EOS_P2P_GetNextReceivedPacketSize(
         return EOS_InvalidParameters;
     }
 
-    // Find first matching packet in queue
-    for (int i = 0; i < state->recv_count; i++) {
-        int idx = (state->recv_head + i) % MAX_RECV_QUEUE;
-        ReceivedPacket* pkt = &state->recv_queue[idx];
+    // Oldest packet overall, or on the requested channel
+    ReceivedPacket* pkt = recv_queue_peek(state, Options->RequestedChannel);
+    if (!pkt) return EOS_NotFound;
 
-        if (!pkt->valid) continue;
-
-        // Check channel filter
-        if (Options->RequestedChannel) {
-            if (pkt->channel != *Options->RequestedChannel) {
-                continue;
-            }
-        }
-
-        // Found matching packet
-        *OutPacketSizeBytes = pkt->size;
-        return EOS_Success;
-    }
-
-    return EOS_NotFound;
+    *OutPacketSizeBytes = pkt->size;
+    return EOS_Success;
 }
 
 EOS_EResult EOS_P2P_ReceivePacket(
@@ -854,45 +3041,14 @@ EOS_EResult EOS_P2P_ReceivePacket(
         return EOS_InvalidParameters;
     }
 
-    // Find first matching packet
-    for (int i = 0; i < state->recv_count; i++) {
-        int idx = (state->recv_head + i) % MAX_RECV_QUEUE;
-        ReceivedPacket* pkt = &state->recv_queue[idx];
-
-        if (!pkt->valid) continue;
-
-        // Check channel filter
-        if (Options->RequestedChannel) {
-            if (pkt->channel != *Options->RequestedChannel) {
-                continue;
-            }
-        }
-
-        // Found matching packet - copy out
-        if (OutPeerId) *OutPeerId = pkt->sender;
-        if (OutSocketId) copy_socket_id(OutSocketId, &pkt->socket_id);
-        if (OutChannel) *OutChannel = pkt->channel;
+    // Oldest packet overall, or on the requested channel
+    ReceivedPacket* pkt = recv_queue_peek(state, Options->RequestedChannel);
+    if (!pkt) return EOS_NotFound;
 
-        uint32_t copy_size = (pkt->size < Options->MaxDataSizeBytes) ? pkt->size : Options->MaxDataSizeBytes;
-        memcpy(OutData, pkt->data, copy_size);
-        *OutBytesWritten = copy_size;
-
-        // Update queue size tracking
-        state->incoming_queue_current_bytes -= pkt->size;
-
-        // Remove from queue
-        pkt->valid = false;
-
-        // Compact queue if at head
-        while (state->recv_count > 0 && !state->recv_queue[state->recv_head].valid) {
-            state->recv_head = (state->recv_head + 1) % MAX_RECV_QUEUE;
-            state->recv_count--;
-        }
-
-        return EOS_Success;
-    }
-
-    return EOS_NotFound;
+    if (OutPeerId) *OutPeerId = pkt->sender;
+    *OutBytesWritten = recv_queue_take(state, pkt, OutSocketId, OutChannel, OutData,
+                                       Options->MaxDataSizeBytes);
+    return EOS_Success;
 }
 
 EOS_NotificationId EOS_P2P_AddNotifyPeerConnectionRequest(
@@ -1192,11 +3348,11 @@ EOS_EResult EOS_P2P_AcceptConnection(
         if (conn->state == CONN_STATE_PENDING || conn->state == CONN_STATE_REQUESTING) {
             conn->state = CONN_STATE_ESTABLISHED;
             conn->established_at = get_time_ms();
-            p2p_send_msg(state, conn, MSG_ACCEPT, 0, NULL, 0);
+            p2p_send_accept(state, conn);
             EOS_LOG_INFO("P2P: AcceptConnection -> sent ACCEPT, ESTABLISHED with %s",
                          conn->peer_id_string);
-            p2p_fire_conn_established(state, conn);
-            p2p_flush_send_queue(state);
+            p2p_fire_conn_established(state, conn, EOS_CET_NewConnection);
+            if (!state->fair) p2p_flush_connection_queue(state, conn);
         }
     }
 
@@ -1228,23 +3384,18 @@ EOS_EResult EOS_P2P_CloseConnection(
     if (Options->SocketId) {
         PeerConnection* conn = find_connection(state, Options->RemoteUserId, Options->SocketId);
         if (conn) {
-            // TODO: Send CLOSE message
-            conn->state = CONN_STATE_CLOSED;
-            conn->valid = false;
-            state->connection_count--;
+            p2p_close_connection(state, conn);
             EOS_LOG_DEBUG("P2P: Closed connection to peer on socket %s", Options->SocketId->SocketName);
         }
     } else {
         // Close all connections to this peer
-        for (int i = 0; i < MAX_CONNECTIONS; i++) {
-            PeerConnection* conn = &state->connections[i];
-            if (!conn->valid) continue;
-            if (!product_user_id_equal(conn->peer_id, Options->RemoteUserId)) continue;
-
-            // TODO: Send CLOSE message
-            conn->state = CONN_STATE_CLOSED;
-            conn->valid = false;
-            state->connection_count--;
+        char hex[33];
+        product_user_id_to_string(Options->RemoteUserId, hex, sizeof(hex));
+        PeerConnection* conn = find_peer_connections(state, hex);
+        while (conn) {
+            PeerConnection* next = next_peer_connection(state, conn);
+            p2p_close_connection(state, conn);
+            conn = next;
         }
         EOS_LOG_DEBUG("P2P: Closed all connections to peer");
     }
@@ -1279,10 +3430,7 @@ EOS_EResult EOS_P2P_CloseConnections(
         if (!conn->valid) continue;
         if (!socket_id_equal(&conn->socket_id, Options->SocketId)) continue;
 
-        // TODO: Send CLOSE message
-        conn->state = CONN_STATE_CLOSED;
-        conn->valid = false;
-        state->connection_count--;
+        p2p_close_connection(state, conn);
     }
 
     EOS_LOG_DEBUG("P2P: Closed all connections on socket %s", Options->SocketId->SocketName);
@@ -1451,8 +3599,11 @@ EOS_EResult EOS_P2P_SetPacketQueueSize(
         return EOS_InvalidParameters;
     }
 
+    // Packets already queued are kept even if they now exceed a smaller
+    // limit; new ones are refused until the queue drains below it.
     state->incoming_queue_max_bytes = Options->IncomingPacketQueueMaxSizeBytes;
     state->outgoing_queue_max_bytes = Options->OutgoingPacketQueueMaxSizeBytes;
+    state->incoming_queue_full = false;
     EOS_LOG_DEBUG("P2P: Set queue sizes - incoming: %llu, outgoing: %llu",
               (unsigned long long)state->incoming_queue_max_bytes,
               (unsigned long long)state->outgoing_queue_max_bytes);
@@ -1567,43 +3718,394 @@ EOS_EResult EOS_P2P_ClearPacketQueue(
     // Clear packets matching filters
     if (Options->RemoteUserId) {
         // Clear packets for specific remote user
-        for (int i = 0; i < MAX_RECV_QUEUE; i++) {
-            ReceivedPacket* pkt = &state->recv_queue[i];
-            if (!pkt->valid) continue;
+        int idx = state->recv_first;
+        while (idx != P2P_NO_SLOT) {
+            ReceivedPacket* pkt = &state->recv_queue[idx];
+            idx = pkt->next;
             if (!product_user_id_equal(pkt->sender, Options->RemoteUserId)) continue;
             if (Options->SocketId && !socket_id_equal(&pkt->socket_id, Options->SocketId)) continue;
 
-            pkt->valid = false;
-            state->incoming_queue_current_bytes -= pkt->size;
+            recv_queue_remove(state, pkt);
         }
 
-        for (int i = 0; i < MAX_SEND_QUEUE; i++) {
-            PendingPacket* pkt = &state->send_queue[i];
-            if (!pkt->valid) continue;
-            if (!product_user_id_equal(pkt->target, Options->RemoteUserId)) continue;
-            if (Options->SocketId && !socket_id_equal(&pkt->socket_id, Options->SocketId)) continue;
-
-            pkt->valid = false;
-            state->outgoing_queue_current_bytes -= pkt->size;
+        char hex[33];
+        product_user_id_to_string(Options->RemoteUserId, hex, sizeof(hex));
+        for (PeerConnection* conn = find_peer_connections(state, hex); conn;
+             conn = next_peer_connection(state, conn)) {
+            if (Options->SocketId && !socket_id_equal(&conn->socket_id, Options->SocketId)) continue;
+            drop_queued_packets(state, conn);
         }
     } else {
-        // Clear all packets
-        for (int i = 0; i < MAX_RECV_QUEUE; i++) {
-            state->recv_queue[i].valid = false;
+        // Clear all packets. Packets lent out by EOSLAN_P2P_PeekPacket are
+        // no longer queued and stay valid until they are released.
+        while (state->recv_first != P2P_NO_SLOT) {
+            recv_queue_remove(state, &state->recv_queue[state->recv_first]);
         }
-        for (int i = 0; i < MAX_SEND_QUEUE; i++) {
-            state->send_queue[i].valid = false;
+        for (int i = 0; i < MAX_CONNECTIONS; i++) {
+            PeerConnection* conn = &state->connections[i];
+            if (conn->valid) drop_queued_packets(state, conn);
         }
-        state->recv_count = 0;
-        state->send_count = 0;
-        state->recv_head = 0;
-        state->recv_tail = 0;
-        state->send_head = 0;
-        state->send_tail = 0;
-        state->incoming_queue_current_bytes = 0;
-        state->outgoing_queue_current_bytes = 0;
     }
 
     EOS_LOG_DEBUG("P2P: Cleared packet queues");
     return EOS_Success;
 }
+
+//
+// EOS-LAN extensions (include/eoslan/eoslan_p2p.h)
+//
+
+// Helper: Connections the stats functions report on (the game's own, while
+// they are being opened or are open)
+static bool is_reported_connection(const PeerConnection* conn) {
+    if (!conn->valid || is_transport_connection(conn)) return false;
+    return conn->state == CONN_STATE_REQUESTING || conn->state == CONN_STATE_PENDING ||
+           conn->state == CONN_STATE_ESTABLISHED;
+}
+
+// Helper: Size of the EOSLAN_P2P_ConnectionStats the caller allocated. The
+// struct has only grown at the end: version 2 added the FEC counters and
+// version 3 the compression ones. Anything unrecognised (callers from before
+// ApiVersion was an input) gets the version 1 layout, which always fits.
+static size_t connection_stats_size(int32_t version) {
+    switch (version) {
+        case 3: return sizeof(EOSLAN_P2P_ConnectionStats);
+        case 2: return offsetof(EOSLAN_P2P_ConnectionStats, bCompressing);
+        default: return offsetof(EOSLAN_P2P_ConnectionStats, FecParityPacketsSent);
+    }
+}
+
+// Helper: Fill EOSLAN_P2P_ConnectionStats for one connection, writing only
+// the fields of the version in out->ApiVersion
+static void fill_connection_stats(PeerConnection* conn, EOSLAN_P2P_ConnectionStats* caller_out) {
+    int32_t version = caller_out->ApiVersion;
+    if (version < 1 || version > EOSLAN_P2P_CONNECTIONSTATS_API_LATEST) version = 1;
+    EOSLAN_P2P_ConnectionStats stats;
+    EOSLAN_P2P_ConnectionStats* out = &stats;
+    uint64_t now = get_time_ms();
+    memset(out, 0, sizeof(*out));
+    out->ApiVersion = version;
+    out->RemoteUserId = conn->peer_id;
+    copy_socket_id(&out->SocketId, &conn->socket_id);
+    out->bEstablished = conn->state == CONN_STATE_ESTABLISHED ? EOS_TRUE : EOS_FALSE;
+    out->bInterrupted = conn->interrupted ? EOS_TRUE : EOS_FALSE;
+
+    // Keepalive samples first; a busy connection never PINGs, so fall back
+    // to what the reliability engine measured from its ACKs.
+    if (conn->srtt_ms != 0) {
+        out->RoundTripTimeMs = conn->srtt_ms;
+        out->JitterMs = conn->rttvar_ms;
+    } else if (conn->rel && conn->rel->have_rtt_sample) {
+        out->RoundTripTimeMs = conn->rel->srtt_ms;
+        out->JitterMs = conn->rel->rttvar_ms;
+    }
+    out->LossPermille = conn->loss_permille;
+    uint64_t silent = now > conn->last_activity ? now - conn->last_activity : 0;
+    out->MillisecondsSinceLastReceive = silent > UINT32_MAX ? UINT32_MAX : (uint32_t)silent;
+
+    out->PacketsSent = conn->packets_sent;
+    out->BytesSent = conn->bytes_sent;
+    out->PacketsReceived = conn->packets_received;
+    out->BytesReceived = conn->bytes_received;
+    if (conn->rel) {
+        out->Retransmissions = conn->rel->retransmissions;
+        out->ReliablePacketsInFlight = (uint32_t)conn->rel->in_flight;
+    }
+    out->QueuedPacketCount = (uint32_t)conn->send_count;
+    out->QueuedBytes = conn->send_bytes;
+    if (conn->fec) {
+        out->FecParityPacketsSent = conn->fec->parity_sent;
+        out->FecPacketsRecovered = conn->fec->recovered;
+    }
+    out->bCompressing = conn->peer_decompresses ? EOS_TRUE : EOS_FALSE;
+    out->PacketsCompressed = conn->packets_compressed;
+    out->PacketsStoredRaw = conn->packets_stored_raw;
+    out->CompressionInputBytes = conn->compress_in_bytes;
+    out->CompressionOutputBytes = conn->compress_out_bytes;
+    out->CompressMicroseconds = conn->compress_us;
+    out->PacketsDecompressed = conn->packets_decompressed;
+    out->DecompressMicroseconds = conn->decompress_us;
+    memcpy(caller_out, out, connection_stats_size(version));
+}
+
+EOS_EResult EOSLAN_P2P_GetConnectionStats(
+    EOS_HP2P Handle,
+    const EOSLAN_P2P_GetConnectionStatsOptions* Options,
+    EOSLAN_P2P_ConnectionStats* OutStats
+) {
+    P2PState* state = (P2PState*)Handle;
+    if (!state || state->magic != P2P_MAGIC) {
+        return EOS_InvalidParameters;
+    }
+
+    if (!Options || !OutStats || !Options->RemoteUserId || !Options->SocketId) {
+        return EOS_InvalidParameters;
+    }
+
+    if (Options->ApiVersion != EOSLAN_P2P_GETCONNECTIONSTATS_API_LATEST) {
+        return EOS_InvalidParameters;
+    }
+
+    PeerConnection* conn = find_connection(state, Options->RemoteUserId, Options->SocketId);
+    if (!conn || !is_reported_connection(conn)) {
+        return EOS_NotFound;
+    }
+
+    fill_connection_stats(conn, OutStats);
+    return EOS_Success;
+}
+
+uint32_t EOSLAN_P2P_GetConnectionStatsCount(EOS_HP2P Handle) {
+    P2PState* state = (P2PState*)Handle;
+    if (!state || state->magic != P2P_MAGIC) return 0;
+
+    uint32_t count = 0;
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        if (is_reported_connection(&state->connections[i])) count++;
+    }
+    return count;
+}
+
+EOS_EResult EOSLAN_P2P_GetConnectionStatsByIndex(
+    EOS_HP2P Handle,
+    uint32_t Index,
+    EOSLAN_P2P_ConnectionStats* OutStats
+) {
+    P2PState* state = (P2PState*)Handle;
+    if (!state || state->magic != P2P_MAGIC || !OutStats) {
+        return EOS_InvalidParameters;
+    }
+
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        PeerConnection* conn = &state->connections[i];
+        if (!is_reported_connection(conn)) continue;
+        if (Index-- == 0) {
+            fill_connection_stats(conn, OutStats);
+            return EOS_Success;
+        }
+    }
+    return EOS_NotFound;
+}
+
+EOS_EResult EOSLAN_P2P_SendPacketToGroup(
+    EOS_HP2P Handle,
+    const EOSLAN_P2P_SendPacketToGroupOptions* Options
+) {
+    P2PState* state = (P2PState*)Handle;
+    if (!state || state->magic != P2P_MAGIC || !Options) {
+        return EOS_InvalidParameters;
+    }
+    if (!Options->LocalUserId || !Options->GroupId || !Options->SocketId || !Options->Data) {
+        return EOS_InvalidParameters;
+    }
+    if (Options->DataLengthBytes > EOS_P2P_MAX_PACKET_SIZE) {
+        return EOS_LimitExceeded;
+    }
+
+    P2PGroup* group = find_group(state, Options->GroupId);
+    if (!group) return EOS_NotFound;
+    uint8_t bit = group_bit(state, group);
+    bool reliable = (Options->Reliability != EOS_PR_UnreliableUnordered);
+
+    // Members are the peers in the group (GROUP_JOINED/GROUP_MEMBER) with an
+    // established connection on the socket. Those that confirmed they hear
+    // our multicast share one datagram; everyone else, and all reliable
+    // traffic, takes the unicast path.
+    EOS_P2P_SendPacketOptions unicast;
+    memset(&unicast, 0, sizeof(unicast));
+    unicast.ApiVersion = EOS_P2P_SENDPACKET_API_LATEST;
+    unicast.LocalUserId = Options->LocalUserId;
+    unicast.SocketId = Options->SocketId;
+    unicast.Channel = Options->Channel;
+    unicast.DataLengthBytes = Options->DataLengthBytes;
+    unicast.Data = Options->Data;
+    unicast.Reliability = Options->Reliability;
+    unicast.bDisableAutoAcceptConnection = EOS_TRUE;
+
+    EOS_EResult result = EOS_Success;
+    int members = 0;
+    int multicast_members = 0;
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        PeerConnection* conn = &state->connections[i];
+        if (!conn->valid || conn->state != CONN_STATE_ESTABLISHED) continue;
+        if (!socket_id_equal(&conn->socket_id, Options->SocketId)) continue;
+        if (!(conn->group_member & bit)) continue;
+        members++;
+
+        if (!reliable && group->joined && (conn->group_confirmed & bit)) {
+            multicast_members++;
+            conn->packets_sent++;
+            conn->bytes_sent += Options->DataLengthBytes;
+            continue;
+        }
+        unicast.RemoteUserId = conn->peer_id;
+        EOS_EResult r = EOS_P2P_SendPacket(Handle, &unicast);
+        if (r != EOS_Success) result = r;
+    }
+    if (members == 0) return EOS_NoConnection;
+
+    if (multicast_members > 0) {
+        p2p_send_to_group_address(state, group, MSG_MCAST, Options->SocketId->SocketName,
+                                  Options->Channel, (const uint8_t*)Options->Data,
+                                  Options->DataLengthBytes);
+        EOS_LOG_DEBUG("P2P: multicast %u bytes to %d of %d members of %s (ch %u)",
+                      Options->DataLengthBytes, multicast_members, members, group->id,
+                      (unsigned)Options->Channel);
+    }
+    return result;
+}
+
+EOS_EResult EOSLAN_P2P_SendPackets(
+    EOS_HP2P Handle,
+    const EOSLAN_P2P_SendPacketsOptions* Options,
+    uint32_t* OutSentCount
+) {
+    P2PState* state = (P2PState*)Handle;
+    if (OutSentCount) *OutSentCount = 0;
+    if (!state || state->magic != P2P_MAGIC || !Options) {
+        return EOS_InvalidParameters;
+    }
+    if (!Options->LocalUserId || !Options->SocketId ||
+        (Options->PacketCount > 0 && !Options->Packets)) {
+        return EOS_InvalidParameters;
+    }
+
+    EOS_P2P_SendPacketOptions send;
+    memset(&send, 0, sizeof(send));
+    send.ApiVersion = EOS_P2P_SENDPACKET_API_LATEST;
+    send.LocalUserId = Options->LocalUserId;
+    send.SocketId = Options->SocketId;
+    send.bAllowDelayedDelivery = Options->bAllowDelayedDelivery;
+    send.bDisableAutoAcceptConnection = Options->bDisableAutoAcceptConnection;
+
+    // A netdriver sends runs of packets to the same peer, so the connection
+    // found for one is reused while the next names the same handle. The
+    // token check catches a slot that was released and reused meanwhile.
+    PeerConnection* last_conn = NULL;
+    EOS_ProductUserId last_peer = NULL;
+    uint32_t last_token = 0;
+
+    EOS_EResult result = EOS_Success;
+    uint32_t sent = 0;
+    for (uint32_t i = 0; i < Options->PacketCount; i++) {
+        EOSLAN_P2P_OutgoingPacket* pkt = &Options->Packets[i];
+        if (!pkt->RemoteUserId || !pkt->Data) {
+            pkt->Result = EOS_InvalidParameters;
+        } else if (pkt->DataLengthBytes > EOS_P2P_MAX_PACKET_SIZE) {
+            pkt->Result = EOS_LimitExceeded;
+        } else {
+            PeerConnection* conn = NULL;
+            if (last_conn && pkt->RemoteUserId == last_peer && last_conn->valid &&
+                last_conn->local_token == last_token) {
+                conn = last_conn;
+            }
+            send.RemoteUserId = pkt->RemoteUserId;
+            send.Channel = pkt->Channel;
+            send.Reliability = pkt->Reliability;
+            send.DataLengthBytes = pkt->DataLengthBytes;
+            send.Data = pkt->Data;
+            pkt->Result = p2p_send_packet(state, &send, &conn);
+
+            last_conn = conn;
+            last_peer = pkt->RemoteUserId;
+            last_token = conn ? conn->local_token : 0;
+        }
+
+        if (pkt->Result == EOS_Success) sent++;
+        else if (result == EOS_Success) result = pkt->Result;
+    }
+
+    if (OutSentCount) *OutSentCount = sent;
+    return result;
+}
+
+EOS_EResult EOSLAN_P2P_ReceivePackets(
+    EOS_HP2P Handle,
+    const EOSLAN_P2P_ReceivePacketsOptions* Options,
+    EOSLAN_P2P_IncomingPacket* OutPackets,
+    void* OutData,
+    uint32_t* OutPacketCount
+) {
+    P2PState* state = (P2PState*)Handle;
+    if (OutPacketCount) *OutPacketCount = 0;
+    if (!state || state->magic != P2P_MAGIC || !Options) {
+        return EOS_InvalidParameters;
+    }
+    if (!Options->LocalUserId || !OutPackets || !OutData || !OutPacketCount ||
+        Options->MaxPackets == 0) {
+        return EOS_InvalidParameters;
+    }
+
+    // Payloads go back to back into OutData until the next one no longer
+    // fits; only the first may be cut short, so the queue always drains.
+    uint8_t* out = (uint8_t*)OutData;
+    uint32_t used = 0;
+    uint32_t count = 0;
+    while (count < Options->MaxPackets) {
+        ReceivedPacket* pkt = recv_queue_peek(state, Options->RequestedChannel);
+        if (!pkt) break;
+        uint32_t room = Options->MaxDataSizeBytes - used;
+        if (count > 0 && pkt->size > room) break;
+
+        EOSLAN_P2P_IncomingPacket* in = &OutPackets[count++];
+        in->PeerId = pkt->sender_handle;
+        in->Data = out + used;
+        in->DataLengthBytes = recv_queue_take(state, pkt, &in->SocketId, &in->Channel,
+                                              out + used, room);
+        used += in->DataLengthBytes;
+    }
+
+    *OutPacketCount = count;
+    return count > 0 ? EOS_Success : EOS_NotFound;
+}
+
+EOS_EResult EOSLAN_P2P_PeekPacket(
+    EOS_HP2P Handle,
+    const EOSLAN_P2P_PeekPacketOptions* Options,
+    EOSLAN_P2P_BorrowedPacket* OutPacket
+) {
+    P2PState* state = (P2PState*)Handle;
+    if (!state || state->magic != P2P_MAGIC || !Options || !OutPacket) {
+        return EOS_InvalidParameters;
+    }
+    if (!Options->LocalUserId) {
+        return EOS_InvalidParameters;
+    }
+
+    ReceivedPacket* pkt = recv_queue_peek(state, Options->RequestedChannel);
+    if (!pkt) return EOS_NotFound;
+
+    // The packet leaves the lists but keeps its slot and pool block, so the
+    // payload stays where it is until ReleasePacket.
+    recv_queue_unlink(state, pkt);
+    if (++state->next_borrow_id == 0) state->next_borrow_id = 1;
+    pkt->borrow_id = state->next_borrow_id;
+
+    OutPacket->PeerId = pkt->sender_handle;
+    copy_socket_id(&OutPacket->SocketId, &pkt->socket_id);
+    OutPacket->Channel = pkt->channel;
+    OutPacket->DataLengthBytes = pkt->size;
+    OutPacket->Data = pkt->data;
+    OutPacket->ArrivalTimeMicroseconds = pkt->arrival_us;
+    OutPacket->PacketHandle = ((uint64_t)pkt->borrow_id << 32) | (uint64_t)(pkt - state->recv_queue);
+    return EOS_Success;
+}
+
+EOS_EResult EOSLAN_P2P_ReleasePacket(
+    EOS_HP2P Handle,
+    const EOSLAN_P2P_BorrowedPacket* Packet
+) {
+    P2PState* state = (P2PState*)Handle;
+    if (!state || state->magic != P2P_MAGIC || !Packet) {
+        return EOS_InvalidParameters;
+    }
+
+    uint32_t idx = (uint32_t)(Packet->PacketHandle & 0xFFFFFFFFu);
+    uint32_t borrow_id = (uint32_t)(Packet->PacketHandle >> 32);
+    if (idx >= MAX_RECV_QUEUE || borrow_id == 0) return EOS_InvalidParameters;
+
+    ReceivedPacket* pkt = &state->recv_queue[idx];
+    if (!pkt->valid || pkt->borrow_id != borrow_id) return EOS_NotFound;
+    recv_queue_free(state, pkt);
+    return EOS_Success;
+}
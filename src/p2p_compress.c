@@ -0,0 +1,258 @@
+// P2P payload compression: a byte-oriented LZ77 codec (in the style of LZ4)
+// with an optional preset dictionary. The dictionary sits in front of every
+// packet in one window, so matches can point back into it; with replicated
+// game state most of a packet is found there. Its hash table is built once,
+// and each packet starts from a copy. Pure bookkeeping - p2p.c decides what
+// to compress and owns the wire.
+//
+// Compressed layout: sequences of
+//   token(1): literal count (high nibble) and match length - 4 (low nibble),
+//             15 meaning "more follows" as bytes of 255 ended by one < 255
+//   [literal count extension] literals
+//   offset(2, little-endian) [match length extension]
+// The last sequence has literals only and ends the input.
+
+#include "internal/p2p_internal.h"
+#include "internal/logging.h"
+#include "lan_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_SIZE (1u << P2P_LZ_HASH_BITS)
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t lz_hash(const uint8_t* p) {
+    return (read32(p) * 2654435761u) >> (32 - P2P_LZ_HASH_BITS);
+}
+
+P2PCompressor* p2p_compress_create(const uint8_t* dict, uint32_t dict_len) {
+    P2PCompressor* c = calloc(1, sizeof(P2PCompressor));
+    if (!c) {
+        EOS_LOG_ERROR("P2P: failed to allocate compressor");
+        return NULL;
+    }
+    // Only the tail of an oversized dictionary is kept; the data nearest
+    // the packet is what the window can reach.
+    if (dict && dict_len > P2P_DICT_MAX) {
+        dict += dict_len - P2P_DICT_MAX;
+        dict_len = P2P_DICT_MAX;
+    }
+    if (dict && dict_len > 0) {
+        memcpy(c->window, dict, dict_len);
+        c->dict_len = dict_len;
+        c->dict_id = crc32(dict, dict_len);
+        if (c->dict_id == 0) c->dict_id = 1;  // 0 means "no dictionary" on the wire
+        for (uint32_t i = 0; i + LZ_MIN_MATCH <= dict_len; i++) {
+            c->dict_table[lz_hash(c->window + i)] = (uint16_t)i;
+        }
+    }
+    return c;
+}
+
+P2PCompressor* p2p_compress_load(const char* dict_path) {
+    FILE* f = fopen(dict_path, "rb");
+    if (!f) {
+        EOS_LOG_ERROR("P2P: can't open compression dictionary %s", dict_path);
+        return NULL;
+    }
+    uint8_t* dict = malloc(P2P_DICT_MAX);
+    uint32_t len = 0;
+    if (dict) {
+        // Keep the last P2P_DICT_MAX bytes of the file
+        size_t n;
+        uint8_t chunk[4096];
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            if (len + n > P2P_DICT_MAX) {
+                uint32_t drop = (uint32_t)(len + n - P2P_DICT_MAX);
+                memmove(dict, dict + drop, len - drop);
+                len -= drop;
+            }
+            memcpy(dict + len, chunk, n);
+            len += (uint32_t)n;
+        }
+    }
+    fclose(f);
+    if (!dict) return NULL;
+
+    P2PCompressor* c = p2p_compress_create(dict, len);
+    free(dict);
+    if (c) {
+        EOS_LOG_INFO("P2P: compression dictionary %s (%u bytes, id %08x)",
+                     dict_path, (unsigned)c->dict_len, (unsigned)c->dict_id);
+    }
+    return c;
+}
+
+void p2p_compress_destroy(P2PCompressor* c) {
+    if (!c) return;
+    free(c->samples);
+    free(c);
+}
+
+// Append a length extension (the part of n that did not fit in a nibble).
+static bool put_length(uint8_t** op, const uint8_t* end, uint32_t n) {
+    uint8_t* p = *op;
+    while (n >= 255) {
+        if (p >= end) return false;
+        *p++ = 255;
+        n -= 255;
+    }
+    if (p >= end) return false;
+    *p++ = (uint8_t)n;
+    *op = p;
+    return true;
+}
+
+// Emit one sequence; offset 0 marks the last (literals only).
+static bool put_sequence(uint8_t** op, const uint8_t* end, const uint8_t* literals,
+                         uint32_t literal_len, uint32_t offset, uint32_t match_len) {
+    uint8_t* p = *op;
+    if (p >= end) return false;
+    uint32_t ml = offset ? match_len - LZ_MIN_MATCH : 0;
+    uint8_t* token = p++;
+    *token = (uint8_t)(((literal_len < 15 ? literal_len : 15) << 4) | (ml < 15 ? ml : 15));
+    if (literal_len >= 15 && !put_length(&p, end, literal_len - 15)) return false;
+    if ((uint32_t)(end - p) < literal_len) return false;
+    memcpy(p, literals, literal_len);
+    p += literal_len;
+    if (offset) {
+        if (end - p < 2) return false;
+        *p++ = (uint8_t)offset;
+        *p++ = (uint8_t)(offset >> 8);
+        if (ml >= 15 && !put_length(&p, end, ml - 15)) return false;
+    }
+    *op = p;
+    return true;
+}
+
+uint32_t p2p_compress(P2PCompressor* c, const uint8_t* src, uint32_t len,
+                      uint8_t* dst, uint32_t capacity) {
+    if (!c || len > EOS_P2P_MAX_PACKET_SIZE) return 0;
+
+    uint8_t* w = c->window;
+    uint32_t base = c->dict_len;
+    uint32_t end = base + len;
+    memcpy(w + base, src, len);
+    memcpy(c->table, c->dict_table, sizeof(c->table));
+
+    uint8_t* op = dst;
+    const uint8_t* op_end = dst + capacity;
+    uint32_t ip = base;
+    uint32_t anchor = base;
+    while (ip + LZ_MIN_MATCH <= end) {
+        uint32_t h = lz_hash(w + ip);
+        uint32_t candidate = c->table[h];
+        c->table[h] = (uint16_t)ip;
+        if (candidate >= ip || ip - candidate > LZ_MAX_OFFSET ||
+            read32(w + candidate) != read32(w + ip)) {
+            ip++;
+            continue;
+        }
+
+        uint32_t match_len = LZ_MIN_MATCH;
+        while (ip + match_len < end && w[candidate + match_len] == w[ip + match_len]) match_len++;
+        if (!put_sequence(&op, op_end, w + anchor, ip - anchor, ip - candidate, match_len)) return 0;
+        ip += match_len;
+        anchor = ip;
+    }
+    if (!put_sequence(&op, op_end, w + anchor, end - anchor, 0, 0)) return 0;
+    return (uint32_t)(op - dst);
+}
+
+// Read a length extension onto *n.
+static bool get_length(const uint8_t** ip, const uint8_t* end, uint32_t* n) {
+    const uint8_t* p = *ip;
+    uint8_t b;
+    do {
+        if (p >= end) return false;
+        b = *p++;
+        *n += b;
+        if (*n > EOS_P2P_MAX_PACKET_SIZE) return false;
+    } while (b == 255);
+    *ip = p;
+    return true;
+}
+
+int p2p_decompress(P2PCompressor* c, const uint8_t* src, uint32_t len,
+                   uint8_t* dst, uint32_t capacity) {
+    if (!c) return -1;
+    if (capacity > EOS_P2P_MAX_PACKET_SIZE) capacity = EOS_P2P_MAX_PACKET_SIZE;
+
+    // Output goes into the window after the dictionary, where matches can
+    // reach both.
+    uint8_t* w = c->window;
+    uint32_t op = c->dict_len;
+    uint32_t op_end = c->dict_len + capacity;
+    const uint8_t* ip = src;
+    const uint8_t* ip_end = src + len;
+    for (;;) {
+        if (ip >= ip_end) return -1;
+        uint8_t token = *ip++;
+        uint32_t literal_len = token >> 4;
+        if (literal_len == 15 && !get_length(&ip, ip_end, &literal_len)) return -1;
+        if ((uint32_t)(ip_end - ip) < literal_len || op + literal_len > op_end) return -1;
+        memcpy(w + op, ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+        if (ip == ip_end) break;  // last sequence
+
+        if (ip_end - ip < 2) return -1;
+        uint32_t offset = (uint32_t)ip[0] | ((uint32_t)ip[1] << 8);
+        ip += 2;
+        uint32_t match_len = token & 15;
+        if (match_len == 15 && !get_length(&ip, ip_end, &match_len)) return -1;
+        match_len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || op + match_len > op_end) return -1;
+        // Byte by byte: a match may overlap the bytes it produces.
+        const uint8_t* from = w + op - offset;
+        for (uint32_t i = 0; i < match_len; i++) w[op + i] = from[i];
+        op += match_len;
+    }
+
+    uint32_t out_len = op - c->dict_len;
+    memcpy(dst, w + c->dict_len, out_len);
+    return (int)out_len;
+}
+
+void p2p_compress_sample(P2PCompressor* c, const uint8_t* data, uint32_t len) {
+    if (!c || len == 0) return;
+    if (c->sample_skip++ % P2P_DICT_SAMPLE_EVERY != 0) return;
+    if (!c->samples) {
+        c->samples = malloc(P2P_DICT_MAX);
+        if (!c->samples) return;
+    }
+    // Ring of the most recent samples
+    for (uint32_t i = 0; i < len; i++) {
+        c->samples[c->sample_pos] = data[i];
+        c->sample_pos = (c->sample_pos + 1) % P2P_DICT_MAX;
+    }
+    c->sample_bytes += len;
+}
+
+bool p2p_compress_write_dictionary(const P2PCompressor* c, const char* path) {
+    if (!c || !c->samples || c->sample_bytes == 0) return false;
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        EOS_LOG_ERROR("P2P: can't write compression dictionary %s", path);
+        return false;
+    }
+    // Oldest first, so the freshest traffic ends up nearest the packet
+    uint32_t len = c->sample_bytes < P2P_DICT_MAX ? (uint32_t)c->sample_bytes : P2P_DICT_MAX;
+    uint32_t start = c->sample_bytes < P2P_DICT_MAX ? 0 : c->sample_pos;
+    uint32_t first = P2P_DICT_MAX - start < len ? P2P_DICT_MAX - start : len;
+    bool ok = fwrite(c->samples + start, 1, first, f) == first &&
+              fwrite(c->samples, 1, len - first, f) == len - first;
+    ok = fclose(f) == 0 && ok;
+    if (ok) {
+        EOS_LOG_INFO("P2P: wrote %u-byte compression dictionary to %s", (unsigned)len, path);
+    }
+    return ok;
+}
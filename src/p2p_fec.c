@@ -0,0 +1,163 @@
+// P2P forward error correction for unreliable channels: XOR parity over
+// groups of up to P2P_FEC_MAX_K packets. Each packet of a group is folded
+// into a running XOR of its record (channel, length, payload); the parity
+// packet that closes the group carries that XOR, so a receiver that is
+// missing exactly one packet of the group can rebuild it without a round
+// trip. Pure bookkeeping - p2p.c owns the wire and the receive queue.
+//
+// MSG_FEC payload layouts:
+//   data:   group(2) index(1) payload
+//   parity: group(2) P2P_FEC_PARITY(1) count(1) xor of the group's records
+
+#include "internal/p2p_internal.h"
+#include "internal/logging.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+FecState* p2p_fec_create(void) {
+    FecState* fs = calloc(1, sizeof(FecState));
+    if (!fs) {
+        EOS_LOG_ERROR("P2P: failed to allocate FEC state");
+    }
+    return fs;
+}
+
+void p2p_fec_destroy(FecState* fs) {
+    free(fs);
+}
+
+// XOR one record - channel(1) len(2) payload - into acc, growing *acc_len
+// to the longest record seen (shorter records count as zero-padded).
+static void fold_record(uint8_t* acc, uint16_t* acc_len, uint8_t channel,
+                        const uint8_t* data, uint32_t size) {
+    acc[0] ^= channel;
+    acc[1] ^= (uint8_t)(size >> 8);
+    acc[2] ^= (uint8_t)size;
+    for (uint32_t i = 0; i < size; i++) {
+        acc[3 + i] ^= data[i];
+    }
+    if (3 + size > *acc_len) *acc_len = (uint16_t)(3 + size);
+}
+
+static int popcount8(uint8_t v) {
+    int n = 0;
+    for (; v; v &= (uint8_t)(v - 1)) n++;
+    return n;
+}
+
+uint32_t p2p_fec_wrap(FecState* fs, uint8_t channel, const uint8_t* data, uint32_t size,
+                      uint8_t* out, uint64_t now) {
+    if (fs->send_count == 0) fs->send_started = now;
+
+    out[0] = (uint8_t)(fs->send_group >> 8);
+    out[1] = (uint8_t)fs->send_group;
+    out[2] = fs->send_count;
+    if (size > 0) memcpy(out + P2P_FEC_HEADER, data, size);
+
+    fold_record(fs->send_acc, &fs->send_len, channel, data, size);
+    fs->send_count++;
+    return P2P_FEC_HEADER + size;
+}
+
+uint32_t p2p_fec_parity(FecState* fs, uint8_t* out) {
+    if (fs->send_count == 0) return 0;
+
+    out[0] = (uint8_t)(fs->send_group >> 8);
+    out[1] = (uint8_t)fs->send_group;
+    out[2] = P2P_FEC_PARITY;
+    out[3] = fs->send_count;
+    memcpy(out + P2P_FEC_HEADER + 1, fs->send_acc, fs->send_len);
+    uint32_t len = P2P_FEC_HEADER + 1 + fs->send_len;
+
+    memset(fs->send_acc, 0, fs->send_len);
+    fs->send_len = 0;
+    fs->send_count = 0;
+    fs->send_group++;
+    fs->parity_sent++;
+    return len;
+}
+
+// The receive slot for a group, (re)started when a newer group lands on
+// it. NULL when the group is older than the window.
+static FecRecvGroup* recv_group(FecState* fs, uint16_t group) {
+    FecRecvGroup* g = &fs->recv[group % P2P_FEC_WINDOW];
+    if (g->valid && g->group == group) return g;
+    if (g->valid && (int16_t)(group - g->group) < 0) return NULL;
+
+    memset(g->acc, 0, g->len);
+    g->group = group;
+    g->received = 0;
+    g->count = 0;
+    g->len = 0;
+    g->done = false;
+    g->valid = true;
+    return g;
+}
+
+// Rebuild the one packet a group is missing once its parity is in.
+static void try_rebuild(FecState* fs, FecRecvGroup* g, FecPacket* rebuilt) {
+    if (g->done || g->count == 0) return;
+    int have = popcount8(g->received);
+    if (have >= g->count) {
+        g->done = true;
+        return;
+    }
+    if (have != g->count - 1) return;
+
+    g->done = true;
+    uint32_t size = ((uint32_t)g->acc[1] << 8) | g->acc[2];
+    if (size > EOS_P2P_MAX_PACKET_SIZE || 3 + size > g->len) return;  // corrupt parity
+
+    g->received = (uint8_t)((1u << g->count) - 1);  // a late copy of it is a duplicate
+    rebuilt->valid = true;
+    rebuilt->channel = g->acc[0];
+    rebuilt->data = g->acc + 3;
+    rebuilt->len = size;
+    fs->recovered++;
+}
+
+void p2p_fec_receive(FecState* fs, uint8_t channel, const uint8_t* msg, uint32_t len,
+                     FecPacket* out, FecPacket* rebuilt) {
+    out->valid = false;
+    rebuilt->valid = false;
+    if (!msg || len < P2P_FEC_HEADER) return;
+
+    uint16_t group = (uint16_t)((msg[0] << 8) | msg[1]);
+    uint8_t index = msg[2];
+
+    if (index == P2P_FEC_PARITY) {
+        if (len < P2P_FEC_HEADER + 1) return;
+        uint8_t count = msg[3];
+        uint32_t xor_len = len - (P2P_FEC_HEADER + 1);
+        if (count == 0 || count > P2P_FEC_MAX_K || xor_len > P2P_FEC_RECORD_MAX) return;
+
+        FecRecvGroup* g = recv_group(fs, group);
+        if (!g || g->count != 0) return;  // too old, or a repeated parity
+        const uint8_t* x = msg + P2P_FEC_HEADER + 1;
+        for (uint32_t i = 0; i < xor_len; i++) {
+            g->acc[i] ^= x[i];
+        }
+        if (xor_len > g->len) g->len = (uint16_t)xor_len;
+        g->count = count;
+        try_rebuild(fs, g, rebuilt);
+        return;
+    }
+
+    uint32_t size = len - P2P_FEC_HEADER;
+    if (index >= P2P_FEC_MAX_K || size > EOS_P2P_MAX_PACKET_SIZE) return;
+    const uint8_t* data = msg + P2P_FEC_HEADER;
+
+    FecRecvGroup* g = recv_group(fs, group);
+    if (g) {
+        if (g->received & (1u << index)) return;  // already rebuilt (or repeated)
+        g->received |= (uint8_t)(1u << index);
+        if (!g->done) fold_record(g->acc, &g->len, channel, data, size);
+        try_rebuild(fs, g, rebuilt);
+    }
+
+    out->valid = true;
+    out->channel = channel;
+    out->data = data;
+    out->len = size;
+}
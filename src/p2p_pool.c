@@ -0,0 +1,98 @@
+// P2P packet buffer pool: size-classed blocks for the payloads of queued
+// packets (receive queue and outgoing queue). Blocks are carved from slabs
+// allocated on first use; freed blocks go back on their class's free list
+// and slabs are only returned to the heap when the pool is destroyed.
+// Like the queues themselves, a pool is only touched from the thread that
+// drives its P2PState.
+
+#include "internal/p2p_internal.h"
+#include "internal/logging.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Slab header; its blocks follow it. Padded so blocks stay 16-byte aligned.
+struct P2PPoolSlab {
+    P2PPoolSlab* next;
+    uint8_t pad[16 - sizeof(P2PPoolSlab*)];
+};
+
+// Payload class rounded up so every block in a slab stays 8-byte aligned.
+static const uint32_t pool_class_sizes[P2P_POOL_CLASSES] = {
+    64, 256, (P2P_POOL_BLOCK_MAX + 7u) & ~7u, P2P_POOL_DATAGRAM
+};
+
+static int pool_class_index(uint32_t size) {
+    for (int i = 0; i < P2P_POOL_CLASSES; i++) {
+        if (size <= pool_class_sizes[i]) return i;
+    }
+    return -1;
+}
+
+void p2p_pool_init(P2PPool* pool) {
+    memset(pool, 0, sizeof(P2PPool));
+    for (int i = 0; i < P2P_POOL_CLASSES; i++) {
+        pool->classes[i].block_size = pool_class_sizes[i];
+    }
+}
+
+void p2p_pool_destroy(P2PPool* pool) {
+    for (int i = 0; i < P2P_POOL_CLASSES; i++) {
+        P2PPoolClass* cls = &pool->classes[i];
+        P2PPoolSlab* slab = cls->slabs;
+        while (slab) {
+            P2PPoolSlab* next = slab->next;
+            free(slab);
+            slab = next;
+        }
+        cls->slabs = NULL;
+        cls->free_list = NULL;
+        cls->slab_count = 0;
+        cls->blocks_in_use = 0;
+    }
+}
+
+// Add a slab to a class and chain its blocks onto the free list.
+static bool pool_grow(P2PPoolClass* cls) {
+    uint32_t count = (P2P_POOL_SLAB_BYTES - (uint32_t)sizeof(P2PPoolSlab)) / cls->block_size;
+    P2PPoolSlab* slab = malloc(sizeof(P2PPoolSlab) + (size_t)count * cls->block_size);
+    if (!slab) {
+        EOS_LOG_ERROR("P2P: failed to allocate %u-byte packet buffer slab", (unsigned)cls->block_size);
+        return false;
+    }
+    slab->next = cls->slabs;
+    cls->slabs = slab;
+    cls->slab_count++;
+
+    uint8_t* blocks = (uint8_t*)(slab + 1);
+    for (uint32_t i = count; i-- > 0;) {
+        void* block = blocks + (size_t)i * cls->block_size;
+        *(void**)block = cls->free_list;
+        cls->free_list = block;
+    }
+    return true;
+}
+
+uint8_t* p2p_pool_alloc(P2PPool* pool, uint32_t size) {
+    int idx = pool_class_index(size);
+    if (idx < 0) return NULL;
+
+    P2PPoolClass* cls = &pool->classes[idx];
+    if (!cls->free_list && !pool_grow(cls)) return NULL;
+
+    void* block = cls->free_list;
+    cls->free_list = *(void**)block;
+    cls->blocks_in_use++;
+    return (uint8_t*)block;
+}
+
+void p2p_pool_free(P2PPool* pool, uint8_t* block, uint32_t size) {
+    if (!block) return;
+    int idx = pool_class_index(size);
+    if (idx < 0) return;
+
+    P2PPoolClass* cls = &pool->classes[idx];
+    *(void**)block = cls->free_list;
+    cls->free_list = block;
+    cls->blocks_in_use--;
+}
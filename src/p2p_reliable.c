@@ -0,0 +1,275 @@
+// P2P reliability engine: sequence numbers, selective ACKs, RTT-based
+// retransmission and per-channel ordering for EOS_PR_ReliableUnordered /
+// EOS_PR_ReliableOrdered. Pure bookkeeping - p2p.c owns the wire and the
+// receive queue and drives these helpers from SendPacket / p2p_tick.
+
+#include "internal/p2p_internal.h"
+#include "internal/logging.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 16-bit sequence arithmetic (wrap-aware). a is "before" b when the forward
+// distance from a to b is less than half the sequence space.
+static bool seq_less(uint16_t a, uint16_t b) {
+    return a != b && (uint16_t)(b - a) < 0x8000;
+}
+
+static uint16_t seq_distance(uint16_t from, uint16_t to) {
+    return (uint16_t)(to - from);
+}
+
+ReliableState* p2p_rel_create(void) {
+    ReliableState* rs = calloc(1, sizeof(ReliableState));
+    if (!rs) {
+        EOS_LOG_ERROR("P2P: failed to allocate reliability state");
+        return NULL;
+    }
+    p2p_rel_reset(rs);
+    return rs;
+}
+
+void p2p_rel_destroy(ReliableState* rs) {
+    free(rs);
+}
+
+void p2p_rel_reset(ReliableState* rs) {
+    if (!rs) return;
+    memset(rs, 0, sizeof(ReliableState));
+    rs->rto_ms = P2P_RTO_INITIAL_MS;
+}
+
+// Start the retransmission timeout from an RTT measured elsewhere (a
+// pre-warmed handshake) instead of P2P_RTO_INITIAL_MS. The value is what the
+// first sample would give (srtt + 4 * rttvar = 3 * rtt); the first real
+// sample replaces it.
+void p2p_rel_seed_rto(ReliableState* rs, uint32_t rtt_ms) {
+    if (!rs || rs->have_rtt_sample) return;
+    uint32_t rto = 3 * rtt_ms;
+    if (rto < P2P_RTO_MIN_MS) rto = P2P_RTO_MIN_MS;
+    if (rto > P2P_RTO_MAX_MS) rto = P2P_RTO_MAX_MS;
+    rs->rto_ms = rto;
+}
+
+bool p2p_rel_can_send(const ReliableState* rs) {
+    if (!rs) return false;
+    return seq_distance(rs->oldest_unacked, rs->next_sequence) < P2P_RELIABLE_WINDOW;
+}
+
+// Assign the next sequence (and order sequence for ordered channels) and keep
+// a copy of the payload for retransmission. Caller must check can_send first.
+ReliableSendSlot* p2p_rel_track(ReliableState* rs, uint8_t channel, bool ordered,
+                                const uint8_t* data, uint32_t size, uint64_t now) {
+    if (!rs || !p2p_rel_can_send(rs)) return NULL;
+    if (size > EOS_P2P_MAX_PACKET_SIZE) return NULL;
+
+    ReliableSendSlot* slot = &rs->send_window[rs->next_sequence % P2P_RELIABLE_WINDOW];
+    memset(slot, 0, offsetof(ReliableSendSlot, data));
+    slot->in_use = true;
+    slot->sequence = rs->next_sequence++;
+    slot->channel = channel;
+    slot->ordered = ordered;
+    if (ordered) {
+        slot->order_sequence = rs->next_order_send[channel]++;
+    }
+    slot->size = size;
+    if (data && size > 0) {
+        memcpy(slot->data, data, size);
+    }
+    slot->first_sent_at = now;
+    slot->next_resend_at = now;
+    rs->in_flight++;
+    return slot;
+}
+
+// Record a (re)transmission and schedule the next one. Each retransmission
+// doubles the timeout for that packet, capped at P2P_RTO_MAX_MS.
+void p2p_rel_mark_sent(ReliableState* rs, ReliableSendSlot* slot, uint64_t now) {
+    if (!rs || !slot) return;
+    uint32_t rto = rs->rto_ms;
+    uint32_t shift = slot->transmissions < 5 ? slot->transmissions : 5;
+    rto <<= shift;
+    if (rto > P2P_RTO_MAX_MS) rto = P2P_RTO_MAX_MS;
+    if (slot->transmissions > 0) rs->retransmissions++;
+    slot->transmissions++;
+    slot->next_resend_at = now + rto;
+}
+
+// Make every in-flight packet due now, for packets that so far only rode in
+// CONNECTs: those copies followed the handshake's schedule, not ours, so the
+// backoff they built up is dropped. A sent packet keeps one transmission,
+// enough that its ACK gives no RTT sample (Karn).
+void p2p_rel_expedite(ReliableState* rs, uint64_t now) {
+    if (!rs || rs->in_flight == 0) return;
+    int span = seq_distance(rs->oldest_unacked, rs->next_sequence);
+    for (int i = 0; i < span; i++) {
+        uint16_t seq = (uint16_t)(rs->oldest_unacked + i);
+        ReliableSendSlot* slot = &rs->send_window[seq % P2P_RELIABLE_WINDOW];
+        if (!slot->in_use || slot->sequence != seq) continue;
+        if (slot->transmissions > 1) slot->transmissions = 1;
+        slot->next_resend_at = now;
+    }
+}
+
+// Iterate in-flight packets whose retransmission timer has expired. *cursor
+// starts at 0; returns NULL when the window has been walked.
+ReliableSendSlot* p2p_rel_next_due(ReliableState* rs, uint64_t now, int* cursor) {
+    if (!rs || !cursor || rs->in_flight == 0) return NULL;
+    int span = seq_distance(rs->oldest_unacked, rs->next_sequence);
+    while (*cursor < span) {
+        uint16_t seq = (uint16_t)(rs->oldest_unacked + *cursor);
+        (*cursor)++;
+        ReliableSendSlot* slot = &rs->send_window[seq % P2P_RELIABLE_WINDOW];
+        if (!slot->in_use || slot->sequence != seq) continue;
+        if (now >= slot->next_resend_at) return slot;
+    }
+    return NULL;
+}
+
+static void rel_update_rtt(ReliableState* rs, uint32_t sample_ms) {
+    if (!rs->have_rtt_sample) {
+        rs->srtt_ms = sample_ms;
+        rs->rttvar_ms = sample_ms / 2;
+        rs->have_rtt_sample = true;
+    } else {
+        uint32_t delta = (rs->srtt_ms > sample_ms) ? rs->srtt_ms - sample_ms : sample_ms - rs->srtt_ms;
+        rs->rttvar_ms = (3 * rs->rttvar_ms + delta) / 4;
+        rs->srtt_ms = (7 * rs->srtt_ms + sample_ms) / 8;
+    }
+    uint32_t rto = rs->srtt_ms + 4 * rs->rttvar_ms;
+    if (rto < P2P_RTO_MIN_MS) rto = P2P_RTO_MIN_MS;
+    if (rto > P2P_RTO_MAX_MS) rto = P2P_RTO_MAX_MS;
+    rs->rto_ms = rto;
+}
+
+static void rel_ack_slot(ReliableState* rs, ReliableSendSlot* slot, uint64_t now) {
+    // Karn: only packets that were transmitted once give an unambiguous sample.
+    if (slot->transmissions == 1) {
+        rel_update_rtt(rs, (uint32_t)(now - slot->first_sent_at));
+    }
+    slot->in_use = false;
+    if (rs->in_flight > 0) rs->in_flight--;
+}
+
+// Process a cumulative ACK plus selective bitfield: `ack` is the last sequence
+// received contiguously, bit i of `ack_bits` covers sequence ack + 1 + i.
+void p2p_rel_on_ack(ReliableState* rs, uint16_t ack, uint32_t ack_bits, uint64_t now) {
+    if (!rs || rs->in_flight == 0) return;
+
+    int span = seq_distance(rs->oldest_unacked, rs->next_sequence);
+    for (int i = 0; i < span; i++) {
+        uint16_t seq = (uint16_t)(rs->oldest_unacked + i);
+        ReliableSendSlot* slot = &rs->send_window[seq % P2P_RELIABLE_WINDOW];
+        if (!slot->in_use || slot->sequence != seq) continue;
+
+        bool acked = !seq_less(ack, seq);
+        if (!acked) {
+            uint16_t bit = (uint16_t)(seq - ack - 1);
+            acked = bit < P2P_ACK_BITS && (ack_bits & (1u << bit)) != 0;
+        }
+        if (acked) rel_ack_slot(rs, slot, now);
+    }
+
+    // Slide the window past everything acknowledged.
+    while (rs->oldest_unacked != rs->next_sequence &&
+           !rs->send_window[rs->oldest_unacked % P2P_RELIABLE_WINDOW].in_use) {
+        rs->oldest_unacked++;
+    }
+}
+
+ReliableRecvResult p2p_rel_classify(ReliableState* rs, uint16_t sequence, bool ordered,
+                                    uint8_t channel, uint16_t order_sequence) {
+    if (!rs) return REL_RECV_REJECT;
+
+    if (seq_less(sequence, rs->recv_base)) {
+        rs->ack_pending = true;  // our ACK was probably lost - repeat it
+        return REL_RECV_DUPLICATE;
+    }
+    if (seq_distance(rs->recv_base, sequence) >= P2P_RELIABLE_WINDOW) {
+        return REL_RECV_REJECT;
+    }
+    if (rs->recv_seen[sequence % P2P_RELIABLE_WINDOW]) {
+        rs->ack_pending = true;
+        return REL_RECV_DUPLICATE;
+    }
+    if (ordered && seq_less(rs->next_order_recv[channel], order_sequence)) {
+        return REL_RECV_HOLD;
+    }
+    return REL_RECV_DELIVER;
+}
+
+// Mark a sequence as received (call only once the payload is safely queued or
+// held, so a full receive queue results in a retransmission, not a loss).
+void p2p_rel_mark_received(ReliableState* rs, uint16_t sequence, bool ordered,
+                           uint8_t channel, uint16_t order_sequence) {
+    if (!rs) return;
+    rs->recv_seen[sequence % P2P_RELIABLE_WINDOW] = true;
+    rs->ack_pending = true;
+    if (ordered && !seq_less(order_sequence, rs->next_order_recv[channel])) {
+        rs->next_order_recv[channel] = (uint16_t)(order_sequence + 1);
+    }
+
+    while (rs->recv_seen[rs->recv_base % P2P_RELIABLE_WINDOW]) {
+        rs->recv_seen[rs->recv_base % P2P_RELIABLE_WINDOW] = false;
+        rs->recv_base++;
+    }
+}
+
+bool p2p_rel_hold(ReliableState* rs, uint16_t sequence, uint8_t channel, uint16_t order_sequence,
+                  const uint8_t* data, uint32_t size, uint64_t arrival_us) {
+    if (!rs || size > EOS_P2P_MAX_PACKET_SIZE) return false;
+
+    ReliableHeldSlot* slot = &rs->held[sequence % P2P_RELIABLE_WINDOW];
+    if (slot->in_use) return false;  // still waiting to be delivered; let it retransmit
+
+    slot->in_use = true;
+    slot->sequence = sequence;
+    slot->order_sequence = order_sequence;
+    slot->channel = channel;
+    slot->size = size;
+    slot->arrival_us = arrival_us;
+    if (data && size > 0) {
+        memcpy(slot->data, data, size);
+    }
+    rs->held_count++;
+
+    // Held counts as received for ACK purposes; ordering is released separately.
+    p2p_rel_mark_received(rs, sequence, false, channel, order_sequence);
+    return true;
+}
+
+// Find a held packet that is now next in order on its channel.
+ReliableHeldSlot* p2p_rel_next_ready(ReliableState* rs) {
+    if (!rs || rs->held_count == 0) return NULL;
+    for (int i = 0; i < P2P_RELIABLE_WINDOW; i++) {
+        ReliableHeldSlot* slot = &rs->held[i];
+        if (!slot->in_use) continue;
+        if (!seq_less(rs->next_order_recv[slot->channel], slot->order_sequence)) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+void p2p_rel_release_held(ReliableState* rs, ReliableHeldSlot* slot) {
+    if (!rs || !slot || !slot->in_use) return;
+    if (!seq_less(slot->order_sequence, rs->next_order_recv[slot->channel])) {
+        rs->next_order_recv[slot->channel] = (uint16_t)(slot->order_sequence + 1);
+    }
+    slot->in_use = false;
+    if (rs->held_count > 0) rs->held_count--;
+}
+
+void p2p_rel_build_ack(const ReliableState* rs, uint16_t* out_ack, uint32_t* out_ack_bits) {
+    if (!rs || !out_ack || !out_ack_bits) return;
+    uint16_t ack = (uint16_t)(rs->recv_base - 1);
+    uint32_t bits = 0;
+    for (int i = 0; i < P2P_ACK_BITS; i++) {
+        uint16_t seq = (uint16_t)(rs->recv_base + i);
+        if (rs->recv_seen[seq % P2P_RELIABLE_WINDOW]) {
+            bits |= (1u << i);
+        }
+    }
+    *out_ack = ack;
+    *out_ack_bits = bits;
+}
@@ -8,6 +8,7 @@
 #include "internal/p2p_internal.h"
 #include "internal/callbacks.h"
 #include "internal/logging.h"
+#include "lan_common.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -256,6 +257,11 @@ EOS_DECLARE_FUNC(void) EOS_Platform_Release(EOS_HPlatform Handle) {
     EOS_LOG_INFO("Platform released");
 }
 
+bool platform_on_tick_thread(const PlatformState* platform) {
+    return platform && platform->tick_thread != 0 &&
+           platform->tick_thread == lan_current_thread_id();
+}
+
 EOS_DECLARE_FUNC(void) EOS_Platform_Tick(EOS_HPlatform Handle) {
     PlatformState* platform = (PlatformState*)Handle;
     if (!platform || !platform->callbacks) {
@@ -264,6 +270,8 @@ EOS_DECLARE_FUNC(void) EOS_Platform_Tick(EOS_HPlatform Handle) {
         return;
     }
 
+    platform->tick_thread = lan_current_thread_id();
+
     // Drive LAN discovery (broadcasts sessions, polls for announcements)
     if (platform->sessions) {
         sessions_tick(platform->sessions);
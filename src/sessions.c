@@ -356,6 +356,7 @@ EOS_DECLARE_FUNC(void) EOS_Sessions_UpdateSession(
                 format_address(s->host_address, sizeof(s->host_address), p2p_ip, p2p_port);
                 EOS_LOG_INFO(">>> Session host_address advertised as %s", s->host_address);
             }
+            p2p_group_join(state->platform->p2p, s->session_id);
         }
 
         state->local_session_count++;
@@ -437,6 +438,9 @@ EOS_DECLARE_FUNC(void) EOS_Sessions_DestroySession(
     // Mark session as invalid (destroyed)
     session->state = EOS_OSS_Destroying;
     session->valid = false;
+    if (state->platform && state->platform->p2p) {
+        p2p_group_leave(state->platform->p2p, session->session_id);
+    }
 
     // Remove from array by shifting
     int index = (int)(session - state->local_sessions);
@@ -604,6 +608,10 @@ EOS_DECLARE_FUNC(void) EOS_Sessions_JoinSession(
         p2p_register_peer_address(state->platform->p2p, s->owner_id, s->host_address);
         EOS_LOG_INFO(">>> JoinSession: registered host P2P endpoint %s for owner %s",
                      s->host_address, s->owner_id_string);
+        p2p_prewarm_peer(state->platform->p2p, s->owner_id);
+    }
+    if (state->platform && state->platform->p2p) {
+        p2p_group_join(state->platform->p2p, s->session_id);
     }
 
     state->local_session_count++;
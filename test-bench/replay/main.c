@@ -0,0 +1,351 @@
+/**
+ * EOS-LAN Capture Replay
+ *
+ * Feeds a capture recorded with EOSLAN_CAPTURE back through a platform, with
+ * no network, and reports what the hot path did with it.
+ *
+ * Usage:
+ *   ./eoslan-replay capture.bin                  # original speed, 60 Hz ticks
+ *   ./eoslan-replay capture.bin --speed 4        # four times as fast
+ *   ./eoslan-replay capture.bin --speed 0 --tick-ms 0   # as fast as it goes
+ *   ./eoslan-replay capture.bin --summary        # describe the capture only
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define usleep(x) Sleep((x) / 1000)
+#else
+#include <unistd.h>
+#endif
+
+#include "eos/eos_sdk.h"
+#include "eos/eos_init.h"
+#include "eos/eos_common.h"
+#include "eos/eos_connect.h"
+#include "eos/eos_p2p.h"
+#include "lan_capture.h"
+
+#define MAX_TICK_SAMPLES (1 << 20)
+#define IDLE_TICKS_DONE 100  // --speed 0: stop after this many ticks with nothing delivered
+
+// Configuration
+static struct {
+    const char* path;
+    double speed;
+    int tick_ms;
+    bool summary_only;
+} g_config = {
+    .path = NULL,
+    .speed = 1.0,
+    .tick_ms = 16,
+    .summary_only = false
+};
+
+// What the capture holds
+static struct {
+    uint64_t duration_us;
+    uint64_t datagrams[3][2];  // [kind][direction]
+    uint64_t bytes[3][2];
+    uint16_t p2p_port;         // lowest port seen for each kind
+    uint16_t discovery_port;
+} g_capture;
+
+// What the replay did
+static EOS_HPlatform g_platform = NULL;
+static EOS_ProductUserId g_local_user = NULL;
+static uint64_t g_connections = 0;
+static uint64_t g_packets = 0;
+static uint64_t g_packet_bytes = 0;
+static uint64_t g_max_queue_packets = 0;
+static uint64_t g_max_queue_bytes = 0;
+static uint32_t* g_tick_us = NULL;
+static uint32_t g_tick_count = 0;
+
+#define LOG(fmt, ...) printf("[replay] " fmt "\n", ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[replay] ERROR: " fmt "\n", ##__VA_ARGS__)
+
+static uint64_t now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / freq.QuadPart) * 1000000 +
+           (uint64_t)(counter.QuadPart % freq.QuadPart) * 1000000 / (uint64_t)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+static void set_env(const char* name, const char* value, bool overwrite) {
+    if (!overwrite && getenv(name)) return;
+#ifdef _WIN32
+    _putenv_s(name, value);
+#else
+    setenv(name, value, 1);
+#endif
+}
+
+static uint64_t get_le(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+// ============================================================================
+// Capture summary
+// ============================================================================
+
+static bool read_capture(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        LOG_ERROR("Can't open %s", path);
+        return false;
+    }
+    uint8_t magic[LAN_CAPTURE_MAGIC_SIZE];
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+        memcmp(magic, LAN_CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        LOG_ERROR("%s is not a capture file", path);
+        fclose(f);
+        return false;
+    }
+
+    uint8_t header[LAN_CAPTURE_RECORD_HEADER];
+    while (fread(header, 1, sizeof(header), f) == sizeof(header)) {
+        uint64_t time_us = get_le(header, 8);
+        uint8_t kind = header[8];
+        uint8_t direction = header[9];
+        uint16_t port = (uint16_t)get_le(header + 10, 2);
+        uint32_t len = (uint32_t)get_le(header + 18, 4);
+        if (fseek(f, (long)len, SEEK_CUR) != 0) break;
+
+        if (time_us > g_capture.duration_us) g_capture.duration_us = time_us;
+        if (kind > LAN_CAPTURE_DISCOVERY || direction > LAN_CAPTURE_OUT) continue;
+        g_capture.datagrams[kind][direction]++;
+        g_capture.bytes[kind][direction] += len;
+        uint16_t* lowest = kind == LAN_CAPTURE_P2P ? &g_capture.p2p_port : &g_capture.discovery_port;
+        if (*lowest == 0 || port < *lowest) *lowest = port;
+    }
+    fclose(f);
+
+    LOG("%s: %.3f s", path, (double)g_capture.duration_us / 1e6);
+    LOG("  P2P        in %8llu datagrams %10llu bytes   out %8llu datagrams %10llu bytes",
+        (unsigned long long)g_capture.datagrams[LAN_CAPTURE_P2P][LAN_CAPTURE_IN],
+        (unsigned long long)g_capture.bytes[LAN_CAPTURE_P2P][LAN_CAPTURE_IN],
+        (unsigned long long)g_capture.datagrams[LAN_CAPTURE_P2P][LAN_CAPTURE_OUT],
+        (unsigned long long)g_capture.bytes[LAN_CAPTURE_P2P][LAN_CAPTURE_OUT]);
+    LOG("  Discovery  in %8llu datagrams %10llu bytes   out %8llu datagrams %10llu bytes",
+        (unsigned long long)g_capture.datagrams[LAN_CAPTURE_DISCOVERY][LAN_CAPTURE_IN],
+        (unsigned long long)g_capture.bytes[LAN_CAPTURE_DISCOVERY][LAN_CAPTURE_IN],
+        (unsigned long long)g_capture.datagrams[LAN_CAPTURE_DISCOVERY][LAN_CAPTURE_OUT],
+        (unsigned long long)g_capture.bytes[LAN_CAPTURE_DISCOVERY][LAN_CAPTURE_OUT]);
+    if (g_capture.p2p_port) LOG("  P2P port %u", (unsigned)g_capture.p2p_port);
+    if (g_capture.discovery_port) LOG("  Discovery port %u", (unsigned)g_capture.discovery_port);
+    return true;
+}
+
+// ============================================================================
+// Replay
+// ============================================================================
+
+static void EOS_CALL OnConnectionRequest(const EOS_P2P_OnIncomingConnectionRequestInfo* Data) {
+    EOS_P2P_AcceptConnectionOptions opts = {0};
+    opts.ApiVersion = EOS_P2P_ACCEPTCONNECTION_API_LATEST;
+    opts.LocalUserId = Data->LocalUserId;
+    opts.RemoteUserId = Data->RemoteUserId;
+    opts.SocketId = Data->SocketId;
+    if (EOS_P2P_AcceptConnection(EOS_Platform_GetP2PInterface(g_platform), &opts) == EOS_Success) {
+        g_connections++;
+    }
+}
+
+static bool start_platform(void) {
+    char value[32];
+    set_env("EOSLAN_REPLAY", g_config.path, true);
+    snprintf(value, sizeof(value), "%g", g_config.speed);
+    set_env("EOSLAN_REPLAY_SPEED", value, true);
+    // Bind the ports the capture was recorded on, so its records find their sockets.
+    if (g_capture.p2p_port) {
+        snprintf(value, sizeof(value), "%u", (unsigned)g_capture.p2p_port);
+        set_env("EOSLAN_P2P_BASE_PORT", value, false);
+    }
+    if (g_capture.discovery_port) {
+        snprintf(value, sizeof(value), "%u", (unsigned)g_capture.discovery_port);
+        set_env("EOSLAN_DISCOVERY_PORT", value, false);
+    }
+
+    EOS_InitializeOptions init_opts = {0};
+    init_opts.ApiVersion = EOS_INITIALIZE_API_LATEST;
+    init_opts.ProductName = "EOSLANReplay";
+    init_opts.ProductVersion = "1.0.0";
+    EOS_EResult result = EOS_Initialize(&init_opts);
+    if (result != EOS_Success && result != EOS_AlreadyConfigured) {
+        LOG_ERROR("EOS_Initialize failed: %s", EOS_EResult_ToString(result));
+        return false;
+    }
+
+    EOS_Platform_Options platform_opts = {0};
+    platform_opts.ApiVersion = EOS_PLATFORM_OPTIONS_API_LATEST;
+    platform_opts.ProductId = "replay_product";
+    platform_opts.SandboxId = "replay_sandbox";
+    platform_opts.DeploymentId = "replay_deployment";
+    platform_opts.Flags = EOS_PF_DISABLE_OVERLAY;
+    g_platform = EOS_Platform_Create(&platform_opts);
+    if (!g_platform) {
+        LOG_ERROR("EOS_Platform_Create failed");
+        return false;
+    }
+    g_local_user = EOS_Connect_GetLoggedInUserByIndex(EOS_Platform_GetConnectInterface(g_platform), 0);
+
+    EOS_P2P_AddNotifyPeerConnectionRequestOptions notify = {0};
+    notify.ApiVersion = EOS_P2P_ADDNOTIFYPEERCONNECTIONREQUEST_API_LATEST;
+    notify.LocalUserId = g_local_user;
+    EOS_P2P_AddNotifyPeerConnectionRequest(EOS_Platform_GetP2PInterface(g_platform), &notify, NULL,
+                                           OnConnectionRequest);
+    return true;
+}
+
+// Hand everything queued to the "game", noting how deep the queue got.
+static uint64_t drain_packets(void) {
+    EOS_HP2P p2p = EOS_Platform_GetP2PInterface(g_platform);
+
+    EOS_P2P_GetPacketQueueInfoOptions info_opts = {0};
+    info_opts.ApiVersion = EOS_P2P_GETPACKETQUEUEINFO_API_LATEST;
+    EOS_P2P_PacketQueueInfo info = {0};
+    if (EOS_P2P_GetPacketQueueInfo(p2p, &info_opts, &info) == EOS_Success) {
+        if (info.IncomingPacketQueueCurrentPacketCount > g_max_queue_packets) {
+            g_max_queue_packets = info.IncomingPacketQueueCurrentPacketCount;
+        }
+        if (info.IncomingPacketQueueCurrentSizeBytes > g_max_queue_bytes) {
+            g_max_queue_bytes = info.IncomingPacketQueueCurrentSizeBytes;
+        }
+    }
+
+    uint64_t count = 0;
+    for (;;) {
+        static uint8_t data[EOS_P2P_MAX_PACKET_SIZE];
+        EOS_P2P_ReceivePacketOptions opts = {0};
+        opts.ApiVersion = EOS_P2P_RECEIVEPACKET_API_LATEST;
+        opts.LocalUserId = g_local_user;
+        opts.MaxDataSizeBytes = sizeof(data);
+        EOS_ProductUserId peer;
+        EOS_P2P_SocketId socket_id;
+        uint8_t channel;
+        uint32_t written = 0;
+        if (EOS_P2P_ReceivePacket(p2p, &opts, &peer, &socket_id, &channel, data, &written) != EOS_Success) {
+            break;
+        }
+        count++;
+        g_packet_bytes += written;
+    }
+    g_packets += count;
+    return count;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void run_replay(void) {
+    // The capture's clock starts with the first tick.
+    uint64_t deadline_us = g_config.speed > 0
+        ? (uint64_t)((double)g_capture.duration_us / g_config.speed) + 1000000
+        : 0;
+    uint64_t start = now_us();
+    int idle = 0;
+
+    for (;;) {
+        uint64_t before = now_us();
+        EOS_Platform_Tick(g_platform);
+        uint64_t cost = now_us() - before;
+        if (g_tick_count < MAX_TICK_SAMPLES) g_tick_us[g_tick_count++] = (uint32_t)cost;
+
+        uint64_t delivered = drain_packets();
+        if (g_config.speed > 0) {
+            if (now_us() - start > deadline_us) break;
+        } else {
+            idle = delivered > 0 ? 0 : idle + 1;
+            if (idle >= IDLE_TICKS_DONE) break;
+        }
+        if (g_config.tick_ms > 0) usleep(g_config.tick_ms * 1000);
+    }
+
+    double elapsed = (double)(now_us() - start) / 1e6;
+    LOG("Replayed in %.3f s: %llu connections accepted, %llu packets (%llu bytes) delivered",
+        elapsed, (unsigned long long)g_connections, (unsigned long long)g_packets,
+        (unsigned long long)g_packet_bytes);
+    LOG("Incoming queue peak: %llu packets, %llu bytes",
+        (unsigned long long)g_max_queue_packets, (unsigned long long)g_max_queue_bytes);
+
+    if (g_tick_count > 0) {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < g_tick_count; i++) total += g_tick_us[i];
+        qsort(g_tick_us, g_tick_count, sizeof(uint32_t), compare_u32);
+        LOG("Tick cost over %u ticks (us): avg %llu  p50 %u  p99 %u  max %u",
+            g_tick_count, (unsigned long long)(total / g_tick_count),
+            g_tick_us[g_tick_count / 2], g_tick_us[(uint64_t)g_tick_count * 99 / 100],
+            g_tick_us[g_tick_count - 1]);
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s <capture> [options]\n", prog);
+    printf("\nOptions:\n");
+    printf("  --speed X     Replay X times as fast (default 1, 0 = no pacing)\n");
+    printf("  --tick-ms N   Sleep N ms between platform ticks (default 16)\n");
+    printf("  --summary     Describe the capture and exit\n");
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            g_config.speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tick-ms") == 0 && i + 1 < argc) {
+            g_config.tick_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            g_config.summary_only = true;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (!g_config.path && argv[i][0] != '-') {
+            g_config.path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!g_config.path || g_config.speed < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (!read_capture(g_config.path)) return 1;
+    if (g_config.summary_only) return 0;
+
+    g_tick_us = malloc(MAX_TICK_SAMPLES * sizeof(uint32_t));
+    if (!g_tick_us) return 1;
+
+    if (!start_platform()) {
+        free(g_tick_us);
+        return 1;
+    }
+    run_replay();
+
+    EOS_Platform_Release(g_platform);
+    EOS_Shutdown();
+    free(g_tick_us);
+    return 0;
+}